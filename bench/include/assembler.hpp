@@ -0,0 +1,201 @@
+#pragma once
+
+#include "common/type.hpp"
+
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace bench
+{
+	/**
+	 * @brief RV32 integer registers, named by their ABI names
+	 *
+	 */
+	enum class Reg : u8
+	{
+		zero,
+		ra,
+		sp,
+		gp,
+		tp,
+		t0,
+		t1,
+		t2,
+		s0,
+		s1,
+		a0,
+		a1,
+		a2,
+		a3,
+		a4,
+		a5,
+		a6,
+		a7,
+		s2,
+		s3,
+		s4,
+		s5,
+		s6,
+		s7,
+		s8,
+		s9,
+		s10,
+		s11,
+		t3,
+		t4,
+		t5,
+		t6
+	};
+
+	/**
+	 * @brief Handle of a code label. Create with `Assembler::new_label()`, place with `Assembler::bind()`.
+	 *
+	 */
+	struct Label
+	{
+		size_t id;
+	};
+
+	/**
+	 * @brief Tiny RV32IM + Zicsr assembler for generating guest workloads without a RISC-V toolchain
+	 * @note Only the instructions supported by the emulator are provided. Branch and jump targets are
+	 * resolved in `finish()`.
+	 */
+	class Assembler
+	{
+	  public:
+
+		/**
+		 * @brief Construct a new `Assembler`
+		 *
+		 * @param base_address Address where the first instruction will be placed
+		 */
+		Assembler(u32 base_address) :
+			base_address(base_address)
+		{}
+
+		/* Labels */
+
+		Label new_label();
+		void bind(Label label);
+
+		/**
+		 * @brief Address of the next emitted instruction
+		 *
+		 */
+		u32 current_address() const noexcept { return base_address + static_cast<u32>(code.size() * 4); }
+
+		/* RV32I */
+
+		void lui(Reg rd, u32 imm_upper20);
+		void auipc(Reg rd, u32 imm_upper20);
+		void jal(Reg rd, Label target);
+		void jalr(Reg rd, Reg rs1, i32 imm);
+
+		void beq(Reg rs1, Reg rs2, Label target);
+		void bne(Reg rs1, Reg rs2, Label target);
+		void blt(Reg rs1, Reg rs2, Label target);
+		void bge(Reg rs1, Reg rs2, Label target);
+		void bltu(Reg rs1, Reg rs2, Label target);
+		void bgeu(Reg rs1, Reg rs2, Label target);
+
+		void lb(Reg rd, Reg rs1, i32 imm);
+		void lh(Reg rd, Reg rs1, i32 imm);
+		void lw(Reg rd, Reg rs1, i32 imm);
+		void lbu(Reg rd, Reg rs1, i32 imm);
+		void lhu(Reg rd, Reg rs1, i32 imm);
+		void sb(Reg rs2, Reg rs1, i32 imm);
+		void sh(Reg rs2, Reg rs1, i32 imm);
+		void sw(Reg rs2, Reg rs1, i32 imm);
+
+		void addi(Reg rd, Reg rs1, i32 imm);
+		void slti(Reg rd, Reg rs1, i32 imm);
+		void sltiu(Reg rd, Reg rs1, i32 imm);
+		void xori(Reg rd, Reg rs1, i32 imm);
+		void ori(Reg rd, Reg rs1, i32 imm);
+		void andi(Reg rd, Reg rs1, i32 imm);
+		void slli(Reg rd, Reg rs1, u32 shamt);
+		void srli(Reg rd, Reg rs1, u32 shamt);
+		void srai(Reg rd, Reg rs1, u32 shamt);
+
+		void add(Reg rd, Reg rs1, Reg rs2);
+		void sub(Reg rd, Reg rs1, Reg rs2);
+		void sll(Reg rd, Reg rs1, Reg rs2);
+		void slt(Reg rd, Reg rs1, Reg rs2);
+		void sltu(Reg rd, Reg rs1, Reg rs2);
+		void xor_(Reg rd, Reg rs1, Reg rs2);
+		void srl(Reg rd, Reg rs1, Reg rs2);
+		void sra(Reg rd, Reg rs1, Reg rs2);
+		void or_(Reg rd, Reg rs1, Reg rs2);
+		void and_(Reg rd, Reg rs1, Reg rs2);
+
+		void ecall();
+		void mret();
+
+		/* RV32M */
+
+		void mul(Reg rd, Reg rs1, Reg rs2);
+		void mulh(Reg rd, Reg rs1, Reg rs2);
+		void mulhu(Reg rd, Reg rs1, Reg rs2);
+		void div(Reg rd, Reg rs1, Reg rs2);
+		void divu(Reg rd, Reg rs1, Reg rs2);
+		void rem(Reg rd, Reg rs1, Reg rs2);
+		void remu(Reg rd, Reg rs1, Reg rs2);
+
+		/* Zicsr */
+
+		void csrrw(Reg rd, u16 csr, Reg rs1);
+		void csrrs(Reg rd, u16 csr, Reg rs1);
+		void csrrc(Reg rd, u16 csr, Reg rs1);
+
+		/* Pseudo instructions */
+
+		void li(Reg rd, u32 value);
+		void mv(Reg rd, Reg rs) { addi(rd, rs, 0); }
+		void j(Label target) { jal(Reg::zero, target); }
+		void call(Label target) { jal(Reg::ra, target); }
+		void ret() { jalr(Reg::zero, Reg::ra, 0); }
+		void csrr(Reg rd, u16 csr) { csrrs(rd, csr, Reg::zero); }
+		void csrw(u16 csr, Reg rs) { csrrw(Reg::zero, csr, rs); }
+		void csrs(u16 csr, Reg rs) { csrrs(Reg::zero, csr, rs); }
+		void csrc(u16 csr, Reg rs) { csrrc(Reg::zero, csr, rs); }
+
+		/**
+		 * @brief Emit `j .`, which the emulator detects as the end of the program
+		 *
+		 */
+		void halt();
+
+		/**
+		 * @brief Resolve all label references and produce the raw binary
+		 *
+		 * @return Little-endian raw binary, ready to be used as a flash image
+		 * @throws std::logic_error If a label is unbound or a target is out of range
+		 */
+		std::vector<u8> finish() const;
+
+	  private:
+
+		enum class Fixup_kind
+		{
+			Branch,
+			Jump
+		};
+
+		struct Fixup
+		{
+			size_t index;  // Index of the instruction word to patch
+			Label target;
+			Fixup_kind kind;
+		};
+
+		u32 base_address;
+		std::vector<u32> code;
+		std::vector<std::optional<u32>> labels;
+		std::vector<Fixup> fixups;
+
+		void emit(u32 word) { code.push_back(word); }
+		void emit_branch(u32 funct3, Reg rs1, Reg rs2, Label target);
+	};
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace bench
+{
+	/**
+	 * @brief Measure the lookup cost of `device::Address_decoder` against a binary search, for platforms
+	 * with 4 to 64 devices, and print the results
+	 *
+	 */
+	void run_decoder_benchmark();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "common/type.hpp"
+
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace bench
+{
+	/* Platform addresses, see `machine::Config` */
+
+	static constexpr u32 rom_base = 0x0010'0000;
+	static constexpr u32 ram_base = 0x8000'0000;
+	static constexpr u32 uart_base = 0x0001'0000;
+	static constexpr u32 clock_base = 0x0001'1000;
+
+	/**
+	 * @brief A self-contained guest program used as a macro benchmark
+	 * @note Every workload ends with `j .`, so the emulator stops by itself with default options
+	 */
+	struct Workload
+	{
+		std::string_view name;
+		std::string_view description;
+
+		/**
+		 * @brief Generate the raw binary flash image of the workload
+		 * @param scale Multiplier of the iteration count, `1` runs in roughly a second on a decent host
+		 */
+		std::vector<u8> (*generate)(u32 scale);
+	};
+
+	/**
+	 * @brief Get all available workloads
+	 *
+	 * @return List of workloads, in the order they should be run
+	 */
+	std::span<const Workload> get_workloads();
+}
@@ -0,0 +1,323 @@
+#include "assembler.hpp"
+
+#include <format>
+
+namespace bench
+{
+	namespace encode
+	{
+		static constexpr u32 reg(Reg r)
+		{
+			return static_cast<u32>(r);
+		}
+
+		static constexpr u32 r_type(u32 funct7, Reg rs2, Reg rs1, u32 funct3, Reg rd, u32 opcode)
+		{
+			return (funct7 << 25)
+				 | (reg(rs2) << 20)
+				 | (reg(rs1) << 15)
+				 | (funct3 << 12)
+				 | (reg(rd) << 7)
+				 | opcode;
+		}
+
+		static constexpr u32 i_type(i32 imm, Reg rs1, u32 funct3, Reg rd, u32 opcode)
+		{
+			return ((static_cast<u32>(imm) & 0xfff) << 20)
+				 | (reg(rs1) << 15)
+				 | (funct3 << 12)
+				 | (reg(rd) << 7)
+				 | opcode;
+		}
+
+		static constexpr u32 s_type(i32 imm, Reg rs2, Reg rs1, u32 funct3, u32 opcode)
+		{
+			const u32 uimm = static_cast<u32>(imm);
+			return (((uimm >> 5) & 0x7f) << 25)
+				 | (reg(rs2) << 20)
+				 | (reg(rs1) << 15)
+				 | (funct3 << 12)
+				 | ((uimm & 0x1f) << 7)
+				 | opcode;
+		}
+
+		static constexpr u32 b_type(i32 offset, Reg rs2, Reg rs1, u32 funct3)
+		{
+			const u32 uimm = static_cast<u32>(offset);
+			return (((uimm >> 12) & 0x1) << 31)
+				 | (((uimm >> 5) & 0x3f) << 25)
+				 | (reg(rs2) << 20)
+				 | (reg(rs1) << 15)
+				 | (funct3 << 12)
+				 | (((uimm >> 1) & 0xf) << 8)
+				 | (((uimm >> 11) & 0x1) << 7)
+				 | 0b1100011;
+		}
+
+		static constexpr u32 j_type(i32 offset, Reg rd)
+		{
+			const u32 uimm = static_cast<u32>(offset);
+			return (((uimm >> 20) & 0x1) << 31)
+				 | (((uimm >> 1) & 0x3ff) << 21)
+				 | (((uimm >> 11) & 0x1) << 20)
+				 | (((uimm >> 12) & 0xff) << 12)
+				 | (reg(rd) << 7)
+				 | 0b1101111;
+		}
+
+		static constexpr u32 u_type(u32 imm_upper20, Reg rd, u32 opcode)
+		{
+			return (imm_upper20 << 12) | (reg(rd) << 7) | opcode;
+		}
+
+		static void check_imm12(i32 imm)
+		{
+			if (imm < -2048 || imm > 2047)
+				throw std::logic_error(std::format("Immediate {} doesn't fit in 12 bits", imm));
+		}
+
+		static constexpr u32 op_load = 0b0000011, op_store = 0b0100011, op_imm = 0b0010011,
+							 op_reg = 0b0110011, op_system = 0b1110011;
+	}
+
+	Label Assembler::new_label()
+	{
+		labels.emplace_back(std::nullopt);
+		return Label{.id = labels.size() - 1};
+	}
+
+	void Assembler::bind(Label label)
+	{
+		if (labels.at(label.id).has_value()) throw std::logic_error("Label bound twice");
+		labels[label.id] = current_address();
+	}
+
+	void Assembler::emit_branch(u32 funct3, Reg rs1, Reg rs2, Label target)
+	{
+		fixups.push_back(Fixup{.index = code.size(), .target = target, .kind = Fixup_kind::Branch});
+		emit(encode::b_type(0, rs2, rs1, funct3));
+	}
+
+	/* RV32I */
+
+	void Assembler::lui(Reg rd, u32 imm_upper20)
+	{
+		emit(encode::u_type(imm_upper20 & 0xfffff, rd, 0b0110111));
+	}
+
+	void Assembler::auipc(Reg rd, u32 imm_upper20)
+	{
+		emit(encode::u_type(imm_upper20 & 0xfffff, rd, 0b0010111));
+	}
+
+	void Assembler::jal(Reg rd, Label target)
+	{
+		fixups.push_back(Fixup{.index = code.size(), .target = target, .kind = Fixup_kind::Jump});
+		emit(encode::j_type(0, rd));
+	}
+
+	void Assembler::jalr(Reg rd, Reg rs1, i32 imm)
+	{
+		encode::check_imm12(imm);
+		emit(encode::i_type(imm, rs1, 0b000, rd, 0b1100111));
+	}
+
+	void Assembler::beq(Reg rs1, Reg rs2, Label target)
+	{
+		emit_branch(0b000, rs1, rs2, target);
+	}
+
+	void Assembler::bne(Reg rs1, Reg rs2, Label target)
+	{
+		emit_branch(0b001, rs1, rs2, target);
+	}
+
+	void Assembler::blt(Reg rs1, Reg rs2, Label target)
+	{
+		emit_branch(0b100, rs1, rs2, target);
+	}
+
+	void Assembler::bge(Reg rs1, Reg rs2, Label target)
+	{
+		emit_branch(0b101, rs1, rs2, target);
+	}
+
+	void Assembler::bltu(Reg rs1, Reg rs2, Label target)
+	{
+		emit_branch(0b110, rs1, rs2, target);
+	}
+
+	void Assembler::bgeu(Reg rs1, Reg rs2, Label target)
+	{
+		emit_branch(0b111, rs1, rs2, target);
+	}
+
+#define LOAD_INST(name, funct3)                                                                              \
+	void Assembler::name(Reg rd, Reg rs1, i32 imm)                                                           \
+	{                                                                                                        \
+		encode::check_imm12(imm);                                                                            \
+		emit(encode::i_type(imm, rs1, funct3, rd, encode::op_load));                                         \
+	}
+
+#define STORE_INST(name, funct3)                                                                             \
+	void Assembler::name(Reg rs2, Reg rs1, i32 imm)                                                          \
+	{                                                                                                        \
+		encode::check_imm12(imm);                                                                            \
+		emit(encode::s_type(imm, rs2, rs1, funct3, encode::op_store));                                       \
+	}
+
+#define IMM_INST(name, funct3)                                                                               \
+	void Assembler::name(Reg rd, Reg rs1, i32 imm)                                                           \
+	{                                                                                                        \
+		encode::check_imm12(imm);                                                                            \
+		emit(encode::i_type(imm, rs1, funct3, rd, encode::op_imm));                                          \
+	}
+
+#define SHIFT_INST(name, funct7, funct3)                                                                     \
+	void Assembler::name(Reg rd, Reg rs1, u32 shamt)                                                         \
+	{                                                                                                        \
+		const auto imm = static_cast<i32>(((funct7) << 5) | (shamt & 0x1f));                                 \
+		emit(encode::i_type(imm, rs1, funct3, rd, encode::op_imm));                                          \
+	}
+
+#define REG_INST(name, funct7, funct3)                                                                       \
+	void Assembler::name(Reg rd, Reg rs1, Reg rs2)                                                           \
+	{                                                                                                        \
+		emit(encode::r_type(funct7, rs2, rs1, funct3, rd, encode::op_reg));                                  \
+	}
+
+	LOAD_INST(lb, 0b000)
+	LOAD_INST(lh, 0b001)
+	LOAD_INST(lw, 0b010)
+	LOAD_INST(lbu, 0b100)
+	LOAD_INST(lhu, 0b101)
+
+	STORE_INST(sb, 0b000)
+	STORE_INST(sh, 0b001)
+	STORE_INST(sw, 0b010)
+
+	IMM_INST(addi, 0b000)
+	IMM_INST(slti, 0b010)
+	IMM_INST(sltiu, 0b011)
+	IMM_INST(xori, 0b100)
+	IMM_INST(ori, 0b110)
+	IMM_INST(andi, 0b111)
+
+	SHIFT_INST(slli, 0b0000000, 0b001)
+	SHIFT_INST(srli, 0b0000000, 0b101)
+	SHIFT_INST(srai, 0b0100000, 0b101)
+
+	REG_INST(add, 0b0000000, 0b000)
+	REG_INST(sub, 0b0100000, 0b000)
+	REG_INST(sll, 0b0000000, 0b001)
+	REG_INST(slt, 0b0000000, 0b010)
+	REG_INST(sltu, 0b0000000, 0b011)
+	REG_INST(xor_, 0b0000000, 0b100)
+	REG_INST(srl, 0b0000000, 0b101)
+	REG_INST(sra, 0b0100000, 0b101)
+	REG_INST(or_, 0b0000000, 0b110)
+	REG_INST(and_, 0b0000000, 0b111)
+
+	/* RV32M */
+
+	REG_INST(mul, 0b0000001, 0b000)
+	REG_INST(mulh, 0b0000001, 0b001)
+	REG_INST(mulhu, 0b0000001, 0b011)
+	REG_INST(div, 0b0000001, 0b100)
+	REG_INST(divu, 0b0000001, 0b101)
+	REG_INST(rem, 0b0000001, 0b110)
+	REG_INST(remu, 0b0000001, 0b111)
+
+#undef LOAD_INST
+#undef STORE_INST
+#undef IMM_INST
+#undef SHIFT_INST
+#undef REG_INST
+
+	void Assembler::ecall()
+	{
+		emit(encode::i_type(0, Reg::zero, 0b000, Reg::zero, encode::op_system));
+	}
+
+	void Assembler::mret()
+	{
+		emit(encode::i_type(0b001100000010, Reg::zero, 0b000, Reg::zero, encode::op_system));
+	}
+
+	/* Zicsr */
+
+	void Assembler::csrrw(Reg rd, u16 csr, Reg rs1)
+	{
+		emit(encode::i_type(csr, rs1, 0b001, rd, encode::op_system));
+	}
+
+	void Assembler::csrrs(Reg rd, u16 csr, Reg rs1)
+	{
+		emit(encode::i_type(csr, rs1, 0b010, rd, encode::op_system));
+	}
+
+	void Assembler::csrrc(Reg rd, u16 csr, Reg rs1)
+	{
+		emit(encode::i_type(csr, rs1, 0b011, rd, encode::op_system));
+	}
+
+	/* Pseudo instructions */
+
+	void Assembler::li(Reg rd, u32 value)
+	{
+		const i32 low = static_cast<i32>(value << 20) >> 20;  // Sign-extended low 12 bits
+		const u32 high = (value - static_cast<u32>(low)) >> 12;
+
+		if (high == 0)
+		{
+			addi(rd, Reg::zero, low);
+			return;
+		}
+
+		lui(rd, high);
+		if (low != 0) addi(rd, rd, low);
+	}
+
+	void Assembler::halt()
+	{
+		const auto self = new_label();
+		bind(self);
+		j(self);
+	}
+
+	std::vector<u8> Assembler::finish() const
+	{
+		auto words = code;
+
+		for (const auto& fixup : fixups)
+		{
+			const auto target = labels.at(fixup.target.id);
+			if (!target.has_value()) throw std::logic_error("Reference to unbound label");
+
+			const auto source = base_address + static_cast<u32>(fixup.index * 4);
+			const auto offset = static_cast<i32>(*target - source);
+
+			switch (fixup.kind)
+			{
+			case Fixup_kind::Branch:
+				if (offset < -4096 || offset > 4094)
+					throw std::logic_error(std::format("Branch offset {} out of range", offset));
+				words[fixup.index] |= encode::b_type(offset, Reg::zero, Reg::zero, 0);
+				break;
+
+			case Fixup_kind::Jump:
+				if (offset < -(1 << 20) || offset >= (1 << 20))
+					throw std::logic_error(std::format("Jump offset {} out of range", offset));
+				words[fixup.index] |= encode::j_type(offset, Reg::zero);
+				break;
+			}
+		}
+
+		std::vector<u8> binary;
+		binary.reserve(words.size() * 4);
+		for (const auto word : words)
+			for (const auto shift : {0, 8, 16, 24}) binary.push_back(static_cast<u8>(word >> shift));
+
+		return binary;
+	}
+}
@@ -0,0 +1,94 @@
+#include "decoder.hpp"
+#include "device/address-decoder.hpp"
+#include "workload.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <print>
+#include <random>
+
+namespace bench
+{
+	namespace
+	{
+		using Range = device::Address_decoder::Range;
+
+		constexpr size_t address_count = 4096;
+		constexpr size_t lookup_count = 1 << 26;
+
+		// ROM, RAM, and MMIO peripherals of 256 bytes on consecutive 4 KiB pages
+		std::vector<Range> make_layout(size_t device_count)
+		{
+			std::vector<Range> ranges;
+			for (size_t i = 0; i < device_count - 2; i++) ranges.push_back({uart_base + i * 0x1000, 0x100});
+			ranges.push_back({rom_base, 128 * 1024});
+			ranges.push_back({ram_base, 0x8000'0000});
+
+			std::ranges::sort(ranges, {}, &Range::base);
+			return ranges;
+		}
+
+		// Addresses hitting every device evenly, in random order
+		std::vector<u64> make_addresses(std::span<const Range> ranges)
+		{
+			std::mt19937_64 random(1);
+			std::vector<u64> addresses(address_count);
+
+			for (size_t i = 0; i < addresses.size(); i++)
+			{
+				const auto& range = ranges[i % ranges.size()];
+				const auto word = std::uniform_int_distribution<u64>(0, range.size / 4 - 1)(random);
+				addresses[i] = range.base + word * 4;
+			}
+
+			std::ranges::shuffle(addresses, random);
+			return addresses;
+		}
+
+		// Nanoseconds per lookup
+		double measure(std::span<const u64> addresses, auto&& find)
+		{
+			size_t checksum = 0;
+
+			const auto start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < lookup_count; i++) checksum += find(addresses[i % addresses.size()]);
+			const auto end = std::chrono::steady_clock::now();
+
+			// Keep the lookups from being optimized out
+			if (checksum == 0) std::println("");
+
+			return std::chrono::duration<double, std::nano>(end - start).count() / lookup_count;
+		}
+	}
+
+	void run_decoder_benchmark()
+	{
+		std::println("{:<10}{:>16}{:>16}", "devices", "decoder(ns)", "search(ns)");
+
+		for (const size_t device_count : {4, 8, 16, 32, 64})
+		{
+			const auto ranges = make_layout(device_count);
+			const auto addresses = make_addresses(ranges);
+
+			device::Address_decoder decoder;
+			decoder.build(ranges);
+
+			const auto decoder_time = measure(
+				addresses,
+				[&decoder](u64 address) { return decoder.find(address).value_or(0) + 1; }
+			);
+
+			const auto search_time = measure(
+				addresses,
+				[&ranges](u64 address)
+				{
+					const auto position = std::ranges::upper_bound(ranges, address, {}, &Range::base);
+					const auto& range = *std::prev(position);
+					return static_cast<size_t>(address - range.base < range.size) + 1;
+				}
+			);
+
+			std::println("{:<10}{:>16.2f}{:>16.2f}", device_count, decoder_time, search_time);
+		}
+	}
+}
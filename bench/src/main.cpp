@@ -0,0 +1,218 @@
+#include "core/print.hpp"
+#include "decoder.hpp"
+#include "workload.hpp"
+
+#include <algorithm>
+#include <argparse/argparse.hpp>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <optional>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+namespace
+{
+	struct Run_result
+	{
+		u64 inst_count;
+		double seconds;
+
+		double mips() const { return inst_count / seconds / 1e6; }
+	};
+
+	/**
+	 * @brief Run the emulator once on a flash file, and extract the execution summary from its output
+	 *
+	 * @param emulator_path Path to the `main` executable
+	 * @param flash_path Path to the raw binary flash file
+	 * @return Execution summary
+	 *
+	 * @throws std::runtime_error If the emulator fails or doesn't report the summary
+	 */
+	Run_result run_once(const std::string& emulator_path, const std::filesystem::path& flash_path)
+	{
+		const auto command
+			= std::format("\"{}\" --flash=\"{}\" --fill=zero 2>&1", emulator_path, flash_path.string());
+
+		FILE* pipe = popen(command.c_str(), "r");
+		if (pipe == nullptr) throw std::runtime_error(std::format("Failed to run `{}`", command));
+
+		std::optional<Run_result> result;
+		std::string line;
+		char buffer[4096];
+
+		// Guest UART output is interleaved with the log, only look at complete lines
+		while (std::fgets(buffer, sizeof(buffer), pipe) != nullptr)
+		{
+			line += buffer;
+			if (line.back() != '\n') continue;
+
+			if (const auto pos = line.find("Executed "); pos != std::string::npos)
+			{
+				Run_result parsed;
+				if (std::sscanf(
+						line.c_str() + pos,
+						"Executed %llu instructions in %lf s",
+						reinterpret_cast<unsigned long long*>(&parsed.inst_count),
+						&parsed.seconds
+					)
+					== 2)
+					result = parsed;
+			}
+
+			line.clear();
+		}
+
+		const auto status = pclose(pipe);
+		if (status != 0) throw std::runtime_error(std::format("`{}` exited with status {}", command, status));
+		if (!result.has_value() || result->seconds <= 0)
+			throw std::runtime_error(std::format("`{}` didn't report an execution summary", command));
+
+		return *result;
+	}
+
+	void print_statistics(std::string_view name, std::span<const Run_result> runs)
+	{
+		std::vector<double> mips(runs.size());
+		std::ranges::transform(runs, mips.begin(), &Run_result::mips);
+
+		const auto mean = std::accumulate(mips.begin(), mips.end(), 0.0) / mips.size();
+		const auto variance = mips.size() > 1
+								? std::accumulate(
+									  mips.begin(),
+									  mips.end(),
+									  0.0,
+									  [mean](double acc, double x) { return acc + (x - mean) * (x - mean); }
+								  ) / (mips.size() - 1)
+								: 0.0;
+		const auto stddev = std::sqrt(variance);
+		const auto [min, max] = std::ranges::minmax(mips);
+
+		std::println(
+			"{:<16}{:>14}{:>12.2f}{:>10.2f}{:>8.2f}%{:>10.2f}{:>10.2f}",
+			name,
+			runs.front().inst_count,
+			mean,
+			stddev,
+			mean > 0 ? stddev / mean * 100 : 0.0,
+			min,
+			max
+		);
+	}
+}
+
+int main(int argc, char* argv[])
+try
+{
+	std::string emulator_path;
+	std::string workdir;
+	std::string filter;
+	u32 repeat = 5;
+	u32 scale = 1;
+	bool list_only = false;
+	bool decoder_only = false;
+
+	argparse::ArgumentParser program("bench", "<alpha>");
+
+	program.add_argument("--emulator")
+		.help("Path to the emulator executable")
+		.store_into(emulator_path);
+
+	program.add_argument("-n", "--repeat")
+		.help("Number of runs of each workload")
+		.default_value(u32(5))
+		.store_into(repeat);
+
+	program.add_argument("--scale")
+		.help("Iteration multiplier of the workloads")
+		.default_value(u32(1))
+		.store_into(scale);
+
+	program.add_argument("--filter")
+		.help("Only run workloads whose name contains this string")
+		.default_value(std::string())
+		.store_into(filter);
+
+	program.add_argument("--workdir")
+		.help("Directory to store the generated flash files")
+		.default_value((std::filesystem::temp_directory_path() / "riscv-sim-bench").string())
+		.store_into(workdir);
+
+	program.add_argument("--list")
+		.help("List available workloads and exit")
+		.default_value(false)
+		.implicit_value(true)
+		.store_into(list_only);
+
+	program.add_argument("--decoder")
+		.help("Run the address decoder micro benchmark instead of the workloads")
+		.default_value(false)
+		.implicit_value(true)
+		.store_into(decoder_only);
+
+	program.parse_args(argc, argv);
+
+	if (decoder_only)
+	{
+		bench::run_decoder_benchmark();
+		return 0;
+	}
+
+	if (list_only)
+	{
+		for (const auto& workload : bench::get_workloads())
+			std::println("{:<16}{}", workload.name, workload.description);
+		return 0;
+	}
+
+	if (emulator_path.empty()) throw std::invalid_argument("--emulator is required");
+	if (repeat == 0) throw std::invalid_argument("--repeat must be at least 1");
+	if (scale == 0) throw std::invalid_argument("--scale must be at least 1");
+
+	std::filesystem::create_directories(workdir);
+
+	std::println(
+		"{:<16}{:>14}{:>12}{:>10}{:>9}{:>10}{:>10}",
+		"workload",
+		"instructions",
+		"MIPS(mean)",
+		"stddev",
+		"cv",
+		"min",
+		"max"
+	);
+
+	for (const auto& workload : bench::get_workloads())
+	{
+		if (!filter.empty() && !workload.name.contains(filter)) continue;
+
+		const auto flash_path = std::filesystem::path(workdir) / std::format("{}.bin", workload.name);
+		{
+			const auto binary = workload.generate(scale);
+			std::ofstream file(flash_path, std::ios::binary);
+			file.write(
+				reinterpret_cast<const char*>(binary.data()),
+				static_cast<std::streamsize>(binary.size())
+			);
+			if (!file) throw std::runtime_error(std::format("Failed to write {}", flash_path.string()));
+		}
+
+		std::vector<Run_result> runs;
+		for (u32 i = 0; i < repeat; i++) runs.push_back(run_once(emulator_path, flash_path));
+
+		print_statistics(workload.name, runs);
+	}
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	eprintln("{}", e.what());
+	return 1;
+}
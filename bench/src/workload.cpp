@@ -0,0 +1,401 @@
+#include "workload.hpp"
+#include "assembler.hpp"
+
+#include <array>
+
+namespace bench
+{
+	namespace
+	{
+		namespace csr_address
+		{
+			static constexpr u16 mstatus = 0x300, mie = 0x304, mtvec = 0x305, mepc = 0x341, mcause = 0x342,
+								 mip = 0x344;
+		}
+
+		/**
+		 * @brief CoreMark-like integer kernel: 8x8 matrix multiplication followed by a bitwise CRC16 of the
+		 * result
+		 *
+		 */
+		std::vector<u8> generate_integer(u32 scale)
+		{
+			using enum Reg;
+			Assembler a(rom_base);
+
+			a.li(s0, ram_base);          // Matrix A
+			a.li(s1, ram_base + 0x100);  // Matrix B
+			a.li(s2, ram_base + 0x200);  // Matrix C
+			a.li(s7, 8);
+			a.li(s8, 0x1021);  // CRC16-CCITT polynomial
+			a.li(s9, 0xffff);
+			a.li(s11, 0);
+
+			// A[i] = 3i + 1, B[i] = i ^ 0x5a
+			const auto init = a.new_label();
+			a.li(t0, 0);
+			a.li(t1, 64);
+			a.bind(init);
+			a.slli(t2, t0, 2);
+			a.add(t3, s0, t2);
+			a.add(t4, s1, t2);
+			a.slli(a0, t0, 1);
+			a.add(a0, a0, t0);
+			a.addi(a0, a0, 1);
+			a.sw(a0, t3, 0);
+			a.xori(a1, t0, 0x5a);
+			a.sw(a1, t4, 0);
+			a.addi(t0, t0, 1);
+			a.blt(t0, t1, init);
+
+			const auto outer = a.new_label(), i_loop = a.new_label(), j_loop = a.new_label(),
+					   k_loop = a.new_label(), crc_byte = a.new_label(), crc_bit = a.new_label(),
+					   crc_skip = a.new_label();
+
+			a.li(s3, 2000 * scale);
+			a.bind(outer);
+
+			// C = A * B + iteration
+			a.li(s4, 0);
+			a.bind(i_loop);
+			a.li(s5, 0);
+			a.bind(j_loop);
+			a.li(a0, 0);
+			a.li(s6, 0);
+			a.slli(t0, s4, 5);
+			a.add(t0, s0, t0);  // &A[i][0]
+			a.slli(t1, s5, 2);
+			a.add(t1, s1, t1);  // &B[0][j]
+			a.bind(k_loop);
+			a.lw(a1, t0, 0);
+			a.lw(a2, t1, 0);
+			a.mul(a3, a1, a2);
+			a.add(a0, a0, a3);
+			a.addi(t0, t0, 4);
+			a.addi(t1, t1, 32);
+			a.addi(s6, s6, 1);
+			a.blt(s6, s7, k_loop);
+			a.add(a0, a0, s3);
+			a.slli(t2, s4, 3);
+			a.add(t2, t2, s5);
+			a.slli(t2, t2, 2);
+			a.add(t2, s2, t2);
+			a.sw(a0, t2, 0);
+			a.addi(s5, s5, 1);
+			a.blt(s5, s7, j_loop);
+			a.addi(s4, s4, 1);
+			a.blt(s4, s7, i_loop);
+
+			// CRC16 over the lowest byte of every element of C
+			a.li(a0, 0xffff);
+			a.mv(t0, s2);
+			a.addi(t3, s2, 256);
+			a.bind(crc_byte);
+			a.lbu(a1, t0, 0);
+			a.slli(a1, a1, 8);
+			a.xor_(a0, a0, a1);
+			a.li(t1, 8);
+			a.bind(crc_bit);
+			a.slli(a0, a0, 1);
+			a.srli(a2, a0, 16);
+			a.andi(a2, a2, 1);
+			a.beq(a2, zero, crc_skip);
+			a.xor_(a0, a0, s8);
+			a.bind(crc_skip);
+			a.and_(a0, a0, s9);
+			a.addi(t1, t1, -1);
+			a.bne(t1, zero, crc_bit);
+			a.addi(t0, t0, 4);
+			a.bne(t0, t3, crc_byte);
+			a.add(s11, s11, a0);
+
+			a.addi(s3, s3, -1);
+			a.bne(s3, zero, outer);
+
+			a.sw(s11, s2, 256);
+			a.halt();
+
+			return a.finish();
+		}
+
+		/**
+		 * @brief Word-wise memset and memcpy of 64KiB, followed by a byte-wise copy of 4KiB
+		 *
+		 */
+		std::vector<u8> generate_memcpy(u32 scale)
+		{
+			using enum Reg;
+			Assembler a(rom_base);
+
+			const auto outer = a.new_label(), set_loop = a.new_label(), copy_loop = a.new_label(),
+					   byte_loop = a.new_label();
+
+			a.li(s0, ram_base);
+			a.li(s1, ram_base + 0x1'0000);
+			a.li(s2, 0x1'0000);
+			a.li(s3, 200 * scale);
+
+			a.bind(outer);
+
+			// memset(dst, iteration, 64KiB)
+			a.mv(t0, s1);
+			a.add(t1, s1, s2);
+			a.bind(set_loop);
+			a.sw(s3, t0, 0);
+			a.sw(s3, t0, 4);
+			a.sw(s3, t0, 8);
+			a.sw(s3, t0, 12);
+			a.addi(t0, t0, 16);
+			a.bltu(t0, t1, set_loop);
+
+			// memcpy(src, dst, 64KiB)
+			a.mv(t0, s1);
+			a.mv(t2, s0);
+			a.bind(copy_loop);
+			a.lw(a0, t0, 0);
+			a.lw(a1, t0, 4);
+			a.lw(a2, t0, 8);
+			a.lw(a3, t0, 12);
+			a.sw(a0, t2, 0);
+			a.sw(a1, t2, 4);
+			a.sw(a2, t2, 8);
+			a.sw(a3, t2, 12);
+			a.addi(t0, t0, 16);
+			a.addi(t2, t2, 16);
+			a.bltu(t0, t1, copy_loop);
+
+			// Byte-wise memcpy(dst, src, 4KiB)
+			a.mv(t0, s0);
+			a.mv(t2, s1);
+			a.li(t3, 4096);
+			a.add(t3, s0, t3);
+			a.bind(byte_loop);
+			a.lbu(a0, t0, 0);
+			a.sb(a0, t2, 0);
+			a.addi(t0, t0, 1);
+			a.addi(t2, t2, 1);
+			a.bltu(t0, t3, byte_loop);
+
+			a.addi(s3, s3, -1);
+			a.bne(s3, zero, outer);
+
+			a.halt();
+
+			return a.finish();
+		}
+
+		/**
+		 * @brief Pointer chasing through 64K nodes spread over 4MiB, visited in a full-period LCG order
+		 *
+		 */
+		std::vector<u8> generate_pointer_chase(u32 scale)
+		{
+			using enum Reg;
+			Assembler a(rom_base);
+
+			const auto build = a.new_label(), chase = a.new_label();
+
+			// node[idx].next = &node[(5 * idx + 1) % 65536]
+			a.li(s1, ram_base);
+			a.li(t0, 0);
+			a.li(t1, 65536);
+			a.li(t4, 0xffff);
+			a.bind(build);
+			a.slli(a0, t0, 2);
+			a.add(a0, a0, t0);
+			a.addi(a0, a0, 1);
+			a.and_(a0, a0, t4);
+			a.slli(a1, t0, 6);
+			a.add(a1, a1, s1);
+			a.slli(a2, a0, 6);
+			a.add(a2, a2, s1);
+			a.sw(a2, a1, 0);
+			a.mv(t0, a0);
+			a.addi(t1, t1, -1);
+			a.bne(t1, zero, build);
+
+			a.mv(s0, s1);
+			a.li(t0, 1'000'000 * scale);
+			a.bind(chase);
+			for (int i = 0; i < 8; i++) a.lw(s0, s0, 0);
+			a.addi(t0, t0, -1);
+			a.bne(t0, zero, chase);
+
+			a.halt();
+
+			return a.finish();
+		}
+
+		/**
+		 * @brief Signed and unsigned division/remainder of pseudo-random operands
+		 *
+		 */
+		std::vector<u8> generate_division(u32 scale)
+		{
+			using enum Reg;
+			Assembler a(rom_base);
+
+			const auto loop = a.new_label();
+
+			a.li(s0, 12345);
+			a.li(s1, 1664525);
+			a.li(s2, 1013904223);
+			a.li(s3, 1'500'000 * scale);
+			a.li(s11, 0);
+
+			a.bind(loop);
+			a.mul(s0, s0, s1);
+			a.add(s0, s0, s2);
+			a.srli(a1, s0, 20);
+			a.ori(a1, a1, 1);
+			a.divu(a2, s0, a1);
+			a.remu(a3, s0, a1);
+			a.div(a4, s0, a1);
+			a.rem(a5, s0, a1);
+			a.xor_(s11, s11, a2);
+			a.add(s11, s11, a3);
+			a.xor_(s11, s11, a4);
+			a.add(s11, s11, a5);
+			a.addi(s3, s3, -1);
+			a.bne(s3, zero, loop);
+
+			a.halt();
+
+			return a.finish();
+		}
+
+		/**
+		 * @brief A tight `ecall` loop combined with frequent machine timer interrupts
+		 *
+		 */
+		std::vector<u8> generate_trap_storm(u32 scale)
+		{
+			using enum Reg;
+			Assembler a(rom_base);
+
+			constexpr i32 timer_period = 200;
+
+			const auto start = a.new_label(), irq = a.new_label(), loop = a.new_label();
+
+			a.j(start);
+
+			// Trap handler, placed at `rom_base + 4`. Only uses t5/t6, which the main loop never touches.
+			const auto handler_address = a.current_address();
+			a.csrr(t5, csr_address::mcause);
+			a.blt(t5, zero, irq);
+			a.csrr(t6, csr_address::mepc);
+			a.addi(t6, t6, 4);
+			a.csrw(csr_address::mepc, t6);
+			a.addi(s10, s10, 1);
+			a.mret();
+
+			a.bind(irq);
+			a.lw(t5, s8, 0);  // timer.low
+			a.addi(t5, t5, timer_period);
+			a.sw(t5, s8, 8);  // comp.low
+			a.li(t6, 1 << 7);
+			a.csrc(csr_address::mip, t6);
+			a.addi(s9, s9, 1);
+			a.mret();
+
+			a.bind(start);
+			a.li(s8, clock_base);
+			a.li(t0, handler_address);
+			a.csrw(csr_address::mtvec, t0);
+			a.sw(zero, s8, 12);  // comp.high
+			a.li(t0, timer_period);
+			a.sw(t0, s8, 8);  // comp.low
+			a.li(t0, 1 << 7);
+			a.csrc(csr_address::mip, t0);
+			a.csrs(csr_address::mie, t0);
+			a.li(t0, 1 << 3);
+			a.csrs(csr_address::mstatus, t0);
+
+			a.li(s3, 2'000'000 * scale);
+			a.bind(loop);
+			a.ecall();
+			a.addi(s4, s4, 1);
+			a.xor_(s5, s5, s4);
+			a.addi(s3, s3, -1);
+			a.bne(s3, zero, loop);
+
+			// Disable interrupts, so the final `j .` is not interrupted
+			a.li(t0, 1 << 3);
+			a.csrc(csr_address::mstatus, t0);
+			a.halt();
+
+			return a.finish();
+		}
+
+		/**
+		 * @brief Prints a line repeatedly through the UART, polling the status register before every byte
+		 *
+		 */
+		std::vector<u8> generate_uart(u32 scale)
+		{
+			using enum Reg;
+			Assembler a(rom_base);
+
+			constexpr std::string_view message = "The quick brown fox jumps over the lazy dog 0123456789\n";
+
+			const auto outer = a.new_label(), next_char = a.new_label(), poll = a.new_label(),
+					   line_done = a.new_label();
+
+			// Copy the message (null-terminated) into RAM
+			a.li(s1, ram_base);
+			for (size_t i = 0; i < message.size(); i++)
+			{
+				a.li(t0, static_cast<u8>(message[i]));
+				a.sb(t0, s1, static_cast<i32>(i));
+			}
+			a.sb(zero, s1, static_cast<i32>(message.size()));
+
+			a.li(s0, uart_base);
+			a.li(s3, 5000 * scale);
+
+			a.bind(outer);
+			a.mv(t0, s1);
+			a.bind(next_char);
+			a.lbu(a0, t0, 0);
+			a.beq(a0, zero, line_done);
+			a.bind(poll);
+			a.lw(a1, s0, 12);  // STA
+			a.andi(a1, a1, 0b10);
+			a.beq(a1, zero, poll);
+			a.sb(a0, s0, 0);  // TX
+			a.addi(t0, t0, 1);
+			a.j(next_char);
+			a.bind(line_done);
+			a.addi(s3, s3, -1);
+			a.bne(s3, zero, outer);
+
+			a.halt();
+
+			return a.finish();
+		}
+
+		const std::array workloads = std::to_array<Workload>({
+			{.name = "integer",
+			 .description = "8x8 matrix multiply + CRC16 (CoreMark-like)",
+			 .generate = generate_integer},
+			{.name = "memcpy",
+			 .description = "64KiB word memset/memcpy + 4KiB byte copy",
+			 .generate = generate_memcpy},
+			{.name = "pointer-chase",
+			 .description = "Dependent loads over 4MiB with 64B stride",
+			 .generate = generate_pointer_chase},
+			{.name = "division",
+			 .description = "div/divu/rem/remu of pseudo-random operands",
+			 .generate = generate_division},
+			{.name = "trap-storm",
+			 .description = "ecall loop with a timer interrupt every 200 cycles",
+			 .generate = generate_trap_storm},
+			{.name = "uart", .description = "Polled UART printing", .generate = generate_uart},
+		});
+	}
+
+	std::span<const Workload> get_workloads()
+	{
+		return workloads;
+	}
+}
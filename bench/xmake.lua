@@ -0,0 +1,18 @@
+target("bench")
+	set_kind("binary")
+	set_languages("c++23")
+	set_default(false)
+
+	add_deps("core", "device", "main")
+	add_files("src/**.cpp")
+	add_includedirs("include")
+	add_packages("argparse")
+
+	-- Run the workloads on the `main` executable of the current build configuration
+	on_run(function (target)
+		import("core.base.option")
+
+		local emulator = path.absolute(target:dep("main"):targetfile())
+		local args = table.join({"--emulator=" .. emulator}, option.get("arguments") or {})
+		os.execv(target:targetfile(), args)
+	end)
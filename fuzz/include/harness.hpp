@@ -0,0 +1,123 @@
+#pragma once
+
+#include "machine/machine.hpp"
+
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <sstream>
+
+namespace fuzz
+{
+	/**
+	 * @brief Describes how the guest firmware is booted and fed with fuzz input
+	 *
+	 */
+	struct Harness_config
+	{
+		/**
+		 * @brief Path to the RAW BINARY flash file of the guest
+		 *
+		 */
+		std::filesystem::path flash_path;
+
+		/**
+		 * @brief PC at which the booted platform is snapshotted and every fuzz iteration starts
+		 * @note Snapshot is taken right after reset if not set
+		 */
+		std::optional<u32> entry;
+
+		/**
+		 * @brief Guest address of the input buffer
+		 * @note If set, the input is written there and passed in `a0` (address) and `a1` (size). If not set,
+		 * the input is fed to the UART RX instead.
+		 */
+		std::optional<u32> input_address;
+
+		/**
+		 * @brief Inputs longer than this are truncated
+		 *
+		 */
+		u32 max_input_size = 4096;
+
+		/**
+		 * @brief Maximum number of instructions executed before reaching `entry`
+		 *
+		 */
+		u64 boot_max_instructions = 100'000'000;
+
+		/**
+		 * @brief Maximum number of instructions executed per fuzz iteration
+		 *
+		 */
+		u64 max_instructions = 1'000'000;
+
+		/**
+		 * @brief Read the configuration from environment variables
+		 * @note `FUZZ_FLASH` (required), `FUZZ_ENTRY`, `FUZZ_INPUT_ADDR`, `FUZZ_INPUT_SIZE`, `FUZZ_MAX_INST`.
+		 * Numbers can be decimal or `0x` prefixed hexadecimal.
+		 *
+		 * @throws std::invalid_argument If `FUZZ_FLASH` is missing or a number is invalid
+		 */
+		static Harness_config from_environment();
+	};
+
+	/**
+	 * @brief Persistent-mode fuzzing harness, runs the guest from a snapshot of the booted platform for every
+	 * input
+	 *
+	 */
+	class Harness
+	{
+	  public:
+
+		/**
+		 * @brief Outcome of one fuzz iteration
+		 *
+		 */
+		enum class Outcome
+		{
+			Exit,           // Guest exited through the sim control device with code `0`
+			Infinite_loop,  // Guest stopped at an infinite loop, e.g. `j .`
+			Timeout,        // Instruction limit reached
+			Crash           // Guest raised an exception, or exited with a non-zero code
+		};
+
+		struct Run_result
+		{
+			Outcome outcome;
+			machine::Machine::Result last_result;  // Result of the last executed instruction
+			std::optional<u32> exit_code;          // Exit code requested by the guest, if any
+		};
+
+		/**
+		 * @brief Boot the guest up to the entry point and take the snapshot
+		 *
+		 * @param config Harness configuration
+		 * @param coverage_map Edge coverage counters of the guest, size must be a power of 2. Must outlive
+		 * this object.
+		 * @throws std::runtime_error If the flash file can't be loaded, or the entry point is not reached
+		 */
+		Harness(const Harness_config& config, std::span<u8> coverage_map);
+
+		/**
+		 * @brief Restore the snapshot, inject `input` and run until the guest stops
+		 *
+		 * @param input Fuzz input
+		 * @return Outcome of the iteration
+		 */
+		Run_result run(std::span<const u8> input);
+
+	  private:
+
+		Harness_config config;
+		machine::Machine machine;
+		machine::Machine::Snapshot snapshot;
+
+		std::istringstream uart_input;
+		std::ostream discarded_output{nullptr};  // Guest UART and console output is dropped
+
+		bool is_stop(const machine::Machine::Result& result);
+	};
+}
@@ -0,0 +1,136 @@
+#include "harness.hpp"
+
+#include <cstdlib>
+#include <format>
+
+namespace fuzz
+{
+	namespace
+	{
+		// Read a numeric environment variable, `std::nullopt` if not set
+		std::optional<u64> get_number(const char* name)
+		{
+			const char* value = std::getenv(name);
+			if (value == nullptr || *value == '\0') return std::nullopt;
+
+			try
+			{
+				size_t parsed_length;
+				const auto number = std::stoull(value, &parsed_length, 0);
+				if (value[parsed_length] != '\0') throw std::invalid_argument(value);
+
+				return number;
+			}
+			catch (const std::logic_error&)
+			{
+				throw std::invalid_argument(std::format("Invalid number in {}: {}", name, value));
+			}
+		}
+	}
+
+	Harness_config Harness_config::from_environment()
+	{
+		Harness_config config;
+
+		const char* flash_path = std::getenv("FUZZ_FLASH");
+		if (flash_path == nullptr || *flash_path == '\0')
+			throw std::invalid_argument("FUZZ_FLASH must be set to the path of the flash file");
+		config.flash_path = flash_path;
+
+		if (const auto entry = get_number("FUZZ_ENTRY")) config.entry = static_cast<u32>(*entry);
+		if (const auto address = get_number("FUZZ_INPUT_ADDR"))
+			config.input_address = static_cast<u32>(*address);
+		if (const auto size = get_number("FUZZ_INPUT_SIZE")) config.max_input_size = static_cast<u32>(*size);
+		if (const auto count = get_number("FUZZ_MAX_INST")) config.max_instructions = *count;
+
+		return config;
+	}
+
+	Harness::Harness(const Harness_config& config, std::span<u8> coverage_map) :
+		config(config),
+		machine(machine::Config{.ram_fill_policy = device::Fill_policy::Zero})
+	{
+		machine.load_flash_file(config.flash_path);
+		machine.get_uart().set_input_stream(uart_input);
+		machine.get_uart().set_output_stream(discarded_output);
+		machine.get_sim_control().set_output_stream(discarded_output);
+
+		if (config.entry.has_value() && machine.get_pc() != *config.entry)
+		{
+			const auto entry = *config.entry;
+			const auto reached = machine.run_until(
+				[this, entry](const auto&) { return machine.get_pc() == entry; },
+				config.boot_max_instructions
+			);
+
+			if (!reached.has_value())
+				throw std::runtime_error(
+					std::format(
+						"Entry point 0x{:08x} not reached in {} instructions",
+						entry,
+						config.boot_max_instructions
+					)
+				);
+		}
+
+		snapshot = machine.take_snapshot();
+
+		// Boot is the same for every input, only collect coverage of the fuzz iterations
+		machine.set_coverage_map(coverage_map);
+	}
+
+	bool Harness::is_stop(const machine::Machine::Result& result)
+	{
+		if (result.trap.has_value() && !core::is_interrupt(result.trap.value())
+			&& result.trap.value() != core::Trap::Env_call_from_M_mode)
+			return true;
+
+		// Only a store can execute a sim control command
+		if (result.memory_opcode == core::Load_store_module::Opcode::Store
+			&& machine.get_sim_control().get_exit_code().has_value())
+			return true;
+
+		return !result.trap.has_value() && result.pc == result.alu_result && result.branch_result;
+	}
+
+	Harness::Run_result Harness::run(std::span<const u8> input)
+	{
+		machine.restore_snapshot(snapshot);
+
+		input = input.first(std::min<size_t>(input.size(), config.max_input_size));
+
+		if (config.input_address.has_value())
+		{
+			// A failed write leaves the guest with a partial input, which is still a valid input
+			[[maybe_unused]] const auto _ = machine.write_memory(*config.input_address, input);
+			machine.set_register(10, *config.input_address);           // a0
+			machine.set_register(11, static_cast<u32>(input.size()));  // a1
+		}
+		else
+		{
+			uart_input.str(std::string(reinterpret_cast<const char*>(input.data()), input.size()));
+			uart_input.clear();
+		}
+
+		const auto stop = machine.run_until(
+			[this](const auto& result) { return is_stop(result); },
+			config.max_instructions
+		);
+
+		if (!stop.has_value()) return Run_result{.outcome = Outcome::Timeout, .last_result = {}};
+
+		const auto exit_code = machine.get_sim_control().get_exit_code();
+		Run_result run_result{
+			.outcome = Outcome::Infinite_loop,
+			.last_result = *stop,
+			.exit_code = exit_code
+		};
+
+		if (exit_code.has_value())
+			run_result.outcome = *exit_code == 0 ? Outcome::Exit : Outcome::Crash;
+		else if (stop->trap.has_value())
+			run_result.outcome = Outcome::Crash;
+
+		return run_result;
+	}
+}
@@ -0,0 +1,50 @@
+#include "core/print.hpp"
+#include "harness.hpp"
+
+#include <cstdlib>
+#include <memory>
+
+namespace
+{
+	/**
+	 * @brief Edge coverage counters of the guest
+	 * @note Placed in the section libFuzzer scans for extra counters, so guest edges guide the fuzzer in
+	 * addition to the coverage of the emulator itself
+	 */
+	__attribute__((section("__libfuzzer_extra_counters"))) u8 coverage_counters[64 * 1024];
+
+	std::unique_ptr<fuzz::Harness> harness;
+}
+
+extern "C" int LLVMFuzzerInitialize(int* argc [[maybe_unused]], char*** argv [[maybe_unused]])
+try
+{
+	harness = std::make_unique<fuzz::Harness>(fuzz::Harness_config::from_environment(), coverage_counters);
+	return 0;
+}
+catch (const std::exception& e)
+{
+	eprintln("Failed to initialize fuzzing harness: {}", e.what());
+	std::exit(1);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const u8* data, size_t size)
+{
+	const auto result = harness->run({data, size});
+	if (result.outcome != fuzz::Harness::Outcome::Crash) return 0;
+
+	const auto& last = result.last_result;
+
+	if (result.exit_code.has_value())
+		eprintln("Guest exited with code {} at PC: 0x{:08x}", *result.exit_code, last.pc);
+	else
+		eprintln(
+			"Exception at PC: 0x{:08x} (Inst=0x{:08x}). Trap code: {}",
+			last.pc,
+			last.inst,
+			(u16)last.trap.value() & 0x0fff
+		);
+
+	// Let libFuzzer save the input as a crash
+	std::abort();
+}
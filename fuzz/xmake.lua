@@ -0,0 +1,13 @@
+target("fuzz")
+	set_kind("binary")
+	set_languages("c++23")
+	set_default(false)
+	set_toolchains("clang")
+
+	add_deps("core", "device", "machine")
+	add_files("src/**.cpp")
+	add_includedirs("include")
+
+	-- libFuzzer provides `main()`, and picks up the guest coverage through the extra counters section
+	add_cxflags("-fsanitize=fuzzer")
+	add_ldflags("-fsanitize=fuzzer")
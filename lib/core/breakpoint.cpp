@@ -0,0 +1,26 @@
+#include "core/breakpoint.hpp"
+
+namespace core
+{
+	bool Breakpoint_set::insert(u32 address)
+	{
+		auto& bitmap = pages[address / page_size_bytes];
+		const auto slot = get_slot(address);
+
+		if (bitmap.test(slot)) return false;
+
+		bitmap.set(slot);
+		return true;
+	}
+
+	bool Breakpoint_set::erase(u32 address)
+	{
+		const auto find = pages.find(address / page_size_bytes);
+		if (find == pages.end() || !find->second.test(get_slot(address))) return false;
+
+		find->second.reset(get_slot(address));
+		if (find->second.none()) pages.erase(find);
+
+		return true;
+	}
+}
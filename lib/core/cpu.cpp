@@ -1,7 +1,27 @@
 #include "core/cpu.hpp"
 
+#include <array>
+#include <bit>
+
 namespace core
 {
+	// Lines of the standard interrupts, in decreasing priority
+	static constexpr std::array<u32, 6> interrupt_priority = {11, 3, 7, 9, 1, 5};
+
+	/**
+	 * @brief Get the interrupt to take among the pending and enabled ones
+	 * @note Lines other than the standard ones come after them, the lowest line first.
+	 *
+	 * @param interrupt Pending and enabled interrupt lines, not `0`
+	 */
+	static Trap get_interrupt(u32 interrupt) noexcept
+	{
+		for (const auto line : interrupt_priority)
+			if (interrupt & (u32(1) << line)) return static_cast<Trap>(0x80000000 | line);
+
+		return static_cast<Trap>(0x80000000 | std::countr_zero(interrupt));
+	}
+
 	CPU_module::Result CPU_module::execute()
 	{
 		CPU_module::Result result;
@@ -38,16 +58,19 @@ namespace core
 			return result;
 		}
 
+		if (result.ebreak)
+		{
+			result.trap = Trap::Breakpoint;
+			return result;
+		}
+
 		if (csr.mstatus.mie)
 		{
 			const auto interrupt = csr.mip.value & csr.mie.value;
 			if (interrupt != 0)
 			{
-				if (interrupt & (1 << 7))
-				{
-					result.trap = Trap::Machine_timer_interrupt;
-					return result;
-				}
+				result.trap = get_interrupt(interrupt);
+				return result;
 			}
 		}
 
@@ -111,6 +134,9 @@ namespace core
 		else
 			pc += 4;
 
+		if (!coverage_map.empty() && result.branch_opcode != Branch_module::Opcode::None) [[unlikely]]
+			record_edge(pc);
+
 		return result;
 	}
 
@@ -1,350 +1,287 @@
 #include "core/decode.hpp"
 #include "core/alu.hpp"
-#include "core/inst.hpp"
+
+#include <array>
+#include <stdexcept>
 
 namespace core
 {
-	enum class Opcode : u8
-	{
-		Lui = 0b01101,
-		Auipc = 0b00101,
-		Jal = 0b11011,
-		Jalr = 0b11001,
-		Branch = 0b11000,
-		Load = 0b00000,
-		Store = 0b01000,
-		Reg_imm_arithmetic = 0b00100,
-		Reg_reg_arithmetic = 0b01100,
-		Misc_mem = 0b00011,
-		System = 0b11100
-	};
-
-	static Inst_decode_module::Result decode_lui(Bitset<32> instr) noexcept
+	static constexpr Inst_decode_module::Result alu_preset(ALU_module::Opcode opcode) noexcept
 	{
-		const inst::Utype utype(instr);
-
-		return Inst_decode_module::Result{
-			.writeback_source = Register_source::Alu,
-			.dest_register = utype.rd,
-			.alu_opcode = ALU_module::Opcode::Add,
-			.alu_num1 = static_cast<u32>(utype.imm),
-			.alu_num2 = 0,
-		};
-	}
-
-	static Inst_decode_module::Result decode_auipc(Bitset<32> instr, u32 pc) noexcept
-	{
-		const inst::Utype utype(instr);
-
-		return Inst_decode_module::Result{
-			.writeback_source = Register_source::Alu,
-			.dest_register = utype.rd,
-			.alu_opcode = ALU_module::Opcode::Add,
-			.alu_num1 = pc,
-			.alu_num2 = static_cast<u32>(utype.imm),
-		};
+		return {.writeback_source = Register_source::Alu, .alu_opcode = opcode};
 	}
 
-	static Inst_decode_module::Result decode_jal(Bitset<32> instr, u32 pc) noexcept
+	// Link to `PC` + 4, and branch to the ALU result unconditionally
+	static constexpr Inst_decode_module::Result jump_preset() noexcept
 	{
-		const inst::Jtype jtype(instr);
-
-		return Inst_decode_module::Result{
+		return {
 			.writeback_source = Register_source::Pc_plus_4,
-			.dest_register = jtype.rd,
 			.alu_opcode = ALU_module::Opcode::Add,
-			.alu_num1 = pc,
-			.alu_num2 = static_cast<u32>(jtype.imm),
-			.branch_opcode = Branch_module::Opcode::Eq,
-			.branch_num1 = 0,
-			.branch_num2 = 0,
+			.branch_opcode = Branch_module::Opcode::Eq
 		};
 	}
 
-	static Inst_decode_module::Result decode_jalr(
-		const Register_file_module& registers,
-		Bitset<32> instr
-	) noexcept
+	static constexpr Inst_decode_module::Result branch_preset(Branch_module::Opcode opcode) noexcept
 	{
-		const inst::Itype itype(instr);
-
-		return Inst_decode_module::Result{
-			.writeback_source = Register_source::Pc_plus_4,
-			.dest_register = itype.rd,
-			.alu_opcode = ALU_module::Opcode::Add,
-			.alu_num1 = registers.get_register(itype.rs1),
-			.alu_num2 = static_cast<u32>(itype.imm),
-			.branch_opcode = Branch_module::Opcode::Eq,
-			.branch_num1 = 0,
-			.branch_num2 = 0,
-		};
+		return {.alu_opcode = ALU_module::Opcode::Add, .branch_opcode = opcode};
 	}
 
-	static Inst_decode_module::Result decode_load(
-		const Register_file_module& registers,
-		Bitset<32> instr
-	) noexcept
+	static constexpr Inst_decode_module::Result load_preset(Load_store_module::Funct funct) noexcept
 	{
-		const inst::Itype itype(instr);
-
-		constexpr std::array memory_opcode_list = std::to_array(
-			{Load_store_module::Funct::Load_byte,      // 000
-			 Load_store_module::Funct::Load_halfword,  // 001
-			 Load_store_module::Funct::Load_word,      // 010
-			 Load_store_module::Funct::None,
-			 Load_store_module::Funct::Load_byte_unsigned,      // 100
-			 Load_store_module::Funct::Load_halfword_unsigned,  // 101
-			 Load_store_module::Funct::None,
-			 Load_store_module::Funct::None}
-		);
-
-		return Inst_decode_module::Result{
+		return {
 			.writeback_source = Register_source::Memory,
-			.dest_register = itype.rd,
 			.alu_opcode = ALU_module::Opcode::Add,
-			.alu_num1 = registers.get_register(itype.rs1),
-			.alu_num2 = static_cast<u32>(itype.imm),
 			.memory_opcode = Load_store_module::Opcode::Load,
-			.memory_funct = memory_opcode_list[static_cast<size_t>(itype.funct3)],
+			.memory_funct = funct
 		};
 	}
 
-	static Inst_decode_module::Result decode_store(
-		const Register_file_module& registers,
-		Bitset<32> instr
-	) noexcept
+	static constexpr Inst_decode_module::Result store_preset(Load_store_module::Funct funct) noexcept
 	{
-		const inst::Stype stype(instr);
-
-		Load_store_module::Funct memory_funct;
-
-		switch (static_cast<u8>(stype.funct3))
-		{
-		case 0b000:
-			memory_funct = Load_store_module::Funct::Store_byte;
-			break;
-		case 0b001:
-			memory_funct = Load_store_module::Funct::Store_halfword;
-			break;
-		case 0b010:
-			memory_funct = Load_store_module::Funct::Store_word;
-			break;
-		default:
-			memory_funct = Load_store_module::Funct::None;
-			break;
-		}
-
-		return Inst_decode_module::Result{
-			.writeback_source = Register_source::None,
+		return {
 			.alu_opcode = ALU_module::Opcode::Add,
-			.alu_num1 = registers.get_register(stype.rs1),
-			.alu_num2 = static_cast<u32>(stype.imm),
 			.memory_opcode = Load_store_module::Opcode::Store,
-			.memory_funct = memory_funct,
-			.memory_store_value = registers.get_register(stype.rs2),
+			.memory_funct = funct
 		};
 	}
 
-	static Inst_decode_module::Result decode_register_imm(
-		const Register_file_module& registers,
-		Bitset<32> instr
-	) noexcept
+	// `read` is completed by the handler, CSRRW only reads if `rd` is not `x0`
+	static constexpr Inst_decode_module::Result csr_preset(CSR_write_mode write_mode, bool read) noexcept
 	{
-		const inst::Itype itype(instr);
-
-		const std::array opcode = std::to_array(
-			{ALU_module::Opcode::Add,
-			 ALU_module::Opcode::Sll,
-			 ALU_module::Opcode::Slt,
-			 ALU_module::Opcode::Sltu,
-			 ALU_module::Opcode::Xor,
-			 instr.take_bit<30>() ? ALU_module::Opcode::Sra : ALU_module::Opcode::Srl,
-			 ALU_module::Opcode::Or,
-			 ALU_module::Opcode::And}
-		);
-
-		return Inst_decode_module::Result{
-			.writeback_source = Register_source::Alu,
-			.dest_register = itype.rd,
-			.alu_opcode = opcode[static_cast<size_t>(itype.funct3)],
-			.alu_num1 = registers.get_register(itype.rs1),
-			.alu_num2 = static_cast<u32>(itype.imm),
+		return {
+			.writeback_source = Register_source::Csr,
+			.csr_access_info = {.write_mode = write_mode, .read = read}
 		};
 	}
 
-	static std::expected<Inst_decode_module::Result, Trap> decode_register_register(
-		const Register_file_module& registers,
-		Bitset<32> instr
-	) noexcept
+	static constexpr auto inst_descriptors = []
 	{
-		const inst::Rtype rtype(instr);
+		using enum Inst_format;
+		using enum Operand_layout;
+		using Alu = ALU_module::Opcode;
+		using Branch_op = Branch_module::Opcode;
+		using Mem = Load_store_module::Funct;
+
+		return std::to_array<Inst_descriptor>({
+			// RV32I
+			{"lui",       0x0000007f, 0x00000037, U, Upper,    alu_preset(Alu::Add)                        },
+			{"auipc",     0x0000007f, 0x00000017, U, Upper_pc, alu_preset(Alu::Add)                        },
+			{"jal",       0x0000007f, 0x0000006f, J, Jump,     jump_preset()                               },
+			{"jalr",      0x0000707f, 0x00000067, I, Reg_imm,  jump_preset()                               },
+			{"beq",       0x0000707f, 0x00000063, B, Branch,   branch_preset(Branch_op::Eq)                },
+			{"bne",       0x0000707f, 0x00001063, B, Branch,   branch_preset(Branch_op::Ne)                },
+			{"blt",       0x0000707f, 0x00004063, B, Branch,   branch_preset(Branch_op::Lt)                },
+			{"bge",       0x0000707f, 0x00005063, B, Branch,   branch_preset(Branch_op::Ge)                },
+			{"bltu",      0x0000707f, 0x00006063, B, Branch,   branch_preset(Branch_op::Ltu)               },
+			{"bgeu",      0x0000707f, 0x00007063, B, Branch,   branch_preset(Branch_op::Geu)               },
+			{"lb",        0x0000707f, 0x00000003, I, Reg_imm,  load_preset(Mem::Load_byte)                 },
+			{"lh",        0x0000707f, 0x00001003, I, Reg_imm,  load_preset(Mem::Load_halfword)             },
+			{"lw",        0x0000707f, 0x00002003, I, Reg_imm,  load_preset(Mem::Load_word)                 },
+			{"lbu",       0x0000707f, 0x00004003, I, Reg_imm,  load_preset(Mem::Load_byte_unsigned)        },
+			{"lhu",       0x0000707f, 0x00005003, I, Reg_imm,  load_preset(Mem::Load_halfword_unsigned)    },
+			{"sb",        0x0000707f, 0x00000023, S, Store,    store_preset(Mem::Store_byte)               },
+			{"sh",        0x0000707f, 0x00001023, S, Store,    store_preset(Mem::Store_halfword)           },
+			{"sw",        0x0000707f, 0x00002023, S, Store,    store_preset(Mem::Store_word)               },
+			{"addi",      0x0000707f, 0x00000013, I, Reg_imm,  alu_preset(Alu::Add)                        },
+			{"slti",      0x0000707f, 0x00002013, I, Reg_imm,  alu_preset(Alu::Slt)                        },
+			{"sltiu",     0x0000707f, 0x00003013, I, Reg_imm,  alu_preset(Alu::Sltu)                       },
+			{"xori",      0x0000707f, 0x00004013, I, Reg_imm,  alu_preset(Alu::Xor)                        },
+			{"ori",       0x0000707f, 0x00006013, I, Reg_imm,  alu_preset(Alu::Or)                         },
+			{"andi",      0x0000707f, 0x00007013, I, Reg_imm,  alu_preset(Alu::And)                        },
+			{"slli",      0xfe00707f, 0x00001013, I, Reg_imm,  alu_preset(Alu::Sll)                        },
+			{"srli",      0xfe00707f, 0x00005013, I, Reg_imm,  alu_preset(Alu::Srl)                        },
+			{"srai",      0xfe00707f, 0x40005013, I, Reg_imm,  alu_preset(Alu::Sra)                        },
+			{"add",       0xfe00707f, 0x00000033, R, Reg_reg,  alu_preset(Alu::Add)                        },
+			{"sub",       0xfe00707f, 0x40000033, R, Reg_reg,  alu_preset(Alu::Sub)                        },
+			{"sll",       0xfe00707f, 0x00001033, R, Reg_reg,  alu_preset(Alu::Sll)                        },
+			{"slt",       0xfe00707f, 0x00002033, R, Reg_reg,  alu_preset(Alu::Slt)                        },
+			{"sltu",      0xfe00707f, 0x00003033, R, Reg_reg,  alu_preset(Alu::Sltu)                       },
+			{"xor",       0xfe00707f, 0x00004033, R, Reg_reg,  alu_preset(Alu::Xor)                        },
+			{"srl",       0xfe00707f, 0x00005033, R, Reg_reg,  alu_preset(Alu::Srl)                        },
+			{"sra",       0xfe00707f, 0x40005033, R, Reg_reg,  alu_preset(Alu::Sra)                        },
+			{"or",        0xfe00707f, 0x00006033, R, Reg_reg,  alu_preset(Alu::Or)                         },
+			{"and",       0xfe00707f, 0x00007033, R, Reg_reg,  alu_preset(Alu::And)                        },
+			{"ecall",     0xffffffff, 0x00000073, I, None,     {.ecall = true}                             },
+			{"ebreak",    0xffffffff, 0x00100073, I, None,     {.ebreak = true}                            },
+			{"mret",      0xffffffff, 0x30200073, I, None,     {.mret = true}                              },
+
+			// Zifencei
+			{"fence.i",   0x0000707f, 0x0000100f, I, None,     {.fencei = true}                            },
+
+			// Zicsr
+			{"csrrw",     0x0000707f, 0x00001073, I, Csr_reg,  csr_preset(CSR_write_mode::Overwrite, false)},
+			{"csrrs",     0x0000707f, 0x00002073, I, Csr_reg,  csr_preset(CSR_write_mode::Set, true)       },
+			{"csrrc",     0x0000707f, 0x00003073, I, Csr_reg,  csr_preset(CSR_write_mode::Clear, true)     },
+			{"csrrwi",    0x0000707f, 0x00005073, I, Csr_imm,  csr_preset(CSR_write_mode::Overwrite, false)},
+			{"csrrsi",    0x0000707f, 0x00006073, I, Csr_imm,  csr_preset(CSR_write_mode::Set, true)       },
+			{"csrrci",    0x0000707f, 0x00007073, I, Csr_imm,  csr_preset(CSR_write_mode::Clear, true)     },
+
+			// RV32M
+			{"mul",       0xfe00707f, 0x02000033, R, Reg_reg,  alu_preset(Alu::Mul)                        },
+			{"mulh",      0xfe00707f, 0x02001033, R, Reg_reg,  alu_preset(Alu::Mulh)                       },
+			{"mulhsu",    0xfe00707f, 0x02002033, R, Reg_reg,  alu_preset(Alu::Mulhsu)                     },
+			{"mulhu",     0xfe00707f, 0x02003033, R, Reg_reg,  alu_preset(Alu::Mulhu)                      },
+			{"div",       0xfe00707f, 0x02004033, R, Reg_reg,  alu_preset(Alu::Div)                        },
+			{"divu",      0xfe00707f, 0x02005033, R, Reg_reg,  alu_preset(Alu::Divu)                       },
+			{"rem",       0xfe00707f, 0x02006033, R, Reg_reg,  alu_preset(Alu::Rem)                        },
+			{"remu",      0xfe00707f, 0x02007033, R, Reg_reg,  alu_preset(Alu::Remu)                       },
+
+			// Zicond
+			{"czero.eqz", 0xfe00707f, 0x0e005033, R, Reg_reg,  alu_preset(Alu::Czero_eqz)                  },
+			{"czero.nez", 0xfe00707f, 0x0e007033, R, Reg_reg,  alu_preset(Alu::Czero_nez)                  },
+		});
+	}();
+
+	// No instruction word matches two descriptors
+	static_assert(
+		[]
+		{
+			for (size_t i = 0; i < inst_descriptors.size(); i++)
+				for (size_t j = i + 1; j < inst_descriptors.size(); j++)
+				{
+					const auto& a = inst_descriptors[i];
+					const auto& b = inst_descriptors[j];
+					if (((a.match ^ b.match) & a.mask & b.mask) == 0) return false;
+				}
+
+			return true;
+		}(),
+		"Overlapping instruction encodings"
+	);
+
+	// Bits that select the slot of an instruction: the major opcode (bits 6..2), `funct3` (bits 14..12), and
+	// the bits of `funct7` and `funct12` that tell apart the instructions sharing both
+	static constexpr auto slot_bits = std::to_array<u8>({2, 3, 4, 5, 6, 12, 13, 14, 20, 25, 27, 28, 30});
+	static constexpr u8 no_descriptor = 0xff;
+
+	static constexpr size_t get_slot_index(u32 instr) noexcept
+	{
+		return ((instr >> 2) & 0x1f)
+			 | ((instr >> 7) & 0xe0)
+			 | ((instr >> 12) & 0x100)
+			 | ((instr >> 16) & 0x200)
+			 | ((instr >> 17) & 0xc00)
+			 | ((instr >> 18) & 0x1000);
+	}
 
-		ALU_module::Opcode opcode;
-		const u8 funct7_select = static_cast<u8>(rtype.funct7.slice<2, 0>());
+	// Index of the only descriptor that may match the instructions of each slot
+	static constexpr auto decode_slots = []
+	{
+		u32 slot_mask = 0;
+		for (const auto bit : slot_bits) slot_mask |= 1u << bit;
 
-		switch (funct7_select)
-		{
-		case 0b000:  // RV32I
-			opcode = std::to_array(
-				{instr.take_bit<30>() ? ALU_module::Opcode::Sub : ALU_module::Opcode::Add,
-				 ALU_module::Opcode::Sll,
-				 ALU_module::Opcode::Slt,
-				 ALU_module::Opcode::Sltu,
-				 ALU_module::Opcode::Xor,
-				 instr.take_bit<30>() ? ALU_module::Opcode::Sra : ALU_module::Opcode::Srl,
-				 ALU_module::Opcode::Or,
-				 ALU_module::Opcode::And}
-			)[static_cast<size_t>(rtype.funct3)];
-			break;
-
-		case 0b001:  // RV32M
-			opcode = std::to_array(
-				{ALU_module::Opcode::Mul,
-				 ALU_module::Opcode::Mulh,
-				 ALU_module::Opcode::Mulhsu,
-				 ALU_module::Opcode::Mulhu,
-				 ALU_module::Opcode::Div,
-				 ALU_module::Opcode::Divu,
-				 ALU_module::Opcode::Rem,
-				 ALU_module::Opcode::Remu}
-			)[static_cast<size_t>(rtype.funct3)];
-			break;
-
-		case 0b111:  // Zicond
+		std::array<u8, 1 << slot_bits.size()> slots;
+		slots.fill(no_descriptor);
+
+		for (size_t index = 0; index < slots.size(); index++)
 		{
-			switch (static_cast<u8>(rtype.funct3))
+			u32 instr = 0;
+			for (size_t i = 0; i < slot_bits.size(); i++) instr |= u32((index >> i) & 1) << slot_bits[i];
+
+			// Not a constant expression, fails the compilation
+			if (get_slot_index(instr) != index) throw std::logic_error("Slot index doesn't match the bits");
+
+			for (size_t i = 0; i < inst_descriptors.size(); i++)
 			{
-			case 0b101:
-				opcode = ALU_module::Opcode::Czero_eqz;
-				break;
-			case 0b111:
-				opcode = ALU_module::Opcode::Czero_nez;
-				break;
-			default:
-				return std::unexpected(Trap::Illegal_instruction);
+				const auto& descriptor = inst_descriptors[i];
+				if (((instr ^ descriptor.match) & descriptor.mask & slot_mask) != 0) continue;
+
+				// Not a constant expression, add a bit to `slot_bits` that tells the descriptors apart
+				if (slots[index] != no_descriptor) throw std::logic_error("Decode slot is ambiguous");
+				slots[index] = static_cast<u8>(i);
 			}
-			break;
 		}
 
-		default:
-			return std::unexpected(Trap::Illegal_instruction);
-		}
+		return slots;
+	}();
 
-		return Inst_decode_module::Result{
-			.writeback_source = Register_source::Alu,
-			.dest_register = rtype.rd,
-			.alu_opcode = opcode,
-			.alu_num1 = registers.get_register(rtype.rs1),
-			.alu_num2 = registers.get_register(rtype.rs2),
-		};
-	}
+	static_assert(inst_descriptors.size() < no_descriptor);
 
-	static Inst_decode_module::Result decode_branch(
-		const Register_file_module& registers,
-		Bitset<32> instr,
-		u32 pc
-	) noexcept
+	static constexpr const Inst_descriptor* find_descriptor(u32 instr) noexcept
 	{
-		const inst::Btype btype(instr);
-
-		const std::array opcode = std::to_array(
-			{Branch_module::Opcode::Eq,
-			 Branch_module::Opcode::Ne,
-			 Branch_module::Opcode::None,
-			 Branch_module::Opcode::None,
-			 Branch_module::Opcode::Lt,
-			 Branch_module::Opcode::Ge,
-			 Branch_module::Opcode::Ltu,
-			 Branch_module::Opcode::Geu}
-		);
-
-		return Inst_decode_module::Result{
-			.writeback_source = Register_source::None,
-			.alu_opcode = ALU_module::Opcode::Add,
-			.alu_num1 = pc,
-			.alu_num2 = static_cast<u32>(btype.imm),
-			.branch_opcode = opcode[static_cast<size_t>(btype.funct3)],
-			.branch_num1 = registers.get_register(btype.rs1),
-			.branch_num2 = registers.get_register(btype.rs2),
-		};
+		const auto index = decode_slots[get_slot_index(instr)];
+		if (index == no_descriptor) return nullptr;
+
+		const auto& descriptor = inst_descriptors[index];
+		return (instr & descriptor.mask) == descriptor.match ? &descriptor : nullptr;
 	}
 
-	static std::expected<Inst_decode_module::Result, Trap> decode_misc_mem(Bitset<32> instr) noexcept
+	static_assert(find_descriptor(0x00000013)->name == "addi");     // nop
+	static_assert(find_descriptor(0x40a5d533)->name == "sra");      // sra a0, a1, a0
+	static_assert(find_descriptor(0x02b50533)->name == "mul");      // mul a0, a0, a1
+	static_assert(find_descriptor(0x0000006f)->name == "jal");      // j .
+	static_assert(find_descriptor(0x0000000f) == nullptr);          // fence, not supported
+	static_assert(find_descriptor(0x00002063) == nullptr);          // Reserved branch
+	static_assert(find_descriptor(0x00000001) == nullptr);          // RV32C
+
+	/**
+	 * @brief Value selected for an operand of the decode result
+	 *
+	 */
+	enum class Operand_source : u8
 	{
-		const inst::Itype itype(instr);
+		Zero,
+		Rs1,       // Value of register `rs1`
+		Rs2,       // Value of register `rs2`
+		Pc,        // Current `PC`
+		Imm,       // Immediate of the format of the instruction
+		Rs1_field  // The `rs1` field, as a zero-extended immediate
+	};
 
-		if (itype.funct3 == 0b001) return Inst_decode_module::Result{.fencei = true};
+	/**
+	 * @brief Sources of the operands of a layout, see `Operand_layout`
+	 *
+	 */
+	struct Operand_sources
+	{
+		u32 rd_mask;  // `0x1f` if the layout writes `rd`
+		Operand_source alu_num1, alu_num2, branch_num1, branch_num2, store_value, csr_write_value;
+	};
 
-		return std::unexpected(Trap::Illegal_instruction);
+	// Indexed by `Operand_layout`
+	static constexpr auto operand_sources = []
+	{
+		using enum Operand_source;
+
+		return std::to_array<Operand_sources>({
+			{0x00, Zero, Zero, Zero, Zero, Zero, Zero     }, // None
+			{0x1f, Imm,  Zero, Zero, Zero, Zero, Zero     }, // Upper
+			{0x1f, Pc,   Imm,  Zero, Zero, Zero, Zero     }, // Upper_pc
+			{0x1f, Pc,   Imm,  Zero, Zero, Zero, Zero     }, // Jump
+			{0x1f, Rs1,  Imm,  Zero, Zero, Zero, Zero     }, // Reg_imm
+			{0x1f, Rs1,  Rs2,  Zero, Zero, Zero, Zero     }, // Reg_reg
+			{0x00, Rs1,  Imm,  Zero, Zero, Rs2,  Zero     }, // Store
+			{0x00, Pc,   Imm,  Rs1,  Rs2,  Zero, Zero     }, // Branch
+			{0x1f, Zero, Zero, Zero, Zero, Zero, Rs1      }, // Csr_reg
+			{0x1f, Zero, Zero, Zero, Zero, Zero, Rs1_field}, // Csr_imm
+		});
+	}();
+
+	static_assert(operand_sources.size() == static_cast<size_t>(Operand_layout::Csr_imm) + 1);
+
+	// Immediates of all formats, indexed by `Inst_format`
+	static constexpr std::array<u32, 6> get_immediates(u32 instr) noexcept
+	{
+		using enum Inst_format;
+
+		return {
+			0,
+			get_immediate(I, instr),
+			get_immediate(S, instr),
+			get_immediate(B, instr),
+			get_immediate(U, instr),
+			get_immediate(J, instr)
+		};
 	}
 
-	static std::expected<Inst_decode_module::Result, Trap> decode_system(
-		const Register_file_module& registers,
-		Bitset<32> instr
-	) noexcept
+	const Inst_descriptor* find_inst_descriptor(u32 instr) noexcept
 	{
-		const inst::Itype itype(instr);
-
-		Inst_decode_module::Result result;
-
-		if (itype.funct3 == 0b000)
-		{
-			switch (static_cast<u16>(itype.imm))
-			{
-			case 0b000000000000:  // ecall
-				result.ecall = true;
-				break;
-			case 0b001100000010:  // mret
-				result.mret = true;
-				break;
-			default:
-				return std::unexpected(Trap::Illegal_instruction);
-			}
-			return result;
-		}
-
-		switch (static_cast<u8>(itype.funct3))
-		{
-		case 0b001:  // csrrw
-		case 0b010:  // csrrs
-		case 0b011:  // csrrc
-		case 0b101:  // csrrwi
-		case 0b110:  // csrrsi
-		case 0b111:  // csrrci
-			result.writeback_source = Register_source::Csr;
-			break;
-		default:
-			return std::unexpected(Trap::Illegal_instruction);
-		}
-
-		const bool csr_do_write = itype.rs1 != 0;
-
-		result.csr_access_info.address = itype.imm.slice<11, 0>();
-		result.csr_access_info.write_value = itype.funct3.take_bit<2>()
-											   ? static_cast<u32>(itype.rs1.sext<32>())
-											   : registers.get_register(itype.rs1);
-		result.dest_register = itype.rd;
-
-		switch (static_cast<u8>(itype.funct3.slice<1, 0>()))
-		{
-		case 0b01:  // csrrw csrrwi
-			result.csr_access_info.write_mode
-				= csr_do_write ? CSR_write_mode::Overwrite : CSR_write_mode::None;
-			result.csr_access_info.read = itype.rd != 0;
-			break;
-		case 0b10:  // csrrs csrrsi
-			result.csr_access_info.write_mode = csr_do_write ? CSR_write_mode::Set : CSR_write_mode::None;
-			result.csr_access_info.read = true;  // [INFO] CSRRS & CSRRSI always read
-			break;
-		case 0b11:  // csrrc csrrci
-			result.csr_access_info.write_mode = csr_do_write ? CSR_write_mode::Clear : CSR_write_mode::None;
-			result.csr_access_info.read = true;  // [INFO] CSRRC & CSRRCI always read
-			break;
-		default:
-			return std::unexpected(Trap::Illegal_instruction);
-		}
+		return find_descriptor(instr);
+	}
 
-		return result;
+	std::span<const Inst_descriptor> get_inst_descriptors() noexcept
+	{
+		return inst_descriptors;
 	}
 
 	std::expected<Inst_decode_module::Result, Trap> Inst_decode_module::operator()(
@@ -353,41 +290,45 @@ namespace core
 		u32 pc
 	) noexcept
 	{
-		const Bitset<32> instr_bitset(instr);
+		const auto* descriptor = find_descriptor(instr);
+		if (descriptor == nullptr) [[unlikely]]
+			return std::unexpected(Trap::Illegal_instruction);
 
-		const Bitset<5> opcode = instr_bitset.slice<6, 2>();
-		const Bitset<2> len = instr_bitset.slice<1, 0>();
+		const u32 rd = (instr >> 7) & 0x1f;
+		const u32 rs1 = (instr >> 15) & 0x1f;
+		const auto& sources = operand_sources[static_cast<size_t>(descriptor->operands)];
+
+		// All operands are computed and selected by the layout, no branch depends on the instruction kind
+		const std::array<u32, 6> values = {
+			0,
+			registers.get_register(rs1),
+			registers.get_register((instr >> 20) & 0x1f),
+			pc,
+			get_immediates(instr)[static_cast<size_t>(descriptor->format)],
+			rs1
+		};
 
-		// Detect RV32C
-		if (len != 0b11) [[unlikely]]
-			return std::unexpected(Trap::Illegal_instruction);
+		Result result = descriptor->preset;
+		result.dest_register = rd & sources.rd_mask;
+		result.alu_num1 = values[static_cast<size_t>(sources.alu_num1)];
+		result.alu_num2 = values[static_cast<size_t>(sources.alu_num2)];
+		result.branch_num1 = values[static_cast<size_t>(sources.branch_num1)];
+		result.branch_num2 = values[static_cast<size_t>(sources.branch_num2)];
+		result.memory_store_value = values[static_cast<size_t>(sources.store_value)];
 
-		switch (static_cast<Opcode>(opcode))
+		if (result.writeback_source == Register_source::Csr) [[unlikely]]
 		{
-		case Opcode::Lui:
-			return decode_lui(instr_bitset);
-		case Opcode::Auipc:
-			return decode_auipc(instr_bitset, pc);
-		case Opcode::Jal:
-			return decode_jal(instr_bitset, pc);
-		case Opcode::Jalr:
-			return decode_jalr(registers, instr_bitset);
-		case Opcode::Load:
-			return decode_load(registers, instr_bitset);
-		case Opcode::Store:
-			return decode_store(registers, instr_bitset);
-		case Opcode::Reg_imm_arithmetic:
-			return decode_register_imm(registers, instr_bitset);
-		case Opcode::Reg_reg_arithmetic:
-			return decode_register_register(registers, instr_bitset);
-		case Opcode::Branch:
-			return decode_branch(registers, instr_bitset, pc);
-		case Opcode::Misc_mem:
-			return decode_misc_mem(instr_bitset);
-		case Opcode::System:
-			return decode_system(registers, instr_bitset);
-		default:
-			return std::unexpected(Trap::Illegal_instruction);
+			auto& csr = result.csr_access_info;
+
+			csr.address = instr >> 20;
+			csr.write_value = values[static_cast<size_t>(sources.csr_write_value)];
+
+			// Setting or clearing no bits doesn't write, but overwriting with `x0` or `0` does
+			if (rs1 == 0 && csr.write_mode != CSR_write_mode::Overwrite)
+				csr.write_mode = CSR_write_mode::None;
+			csr.read = csr.read || rd != 0;
 		}
+
+		return result;
 	}
-}
\ No newline at end of file
+}
@@ -1,5 +1,8 @@
 #include "core/memory.hpp"
 
+#include <algorithm>
+#include <bit>
+
 namespace core
 {
 	static bool is_aligned(u32 address, Load_store_module::Funct funct)
@@ -22,6 +25,49 @@ namespace core
 		}
 	}
 
+	std::expected<void, Memory_interface::Error> Memory_interface::read_block(u64 address, std::span<u8> data)
+	{
+		size_t done = 0;
+
+		while (done < data.size())
+		{
+			const auto word = read((address + done) & ~u64(3));
+			if (!word) return std::unexpected(word.error());
+
+			const auto bytes = std::bit_cast<std::array<u8, 4>>(word.value());
+			for (auto offset = (address + done) % 4; offset < 4 && done < data.size(); offset++)
+				data[done++] = bytes[offset];
+		}
+
+		return {};
+	}
+
+	std::expected<void, Memory_interface::Error> Memory_interface::write_block(
+		u64 address,
+		std::span<const u8> data
+	)
+	{
+		size_t done = 0;
+
+		while (done < data.size())
+		{
+			const auto word_address = (address + done) & ~u64(3);
+
+			std::array<u8, 4> bytes{};
+			u8 mask = 0;
+			for (auto offset = (address + done) % 4; offset < 4 && done < data.size(); offset++)
+			{
+				bytes[offset] = data[done++];
+				mask |= 1 << offset;
+			}
+
+			const auto result = write(word_address, std::bit_cast<u32>(bytes), mask);
+			if (!result) return result;
+		}
+
+		return {};
+	}
+
 	std::expected<u32, Trap> Load_store_module::operator()(
 		Memory_interface& interface,
 		Opcode opcode,
@@ -130,6 +176,30 @@ namespace core
 		}
 	}
 
+	// Patch the breakpoints inside a freshly loaded cache entry
+	static void patch_breakpoints(Inst_fetch_module::Cache_entry& entry, const Breakpoint_set& breakpoints)
+	{
+		entry.originals.clear();
+
+		const auto* bitmap = breakpoints.get_page(entry.address);
+		if (bitmap == nullptr) [[likely]]
+			return;
+
+		for (size_t slot = 0; slot < bitmap->size(); slot++)
+			if (bitmap->test(slot))
+			{
+				entry.originals.emplace_back(static_cast<u16>(slot), entry.data[slot]);
+				entry.data[slot] = Inst_fetch_module::ebreak_inst;
+			}
+	}
+
+	// Get the instruction of `slot` before its breakpoint was patched in
+	static u32 get_original(const Inst_fetch_module::Cache_entry& entry, size_t slot)
+	{
+		const auto it = std::ranges::find(entry.originals, slot, &std::pair<u16, u32>::first);
+		return it != entry.originals.end() ? it->second : entry.data[slot];
+	}
+
 	std::expected<u32, Trap> Inst_fetch_module::operator()(Memory_interface& interface, u32 pc)
 	{
 		if (pc & 0x3) [[unlikely]]
@@ -161,13 +231,33 @@ namespace core
 
 			cache[cache_idx].valid = true;
 			cache[cache_idx].address = pc & 0xfffff000;
+
+			patch_breakpoints(cache[cache_idx], breakpoints);
 		}
 
-		return cache[cache_idx].data[(pc & 0xfff) >> 2];
+		const auto slot = (pc & 0xfff) >> 2;
+		const auto inst = cache[cache_idx].data[slot];
+		if (inst == ebreak_inst && bypass_breakpoints) [[unlikely]]
+			return get_original(cache[cache_idx], slot);
+
+		return inst;
 	}
 
 	void Inst_fetch_module::fencei()
 	{
 		for (auto& entry : cache) entry.valid = false;
 	}
+
+	void Inst_fetch_module::add_breakpoint(u32 address)
+	{
+		if (breakpoints.insert(address)) cache[(address >> 12) % cache_num].valid = false;
+	}
+
+	bool Inst_fetch_module::remove_breakpoint(u32 address)
+	{
+		if (breakpoints.erase(address) == 0) return false;
+
+		cache[(address >> 12) % cache_num].valid = false;
+		return true;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "device/address-decoder.hpp"
+
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+
+namespace device
+{
+	namespace
+	{
+		// Mark `index` as a candidate of the entries `[first, last]`
+		void mark_entries(std::span<u32> entries, u64 first, u64 last, u32 index, u32 unmapped, u32 shared)
+		{
+			for (auto i = first; i <= last; i++) entries[i] = entries[i] == unmapped ? index : shared;
+		}
+	}
+
+	void Address_decoder::build(std::span<const Range> new_ranges)
+	{
+		if (new_ranges.size() >= ambiguous)
+			throw std::invalid_argument(std::format("Too many address ranges: {}", new_ranges.size()));
+
+		for (size_t i = 0; i < new_ranges.size(); i++)
+		{
+			const auto& range = new_ranges[i];
+			if (range.size == 0 || range.base + range.size < range.base)
+				throw std::invalid_argument(std::format("Invalid address range #{}", i));
+
+			if (i != 0 && new_ranges[i - 1].base + new_ranges[i - 1].size > range.base)
+				throw std::invalid_argument(std::format("Address range #{} overlaps or is unsorted", i));
+		}
+
+		ranges.assign(new_ranges.begin(), new_ranges.end());
+		std::ranges::fill(chunk_table, unmapped);
+		page_tables.clear();
+
+		const auto table_limit = u64(1) << table_address_bits;
+		const auto for_each_range_in_table = [this, table_limit](auto&& function)
+		{
+			for (size_t i = 0; i < ranges.size() && ranges[i].base < table_limit; i++)
+			{
+				const auto last_address = std::min(ranges[i].base + ranges[i].size, table_limit) - 1;
+				function(static_cast<u32>(i), ranges[i].base, last_address);
+			}
+		};
+
+		// First level, chunks shared by several ranges are marked with `page_table_flag`
+		for_each_range_in_table(
+			[this](u32 index, u64 first_address, u64 last_address)
+			{
+				mark_entries(
+					chunk_table,
+					first_address >> chunk_shift,
+					last_address >> chunk_shift,
+					index,
+					unmapped,
+					page_table_flag
+				);
+			}
+		);
+
+		// Second level, one page table for each shared chunk
+		std::vector<u32> chunk_page_table(chunk_table.size(), unmapped);
+		for (size_t chunk = 0; chunk < chunk_table.size(); chunk++)
+		{
+			if (chunk_table[chunk] != page_table_flag) continue;
+
+			const auto table_index = static_cast<u32>(page_tables.size() / pages_per_chunk);
+			chunk_page_table[chunk] = table_index;
+			chunk_table[chunk] = page_table_flag | table_index;
+			page_tables.resize(page_tables.size() + pages_per_chunk, unmapped);
+		}
+
+		for_each_range_in_table(
+			[this, &chunk_page_table](u32 index, u64 first_address, u64 last_address)
+			{
+				for (auto chunk = first_address >> chunk_shift; chunk <= last_address >> chunk_shift; chunk++)
+				{
+					if (chunk_page_table[chunk] == unmapped) continue;
+
+					const auto chunk_base = chunk << chunk_shift;
+					const auto first_page = (std::max(first_address, chunk_base) - chunk_base) >> page_shift;
+					const auto last_page
+						= (std::min(last_address, chunk_base + (u64(1) << chunk_shift) - 1) - chunk_base)
+					   >> page_shift;
+
+					const auto table_offset = chunk_page_table[chunk] * pages_per_chunk;
+					mark_entries(
+						std::span(page_tables).subspan(table_offset, pages_per_chunk),
+						first_page,
+						last_page,
+						index,
+						unmapped,
+						ambiguous
+					);
+				}
+			}
+		);
+	}
+
+	std::optional<size_t> Address_decoder::search(u64 address) const noexcept
+	{
+		const auto position = std::ranges::upper_bound(ranges, address, {}, &Range::base);
+		if (position == ranges.begin()) return std::nullopt;
+
+		const auto& range = *std::prev(position);
+		if (address - range.base >= range.size) return std::nullopt;
+
+		return static_cast<size_t>(std::distance(ranges.begin(), position) - 1);
+	}
+}
@@ -1,6 +1,8 @@
 #include "device/block-memory.hpp"
 #include "core/print.hpp"
 
+#include <bit>
+#include <cstring>
 #include <execution>
 #include <ranges>
 
@@ -8,13 +10,15 @@ namespace device
 {
 	Block_memory::Block_memory(u64 size_bytes, Fill_policy mode) :
 		actual_size_bytes(size_bytes),
-		fill_policy(mode)
+		fill_policy(mode),
+		random_seed(std::random_device()())
 	{
 		const size_t page_count = (size_bytes + page_size_bytes - 1) / page_size_bytes;
 		storage.resize(page_count);
+		dirty_bitmap.resize((page_count + 63) / 64);
 	}
 
-	void Block_memory::fill_page(std::array<u32, page_size_bytes / sizeof(u32)>& page)
+	void Block_memory::fill_page(size_t page_index, Page& page)
 	{
 		switch (fill_policy)
 		{
@@ -31,8 +35,8 @@ namespace device
 
 		case Fill_policy::Random:
 		{
-			std::random_device rd;
-			std::mt19937_64 eng(rd());
+			// Seeded by the page index, so a page released by a restore gets the same content again
+			std::mt19937_64 eng(random_seed + page_index);
 			std::uniform_int_distribution<u32> distr;
 
 			std::ranges::generate(page, [&distr, &eng]() { return distr(eng); });
@@ -53,8 +57,9 @@ namespace device
 		if (storage[page_index] != nullptr) [[likely]]
 			return;
 
-		storage[page_index] = std::make_unique<std::array<u32, page_size_bytes / sizeof(u32)>>();
-		fill_page(*storage[page_index]);
+		storage[page_index] = std::make_unique<Page>();
+		fill_page(page_index, *storage[page_index]);
+		allocated_pages++;
 	}
 
 	bool Block_memory::fill_data(const void* data, size_t size)
@@ -68,6 +73,7 @@ namespace device
 			 byte_data | std::views::chunk(page_size_bytes) | std::views::enumerate)
 		{
 			touch_page(page_idx);
+			mark_page_dirty(page_idx);
 			std::ranges::copy(data_chunk, reinterpret_cast<u8*>(storage[page_idx]->data()));
 		}
 
@@ -145,6 +151,9 @@ namespace device
 		const u64 page_offset = address % page_size_bytes;
 
 		touch_page(page_index);
+		if (!is_page_dirty(page_index)) [[unlikely]]
+			mark_page_dirty(page_index);
+
 		const auto& page = *storage[page_index];
 
 		u8* byte_ptr = (u8*)page.data() + page_offset;
@@ -157,14 +166,188 @@ namespace device
 		return {};
 	}
 
-	size_t Block_memory::used_space() const noexcept
+	std::expected<void, Block_memory::Error> Block_memory::read_block(u64 address, std::span<u8> data)
 	{
-		return std::ranges::count_if(storage, [](const auto& page) { return page != nullptr; })
-			 * page_size_bytes;
+		if (address > this->size() || data.size() > this->size() - address) [[unlikely]]
+			return std::unexpected(Error::Out_of_range);
+
+		for (size_t done = 0; done < data.size();)
+		{
+			const u64 page_index = (address + done) / page_size_bytes;
+			const u64 page_offset = (address + done) % page_size_bytes;
+			const auto count = std::min<size_t>(data.size() - done, page_size_bytes - page_offset);
+
+			touch_page(page_index);
+			const auto* const page_bytes = reinterpret_cast<const u8*>(storage[page_index]->data());
+			std::memcpy(data.data() + done, page_bytes + page_offset, count);
+			done += count;
+		}
+
+		return {};
+	}
+
+	std::expected<void, core::Memory_interface::Error> Block_memory::write_block(
+		u64 address,
+		std::span<const u8> data
+	)
+	{
+		if (address > this->size() || data.size() > this->size() - address) [[unlikely]]
+			return std::unexpected(Error::Out_of_range);
+
+		if (write_lock) [[unlikely]]
+			return std::unexpected(Error::Access_fault);
+
+		for (size_t done = 0; done < data.size();)
+		{
+			const u64 page_index = (address + done) / page_size_bytes;
+			const u64 page_offset = (address + done) % page_size_bytes;
+			const auto count = std::min<size_t>(data.size() - done, page_size_bytes - page_offset);
+
+			touch_page(page_index);
+			mark_page_dirty(page_index);
+			auto* const page_bytes = reinterpret_cast<u8*>(storage[page_index]->data());
+			std::memcpy(page_bytes + page_offset, data.data() + done, count);
+			done += count;
+		}
+
+		return {};
 	}
 
 	void Block_memory::reset_content() noexcept
 	{
 		std::ranges::fill(storage, nullptr);
+		allocated_pages = 0;
+		clear_dirty_pages();
+	}
+
+	std::vector<size_t> Block_memory::get_dirty_pages() const
+	{
+		std::vector<size_t> pages;
+
+		for (size_t word_index = 0; word_index < dirty_bitmap.size(); word_index++)
+			for (u64 word = dirty_bitmap[word_index]; word != 0; word &= word - 1)
+				pages.push_back(word_index * 64 + std::countr_zero(word));
+
+		return pages;
+	}
+
+	void Block_memory::clear_dirty_pages() noexcept
+	{
+		std::ranges::fill(dirty_bitmap, 0);
+		epoch = ++last_epoch;
+	}
+
+	Block_memory::Snapshot Block_memory::take_snapshot()
+	{
+		Snapshot snapshot;
+		snapshot.pages.resize(storage.size());
+
+		for (size_t i = 0; i < storage.size(); i++)
+			if (storage[i] != nullptr) snapshot.pages[i] = std::make_unique<Page>(*storage[i]);
+
+		clear_dirty_pages();
+		snapshot.epoch = epoch;
+
+		return snapshot;
+	}
+
+	void Block_memory::restore_page(size_t page_index, const Page* snapshot_page)
+	{
+		auto& page = storage[page_index];
+
+		if (snapshot_page == nullptr)
+		{
+			if (page != nullptr) allocated_pages--;
+			page = nullptr;
+		}
+		else if (page == nullptr)
+		{
+			page = std::make_unique<Page>(*snapshot_page);
+			allocated_pages++;
+		}
+		else
+			*page = *snapshot_page;
+	}
+
+	void Block_memory::restore_snapshot(const Snapshot& snapshot)
+	{
+		if (snapshot.epoch == epoch)
+		{
+			// Only written pages differ from the snapshot
+			for (size_t word_index = 0; word_index < dirty_bitmap.size(); word_index++)
+				for (u64 word = dirty_bitmap[word_index]; word != 0; word &= word - 1)
+				{
+					const auto page_index = word_index * 64 + std::countr_zero(word);
+					restore_page(page_index, snapshot.pages[page_index].get());
+				}
+		}
+		else
+		{
+			for (size_t i = 0; i < storage.size(); i++) restore_page(i, snapshot.pages[i].get());
+		}
+
+		std::ranges::fill(dirty_bitmap, 0);
+		epoch = snapshot.epoch;
+	}
+
+	Block_memory::Checkpoint Block_memory::take_checkpoint(const Checkpoint* previous)
+	{
+		const bool incremental = previous != nullptr && previous->epoch == epoch;
+
+		Checkpoint checkpoint;
+		checkpoint.pages.reserve(allocated_pages);
+
+		auto previous_page = incremental ? previous->pages.begin() : decltype(previous->pages.begin())();
+		for (size_t i = 0; i < storage.size(); i++)
+		{
+			if (storage[i] == nullptr) continue;
+
+			if (incremental)
+			{
+				while (previous_page != previous->pages.end() && previous_page->first < i) previous_page++;
+
+				const bool shared = previous_page != previous->pages.end() && previous_page->first == i;
+				if (shared && !is_page_dirty(i))
+				{
+					checkpoint.pages.emplace_back(i, previous_page->second);
+					continue;
+				}
+			}
+
+			checkpoint.pages.emplace_back(i, std::make_shared<const Page>(*storage[i]));
+		}
+
+		clear_dirty_pages();
+		checkpoint.epoch = epoch;
+
+		return checkpoint;
+	}
+
+	void Block_memory::restore_checkpoint(const Checkpoint& checkpoint, const Checkpoint* latest)
+	{
+		const bool incremental = latest != nullptr && latest->epoch == epoch;
+
+		// Pages of both checkpoints are visited in index order
+		auto target_page = checkpoint.pages.begin();
+		auto latest_page = incremental ? latest->pages.begin() : decltype(latest->pages.begin())();
+
+		for (size_t i = 0; i < storage.size(); i++)
+		{
+			const Page* target = nullptr;
+			if (target_page != checkpoint.pages.end() && target_page->first == i)
+				target = (target_page++)->second.get();
+
+			const Page* current = nullptr;
+			if (incremental && latest_page != latest->pages.end() && latest_page->first == i)
+				current = (latest_page++)->second.get();
+
+			// Unless written since, the memory holds the content of `latest`
+			if (incremental && target == current && !is_page_dirty(i)) continue;
+
+			restore_page(i, target);
+		}
+
+		std::ranges::fill(dirty_bitmap, 0);
+		epoch = checkpoint.epoch;
 	}
 }
\ No newline at end of file
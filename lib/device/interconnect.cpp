@@ -33,4 +33,43 @@ namespace device
 
 		return entry.get().write(entry_address, data, mask);
 	}
+
+	std::expected<void, Interconnect::Error> Interconnect::read_block(u64 address, std::span<u8> data)
+	{
+		// Split the block at device boundaries, each device copies its part at once
+		for (size_t done = 0; done < data.size();)
+		{
+			const auto memory_result = get_memory(address + done);
+			if (!memory_result) return std::unexpected(memory_result.error());
+
+			const auto& [entry, entry_address] = memory_result.value();
+			const auto count = std::min<u64>(data.size() - done, entry.get().size() - entry_address);
+
+			const auto result = entry.get().read_block(entry_address, data.subspan(done, count));
+			if (!result) return result;
+
+			done += count;
+		}
+
+		return {};
+	}
+
+	std::expected<void, Interconnect::Error> Interconnect::write_block(u64 address, std::span<const u8> data)
+	{
+		for (size_t done = 0; done < data.size();)
+		{
+			const auto memory_result = get_memory(address + done);
+			if (!memory_result) return std::unexpected(memory_result.error());
+
+			const auto& [entry, entry_address] = memory_result.value();
+			const auto count = std::min<u64>(data.size() - done, entry.get().size() - entry_address);
+
+			const auto result = entry.get().write_block(entry_address, data.subspan(done, count));
+			if (!result) return result;
+
+			done += count;
+		}
+
+		return {};
+	}
 }
\ No newline at end of file
@@ -99,6 +99,14 @@ namespace device::periph
 	void Clock::tick(core::csr::Mip& mip)
 	{
 		timer.set_64(timer.get_64() + 1);
-		if (timer.get_64() > comp.get_64()) mip.value |= (1 << 7);  // mtimer interrupt
+		if (timer.get_64() > comp.get_64()) mip.value |= interrupt_mask;
+	}
+
+	void Clock::reset() noexcept
+	{
+		timer = {};
+		comp = {};
+		counter_templow.reset();
+		comp_templow.reset();
 	}
 }
\ No newline at end of file
@@ -0,0 +1,256 @@
+#include "device/periph/sim-control.hpp"
+#include "core/print.hpp"
+
+namespace device::periph
+{
+	namespace
+	{
+		// Transfers between guest memory and host are split into chunks of this size
+		constexpr size_t chunk_size = 4096;
+
+		// Maximum length of a guest path, including the null terminator
+		constexpr size_t max_path_length = 4096;
+	}
+
+	std::expected<void, core::Memory_interface::Error> Sim_control::write(
+		u64 address,
+		u32 data,
+		core::Bitset<4> mask
+	)
+	{
+		if ((address & 0x3) != 0) return std::unexpected(Error::Unaligned);
+
+		const auto new_address = address / 4;
+
+		switch (new_address)
+		{
+		case 0:  // CMD
+			command = mask.expand_byte_mask().choose_bits(data, command);
+			result = execute(static_cast<Command>(command));
+			break;
+
+		case 1:  // ARG0
+		case 2:  // ARG1
+		case 3:  // ARG2
+		{
+			auto& arg = args[new_address - 1];
+			arg = mask.expand_byte_mask().choose_bits(data, arg);
+			break;
+		}
+
+		default:
+			wprintln("Sim_control.write: address out of range: 0x{:08x}", address);
+			return std::unexpected(Error::Access_fault);
+		}
+
+		return {};
+	}
+
+	std::expected<u32, core::Memory_interface::Error> Sim_control::read(u64 address)
+	{
+		if ((address & 0x3) != 0) return std::unexpected(Error::Unaligned);
+
+		const auto new_address = address / 4;
+
+		switch (new_address)
+		{
+		case 0:  // CMD
+			return command;
+		case 1:  // ARG0
+		case 2:  // ARG1
+		case 3:  // ARG2
+			return args[new_address - 1];
+		case 4:  // RESULT
+			return result;
+		default:
+			wprintln("Sim_control.read: address out of range: 0x{:08x}", address);
+			return std::unexpected(Error::Access_fault);
+		}
+	}
+
+	void Sim_control::reset()
+	{
+		command = 0;
+		args = {0, 0, 0};
+		result = 0;
+		exit_code = std::nullopt;
+		files.clear();
+		next_handle = 0;
+	}
+
+	u32 Sim_control::execute(Command command)
+	{
+		switch (command)
+		{
+		case Command::Exit:
+			exit_code = args[0];
+			return 0;
+
+		case Command::Console_write:
+			return console_write(args[0], args[1]);
+
+		case Command::File_open:
+			return file_open(args[0], static_cast<File_mode>(args[1]));
+
+		case Command::File_read:
+			return file_read(args[0], args[1], args[2]);
+
+		case Command::File_write:
+			return file_write(args[0], args[1], args[2]);
+
+		case Command::File_close:
+			return file_close(args[0]);
+
+		default:
+			wprintln("Sim_control: unknown command {}", static_cast<u32>(command));
+			return failure;
+		}
+	}
+
+	u32 Sim_control::console_write(u32 address, u32 length)
+	{
+		std::array<u8, chunk_size> buffer;
+
+		for (u32 done = 0; done < length;)
+		{
+			const auto size = std::min<size_t>(chunk_size, length - done);
+			const std::span chunk(buffer.data(), size);
+
+			if (!guest_memory.read_block(address + done, chunk)) return failure;
+			output_stream->write(
+				reinterpret_cast<const char*>(chunk.data()),
+				static_cast<std::streamsize>(size)
+			);
+
+			done += size;
+		}
+
+		output_stream->flush();
+		return length;
+	}
+
+	std::optional<std::filesystem::path> Sim_control::resolve_path(const std::string& guest_path) const
+	{
+		if (host_file_root.empty()) return std::nullopt;
+
+		const auto relative = std::filesystem::path(guest_path).lexically_normal();
+		if (relative.empty() || relative.has_root_path()) return std::nullopt;
+
+		// Symbolic links are followed, the target must still be under the root
+		std::error_code error;
+		const auto root = std::filesystem::weakly_canonical(host_file_root, error);
+		if (error) return std::nullopt;
+		const auto resolved = std::filesystem::weakly_canonical(root / relative, error);
+		if (error) return std::nullopt;
+
+		const auto inside = resolved.lexically_relative(root);
+		if (inside.empty() || *inside.begin() == "..") return std::nullopt;
+
+		return resolved;
+	}
+
+	u32 Sim_control::file_open(u32 path_address, File_mode mode)
+	{
+		if (files.size() >= max_open_files) return failure;
+
+		// Read the null-terminated path
+		std::string guest_path;
+		for (u32 offset = 0;; offset++)
+		{
+			if (offset >= max_path_length) return failure;
+
+			u8 ch;
+			if (!guest_memory.read_block(path_address + offset, std::span(&ch, 1))) return failure;
+			if (ch == '\0') break;
+
+			guest_path.push_back(static_cast<char>(ch));
+		}
+
+		const auto host_path = resolve_path(guest_path);
+		if (!host_path.has_value())
+		{
+			wprintln("Sim_control: access to host file \"{}\" denied", guest_path);
+			return failure;
+		}
+
+		std::ios::openmode open_mode = std::ios::binary;
+		switch (mode)
+		{
+		case File_mode::Read:
+			open_mode |= std::ios::in;
+			break;
+		case File_mode::Write:
+			open_mode |= std::ios::out | std::ios::trunc;
+			break;
+		case File_mode::Append:
+			open_mode |= std::ios::out | std::ios::app;
+			break;
+		default:
+			return failure;
+		}
+
+		std::fstream file(*host_path, open_mode);
+		if (!file) return failure;
+
+		const auto handle = next_handle++;
+		files.emplace(handle, std::move(file));
+
+		return handle;
+	}
+
+	u32 Sim_control::file_read(u32 handle, u32 address, u32 length)
+	{
+		const auto find = files.find(handle);
+		if (find == files.end()) return failure;
+
+		auto& file = find->second;
+		std::array<u8, chunk_size> buffer;
+
+		u32 done = 0;
+		while (done < length)
+		{
+			const auto size = std::min<size_t>(chunk_size, length - done);
+			file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(size));
+
+			const auto count = static_cast<size_t>(file.gcount());
+			if (!guest_memory.write_block(address + done, std::span(buffer.data(), count))) return failure;
+
+			done += count;
+			if (count < size) break;
+		}
+
+		if (file.bad()) return failure;
+		file.clear();
+
+		return done;
+	}
+
+	u32 Sim_control::file_write(u32 handle, u32 address, u32 length)
+	{
+		const auto find = files.find(handle);
+		if (find == files.end()) return failure;
+
+		auto& file = find->second;
+		std::array<u8, chunk_size> buffer;
+
+		for (u32 done = 0; done < length;)
+		{
+			const auto size = std::min<size_t>(chunk_size, length - done);
+			const std::span chunk(buffer.data(), size);
+
+			if (!guest_memory.read_block(address + done, chunk)) return failure;
+
+			file.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(size));
+			if (!file) return failure;
+
+			done += size;
+		}
+
+		return length;
+	}
+
+	u32 Sim_control::file_close(u32 handle)
+	{
+		return files.erase(handle) != 0 ? 0 : failure;
+	}
+}
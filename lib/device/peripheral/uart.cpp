@@ -18,7 +18,7 @@ namespace device::periph
 		{
 		case 0:  // TX
 		{
-			if (mask & 0x1) std::cerr << static_cast<char>(data & 0xff);
+			if (mask & 0x1) *output_stream << static_cast<char>(data & 0xff);
 			break;
 		}
 		case 2:  // CFG
@@ -44,11 +44,11 @@ namespace device::periph
 		switch (new_address)
 		{
 		case 1:  // RX
-			return static_cast<u32>(input_stream->get());
+			return input_source ? input_source(Input::Rx) : read_input(Input::Rx);
 		case 2:  // CFG
 			return config_reg;
 		case 3:  // STA
-			return 0b10 | (!input_stream->eof() && random() % 2 == 1 ? 0b01 : 0b00);
+			return input_source ? input_source(Input::Status) : read_input(Input::Status);
 		default:
 			wprintln("Uart.read: address out of range: 0x{:08x}", address);
 			return std::unexpected(Error::Access_fault);
@@ -59,4 +59,27 @@ namespace device::periph
 	{
 		this->input_stream = &input_stream;
 	}
+
+	void Uart::set_output_stream(std::ostream& output_stream)
+	{
+		this->output_stream = &output_stream;
+	}
+
+	void Uart::set_input_source(Input_source source)
+	{
+		input_source = std::move(source);
+	}
+
+	u32 Uart::read_input(Input input)
+	{
+		switch (input)
+		{
+		case Input::Rx:
+			return static_cast<u32>(input_stream->get());
+		case Input::Status:
+			return 0b10 | (!input_stream->eof() && random() % 2 == 1 ? 0b01 : 0b00);
+		}
+
+		return 0;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,230 @@
+#include "device/rom.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <string_view>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace device
+{
+	namespace
+	{
+		std::runtime_error file_error(std::string_view action, int error)
+		{
+			return std::runtime_error(
+				std::format("Failed to {} flash file ({})", action, std::strerror(error))
+			);
+		}
+
+		void check_file_size(size_t file_size, size_t rom_size)
+		{
+			if (file_size == 0) throw std::runtime_error("Flash file is empty");
+
+			if (file_size > rom_size)
+				throw std::runtime_error(
+					std::format(
+						"ROM init data size ({} Bytes) exceeds ROM size ({} Bytes)",
+						file_size,
+						rom_size
+					)
+				);
+		}
+	}
+
+	Rom::~Rom()
+	{
+		unmap();
+	}
+
+	void Rom::unmap() noexcept
+	{
+#ifndef _WIN32
+		if (mapping != nullptr) munmap(mapping, mapping_size);
+#endif
+		mapping = nullptr;
+		mapping_size = 0;
+	}
+
+	bool Rom::load(std::span<const u8> image)
+	{
+		if (image.size() > size_bytes) [[unlikely]]
+			return false;
+
+		unmap();
+		owned.assign(image.begin(), image.end());
+		content = owned;
+
+		return true;
+	}
+
+	void Rom::map_file(const std::filesystem::path& path)
+	{
+#ifndef _WIN32
+		const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) throw file_error("open", errno);
+
+		struct stat file_stat;
+		if (fstat(fd, &file_stat) != 0)
+		{
+			const auto error = errno;
+			close(fd);
+			throw file_error("read", error);
+		}
+
+		const auto file_size = static_cast<size_t>(file_stat.st_size);
+		try
+		{
+			check_file_size(file_size, size_bytes);
+		}
+		catch (...)
+		{
+			close(fd);
+			throw;
+		}
+
+		void* new_mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		const auto error = errno;
+		close(fd);
+
+		if (new_mapping == MAP_FAILED) throw file_error("map", error);
+
+		unmap();
+		owned.clear();
+		owned.shrink_to_fit();
+
+		mapping = new_mapping;
+		mapping_size = file_size;
+		content = {static_cast<const u8*>(mapping), mapping_size};
+#else
+		// No mapping support, read the file instead
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file) throw file_error("open", errno);
+
+		const auto file_size = static_cast<size_t>(file.tellg());
+		check_file_size(file_size, size_bytes);
+
+		std::vector<u8> data(file_size);
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(file_size));
+		if (!file) throw file_error("read", errno);
+
+		owned = std::move(data);
+		content = owned;
+#endif
+	}
+
+	void Rom::make_writable()
+	{
+		if (mapping == nullptr && owned.size() == size_bytes) return;
+
+		std::vector<u8> data(size_bytes, 0);
+		std::ranges::copy(content, data.begin());
+
+		unmap();
+		owned = std::move(data);
+		content = owned;
+	}
+
+	std::expected<u32, core::Memory_interface::Error> Rom::read(u64 address)
+	{
+		if (address >= size_bytes) [[unlikely]]
+			return std::unexpected(Error::Out_of_range);
+
+		if (address & 0x3) [[unlikely]]
+			return std::unexpected(Error::Unaligned);
+
+		u32 word = 0;
+
+		if (address + 4 <= content.size()) [[likely]]
+			std::memcpy(&word, content.data() + address, 4);
+		else if (address < content.size())
+			std::memcpy(&word, content.data() + address, content.size() - address);
+
+		return word;
+	}
+
+	std::expected<void, core::Memory_interface::Error> Rom::read_page(u64 address, std::span<u32, 1024> data)
+	{
+		if ((address & 0x00000FFF) != 0) [[unlikely]]
+			return std::unexpected(Error::Unaligned);
+
+		if (address + data.size_bytes() > size_bytes) [[unlikely]]
+			return std::unexpected(Error::Out_of_range);
+
+		const auto available = address < content.size()
+								 ? std::min<size_t>(content.size() - address, data.size_bytes())
+								 : 0;
+
+		auto* const bytes = reinterpret_cast<u8*>(data.data());
+		if (available != 0) std::memcpy(bytes, content.data() + address, available);
+		std::fill(bytes + available, bytes + data.size_bytes(), 0);
+
+		return {};
+	}
+
+	std::expected<void, core::Memory_interface::Error> Rom::write(u64 address, u32 data, core::Bitset<4> mask)
+	{
+		if (address + 4 > size_bytes) [[unlikely]]
+			return std::unexpected(Error::Out_of_range);
+
+		if (write_lock) [[unlikely]]
+			return std::unexpected(Error::Access_fault);
+
+		if (mask == 0) [[unlikely]]
+			return {};
+
+		if (address & 0x3) [[unlikely]]
+			return std::unexpected(Error::Unaligned);
+
+		make_writable();
+
+		u32 word;
+		std::memcpy(&word, owned.data() + address, 4);
+		word = mask.expand_byte_mask().choose_bits(data, word);
+		std::memcpy(owned.data() + address, &word, 4);
+
+		return {};
+	}
+
+	std::expected<void, core::Memory_interface::Error> Rom::read_block(u64 address, std::span<u8> data)
+	{
+		if (address > size_bytes || data.size() > size_bytes - address) [[unlikely]]
+			return std::unexpected(Error::Out_of_range);
+
+		// Bytes past the end of the content read as zero
+		const auto available = address < content.size()
+								 ? std::min<size_t>(content.size() - address, data.size())
+								 : 0;
+
+		if (available != 0) std::memcpy(data.data(), content.data() + address, available);
+		std::fill(data.begin() + available, data.end(), 0);
+
+		return {};
+	}
+
+	std::expected<void, core::Memory_interface::Error> Rom::write_block(u64 address, std::span<const u8> data)
+	{
+		if (address > size_bytes || data.size() > size_bytes - address) [[unlikely]]
+			return std::unexpected(Error::Out_of_range);
+
+		if (write_lock) [[unlikely]]
+			return std::unexpected(Error::Access_fault);
+
+		if (data.empty()) [[unlikely]]
+			return {};
+
+		make_writable();
+		std::memcpy(owned.data() + address, data.data(), data.size());
+
+		return {};
+	}
+}
@@ -8,7 +8,7 @@
 
 namespace gdb_stub::command
 {
-	static const std::any fail{};
+	static constexpr auto fail = std::nullopt;
 
 	inline namespace util
 	{
@@ -69,7 +69,7 @@ namespace gdb_stub::command
 		}
 	}
 
-	static std::any parse_continue(std::string_view params)
+	static std::optional<Command> parse_continue(std::string_view params)
 	{
 		if (params.empty()) return Continue{.address = std::nullopt};
 
@@ -78,7 +78,7 @@ namespace gdb_stub::command
 		return Continue{.address = address};
 	}
 
-	static std::any parse_write_registers(std::string_view params)
+	static std::optional<Command> parse_write_registers(std::string_view params)
 	{
 		if (params.empty() || params.length() % 8 != 0) return fail;
 
@@ -114,7 +114,7 @@ namespace gdb_stub::command
 		}
 	}
 
-	static std::any parse_step_single_cycle(std::string_view params)
+	static std::optional<Command> parse_step_single_cycle(std::string_view params)
 	{
 		const auto subparams = params
 							 | std::views::split(',')
@@ -136,7 +136,7 @@ namespace gdb_stub::command
 		}
 	}
 
-	static std::any parse_read_memory(std::string_view params)
+	static std::optional<Command> parse_read_memory(std::string_view params)
 	{
 		const auto parse_result = parse_u32_pair(params);
 		if (!parse_result) return fail;
@@ -145,7 +145,7 @@ namespace gdb_stub::command
 		return Read_memory{.address = addr, .length = length};
 	}
 
-	static std::any parse_write_memory(std::string_view params)
+	static std::optional<Command> parse_write_memory(std::string_view params)
 	{
 		const auto [addr_length_str, data_str] = split_once(params, ':');
 		if (addr_length_str.empty() || data_str.empty()) return fail;
@@ -171,7 +171,86 @@ namespace gdb_stub::command
 		};
 	}
 
-	static std::any parse_read_single_register(std::string_view params)
+	static std::optional<Command> parse_write_memory_binary(std::string_view params)
+	{
+		const auto colon_pos = params.find(':');
+		if (colon_pos == std::string_view::npos) return fail;
+
+		// Parse `addr` and `length`
+		const auto parse_pair_result = parse_u32_pair(params.substr(0, colon_pos));
+		if (!parse_pair_result) return fail;
+		const auto [addr, length] = parse_pair_result.value();
+
+		// Escapes are already removed by the packet decoder. Zero length is used by GDB to probe support.
+		const auto data_str = params.substr(colon_pos + 1);
+		if (data_str.size() != length) return fail;
+
+		return Write_memory{.address = addr, .data = std::vector<u8>(data_str.begin(), data_str.end())};
+	}
+
+	static std::optional<Vcont::Action> parse_vcont_action(std::string_view str_rep)
+	{
+		// Thread ID is ignored, the target has a single thread
+		const auto action = str_rep.substr(0, str_rep.find(':'));
+		if (action.empty()) return std::nullopt;
+
+		const auto params = action.substr(1);
+
+		switch (action[0])
+		{
+		case 'c':
+		case 's':
+			if (!params.empty()) return std::nullopt;
+			break;
+		case 'C':
+		case 'S':
+			if (!parse_hex(params).has_value()) return std::nullopt;
+			break;
+		case 't':
+			if (!params.empty()) return std::nullopt;
+			return Vcont::Action{.kind = Vcont::Action::Kind::Stop};
+		case 'r':
+		{
+			const auto range = parse_u32_pair(params);
+			if (!range) return std::nullopt;
+
+			return Vcont::Action{
+				.kind = Vcont::Action::Kind::Range_step,
+				.range_start = range->first,
+				.range_end = range->second
+			};
+		}
+		default:
+			return std::nullopt;
+		}
+
+		const bool is_step = action[0] == 's' || action[0] == 'S';
+		return Vcont::Action{.kind = is_step ? Vcont::Action::Kind::Step : Vcont::Action::Kind::Continue};
+	}
+
+	static std::optional<Command> parse_v(std::string_view params)
+	{
+		if (params == "Cont?") return Query_vcont{};
+		if (params == "CtrlC") return Interrupt_request{};
+		if (params == "Stopped") return Ack_stop_notification{};
+		if (!params.starts_with("Cont;")) return fail;
+
+		Vcont vcont;
+		const auto actions_str = params.substr(std::string_view("Cont;").length());
+
+		for (const auto action_str : actions_str | std::views::split(';'))
+		{
+			const auto action = parse_vcont_action(std::string_view(action_str.begin(), action_str.end()));
+			if (!action.has_value()) return fail;
+
+			vcont.actions.push_back(*action);
+		}
+
+		if (vcont.actions.empty()) return fail;
+		return vcont;
+	}
+
+	static std::optional<Command> parse_read_single_register(std::string_view params)
 	{
 		if (params.empty() || params.length() > 4) return fail;
 
@@ -182,7 +261,7 @@ namespace gdb_stub::command
 		return Read_single_register{.regno = *address};
 	}
 
-	static std::any parse_write_single_register(std::string_view params)
+	static std::optional<Command> parse_write_single_register(std::string_view params)
 	{
 		if (params.empty()) return fail;
 
@@ -200,7 +279,7 @@ namespace gdb_stub::command
 		return Write_single_register{.regno = *address, .value = *value};
 	}
 
-	static std::any parse_step_single(std::string_view params)
+	static std::optional<Command> parse_step_single(std::string_view params)
 	{
 		if (params.empty()) return Step_single_inst{.address = std::nullopt};
 
@@ -209,7 +288,14 @@ namespace gdb_stub::command
 		return Step_single_inst{.address = address};
 	}
 
-	static std::any parse_q_supported(std::string_view params)
+	static std::optional<Command> parse_b(std::string_view params)
+	{
+		if (params == "s") return Reverse_step{};
+		if (params == "c") return Reverse_continue{};
+		return fail;
+	}
+
+	static std::optional<Command> parse_q_supported(std::string_view params)
 	{
 		using namespace std::string_view_literals;
 
@@ -284,7 +370,7 @@ namespace gdb_stub::command
 		};
 	}
 
-	static std::any parse_qxfer_feature_read(std::string_view params)
+	static std::optional<Command> parse_qxfer_feature_read(std::string_view params)
 	{
 		const auto [annex_str, offset_length_str] = split_once(params, ':');
 
@@ -295,7 +381,7 @@ namespace gdb_stub::command
 		return Read_feature_xml{.annex = std::string(annex_str), .offset = offset, .length = length};
 	}
 
-	static std::any parse_qxfer_memorymap_read(std::string_view params)
+	static std::optional<Command> parse_qxfer_memorymap_read(std::string_view params)
 	{
 		const auto [annex_str, offset_length_str] = split_once(params, ':');
 
@@ -306,7 +392,7 @@ namespace gdb_stub::command
 		return Read_memory_map_xml{.offset = offset, .length = length};
 	}
 
-	static std::any parse_qxfer(std::string_view params)
+	static std::optional<Command> parse_qxfer(std::string_view params)
 	{
 		if (params.starts_with("features:read"))
 			return parse_qxfer_feature_read(params.substr(std::string_view("features:read:").length()));
@@ -316,7 +402,7 @@ namespace gdb_stub::command
 		return fail;
 	}
 
-	static std::any parse_q(std::string_view params)
+	static std::optional<Command> parse_q(std::string_view params)
 	{
 		const auto [sub_operand, sub_params] = split_once(params, ':');
 		if (sub_operand.empty() || sub_params.empty()) return fail;
@@ -326,30 +412,54 @@ namespace gdb_stub::command
 		return fail;
 	}
 
-	static std::optional<std::vector<u8>> parse_bytecode(std::string_view str_rep)
+	static std::optional<Command> parse_Q(std::string_view params)
 	{
-		if (str_rep.empty()) return std::nullopt;
-		if (str_rep[0] != 'X') return std::nullopt;
+		if (params == "StartNoAckMode") return Start_no_ack_mode{};
+		if (params == "NonStop:0" || params == "NonStop:1")
+			return Set_non_stop{.enable = params.back() == '1'};
+		return fail;
+	}
 
-		const auto [length_str, data_str] = split_once(str_rep.substr(1), ',');
-		if (length_str.empty() || data_str.empty()) return std::nullopt;
+	// Parse a list of `Xlen,expr` conditions, concatenated without separators
+	static std::optional<std::vector<std::vector<u8>>> parse_condition_list(std::string_view str_rep)
+	{
+		if (str_rep.empty()) return std::nullopt;
 
-		const auto parse_length_result = parse_hex(length_str);
-		if (!parse_length_result) return std::nullopt;
-		if (data_str.length() != parse_length_result.value() * 2) return std::nullopt;
+		std::vector<std::vector<u8>> conditions;
 
-		const auto data_vec
-			= data_str
-			| std::views::chunk(2)
-			| std::views::transform([](auto subrange) { return std::optional<u8>(parse_hex(subrange)); });
-		if (!std::ranges::all_of(data_vec, optional_has_value<u8>)) return std::nullopt;
+		while (!str_rep.empty())
+		{
+			if (str_rep[0] != 'X') return std::nullopt;
+
+			const auto [length_str, rest] = split_once(str_rep.substr(1), ',');
+			if (length_str.empty() || rest.empty()) return std::nullopt;
+
+			const auto parse_length_result = parse_hex(length_str);
+			if (!parse_length_result) return std::nullopt;
+
+			// The length delimits the expression from the next condition
+			const auto data_length = size_t(parse_length_result.value()) * 2;
+			if (data_length == 0 || rest.length() < data_length) return std::nullopt;
+			const auto data_str = rest.substr(0, data_length);
+			str_rep = rest.substr(data_length);
+
+			const auto data_vec
+				= data_str
+				| std::views::chunk(2)
+				| std::views::transform([](auto subrange) { return std::optional<u8>(parse_hex(subrange)); });
+			if (!std::ranges::all_of(data_vec, optional_has_value<u8>)) return std::nullopt;
+
+			conditions.push_back(
+				data_vec
+				| std::views::transform([](auto opt) { return opt.value(); })
+				| std::ranges::to<std::vector>()
+			);
+		}
 
-		return data_vec
-			 | std::views::transform([](auto opt) { return opt.value(); })
-			 | std::ranges::to<std::vector>();
+		return conditions;
 	}
 
-	static std::any parse_z(std::string_view params)
+	static std::optional<Command> parse_z(std::string_view params)
 	{
 		if (params.length() <= 2) return fail;
 		if (params[1] != ',') return fail;
@@ -392,7 +502,7 @@ namespace gdb_stub::command
 		}
 	}
 
-	static std::any parse_Z(std::string_view params)
+	static std::optional<Command> parse_Z(std::string_view params)
 	{
 		if (params.length() <= 2) return fail;
 		if (params[1] != ',') return fail;
@@ -411,18 +521,19 @@ namespace gdb_stub::command
 			if (!parse_addr_length_result) return fail;
 			const auto [addr, length] = parse_addr_length_result.value();
 
-			std::optional<std::vector<u8>> bytecode = std::nullopt;
+			std::vector<std::vector<u8>> conditions;
 			if (subparam_list.size() >= 2)
 			{
-				bytecode = parse_bytecode(std::string_view(subparam_list[1]));
-				if (!bytecode) return fail;
+				auto parse_conditions_result = parse_condition_list(std::string_view(subparam_list[1]));
+				if (!parse_conditions_result) return fail;
+				conditions = std::move(*parse_conditions_result);
 			}
 
 			return Add_breakpoint{
 				.is_hardware = params[0] == '1',
 				.address = addr,
 				.length = length,
-				.cond = std::move(bytecode)
+				.conds = std::move(conditions)
 			};
 		}
 		break;
@@ -449,33 +560,37 @@ namespace gdb_stub::command
 		return fail;
 	}
 
-	using Parse_func = std::any(std::string_view);
+	using Parse_func = std::optional<Command>(std::string_view);
 
 	static const std::map<char, Parse_func*> param_char_command_parsers = {
+		{'b', parse_b                    },
 		{'c', parse_continue             },
 		{'G', parse_write_registers      },
 		{'i', parse_step_single_cycle    },
 		{'m', parse_read_memory          },
 		{'M', parse_write_memory         },
+		{'X', parse_write_memory_binary  },
 		{'p', parse_read_single_register },
 		{'P', parse_write_single_register},
 		{'s', parse_step_single          },
+		{'v', parse_v                    },
 		{'q', parse_q                    },
+		{'Q', parse_Q                    },
 		{'z', parse_z                    },
 		{'Z', parse_Z                    },
 	};
 
-	static const std::map<char, std::any> single_char_command = {
+	static const std::map<char, Command> single_char_command = {
 		{'+',    Acknowledge_packet{.success = true} },
 		{'-',    Acknowledge_packet{.success = false}},
 		{'\x03', Interrupt_packet{}                  },
 		{'!',    Enable_persistant{}                 },
 		{'?',    Ask_halt_reason{}                   },
 		{'g',    Read_register{}                     },
-		{'k',    Stop{}							  }
+		{'k',    Stop{}                              }
 	};
 
-	std::any parse(std::string_view command)
+	std::optional<Command> parse(std::string_view command)
 	{
 		if (command.empty()) return fail;
 
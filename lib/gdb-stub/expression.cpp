@@ -1,9 +1,40 @@
 #include "gdb-stub/expression.hpp"
 
+#include <array>
+#include <limits>
+#include <map>
 #include <print>
 
 namespace gdb_stub::expression
 {
+	/* Operations shared by the interpreter and compiled expressions. Binary operations take `a` as the
+	 * element below the top of the stack, and `b` as the top. */
+
+	static u32 divide_signed(u32 a, u32 b) noexcept
+	{
+		// Overflow wraps instead of trapping
+		if (a == 0x8000'0000 && b == 0xffff'ffff) return a;
+		return static_cast<u32>(static_cast<i32>(a) / static_cast<i32>(b));
+	}
+
+	static u32 remainder_signed(u32 a, u32 b) noexcept
+	{
+		if (a == 0x8000'0000 && b == 0xffff'ffff) return 0;
+		return static_cast<u32>(static_cast<i32>(a) % static_cast<i32>(b));
+	}
+
+	static u32 sign_extend(u32 value, u8 bits) noexcept
+	{
+		if (bits == 0 || bits >= 32) return value;
+		return static_cast<u32>(static_cast<i32>(value << (32 - bits)) >> (32 - bits));
+	}
+
+	static u32 zero_extend(u32 value, u8 bits) noexcept
+	{
+		if (bits >= 32) return value;
+		return value & ((1u << bits) - 1);
+	}
+
 	std::expected<Execute_result, Execute_error> execute(
 		const std::function<std::optional<u8>(u32)>& access_memory_func,
 		const std::function<std::optional<u32>(u32)>& access_register_func,
@@ -58,7 +89,7 @@ namespace gdb_stub::expression
 			case Bytecode::Sub:
 			{
 				GET_TOP_TWO_STACK;
-				PUSH_STACK(b - a);
+				PUSH_STACK(a - b);
 				pc++;
 				break;
 			}
@@ -73,7 +104,7 @@ namespace gdb_stub::expression
 			{
 				GET_TOP_TWO_STACK;
 				if (b == 0) return std::unexpected(Execute_error::Division_by_zero);
-				PUSH_STACK(static_cast<i32>(b) / static_cast<i32>(a));
+				PUSH_STACK(divide_signed(a, b));
 				pc++;
 				break;
 			}
@@ -81,7 +112,7 @@ namespace gdb_stub::expression
 			{
 				GET_TOP_TWO_STACK;
 				if (b == 0) return std::unexpected(Execute_error::Division_by_zero);
-				PUSH_STACK(b / a);
+				PUSH_STACK(a / b);
 				pc++;
 				break;
 			}
@@ -89,7 +120,7 @@ namespace gdb_stub::expression
 			{
 				GET_TOP_TWO_STACK;
 				if (b == 0) return std::unexpected(Execute_error::Division_by_zero);
-				PUSH_STACK(static_cast<i32>(b) % static_cast<i32>(a));
+				PUSH_STACK(remainder_signed(a, b));
 				pc++;
 				break;
 			}
@@ -97,28 +128,28 @@ namespace gdb_stub::expression
 			{
 				GET_TOP_TWO_STACK;
 				if (b == 0) return std::unexpected(Execute_error::Division_by_zero);
-				PUSH_STACK(b % a);
+				PUSH_STACK(a % b);
 				pc++;
 				break;
 			}
 			case Bytecode::Lsh:
 			{
 				GET_TOP_TWO_STACK;
-				PUSH_STACK(b << (a & 0x1F));
+				PUSH_STACK(a << (b & 0x1F));
 				pc++;
 				break;
 			}
 			case Bytecode::Rsh_signed:
 			{
 				GET_TOP_TWO_STACK;
-				PUSH_STACK(static_cast<i32>(b) >> (a & 0x1F));
+				PUSH_STACK(static_cast<i32>(a) >> (b & 0x1F));
 				pc++;
 				break;
 			}
 			case Bytecode::Rsh_unsigned:
 			{
 				GET_TOP_TWO_STACK;
-				PUSH_STACK(b >> (a & 0x1F));
+				PUSH_STACK(a >> (b & 0x1F));
 				pc++;
 				break;
 			}
@@ -169,14 +200,14 @@ namespace gdb_stub::expression
 			case Bytecode::Less_signed:
 			{
 				GET_TOP_TWO_STACK;
-				PUSH_STACK(static_cast<i32>(b) < static_cast<i32>(a) ? 1 : 0);
+				PUSH_STACK(static_cast<i32>(a) < static_cast<i32>(b) ? 1 : 0);
 				pc++;
 				break;
 			}
 			case Bytecode::Less_unsigned:
 			{
 				GET_TOP_TWO_STACK;
-				PUSH_STACK(b < a ? 1 : 0);
+				PUSH_STACK(a < b ? 1 : 0);
 				pc++;
 				break;
 			}
@@ -186,7 +217,7 @@ namespace gdb_stub::expression
 				GET_OP_AT_INDEX(n, pc + 1);
 				u32 a;
 				POP_STACK(a);
-				PUSH_STACK((u32)(static_cast<i32>(static_cast<i32>(a) << (32 - n)) >> (32 - n)));
+				PUSH_STACK(sign_extend(a, n));
 				pc += 2;
 				break;
 			}
@@ -196,7 +227,7 @@ namespace gdb_stub::expression
 				GET_OP_AT_INDEX(n, pc + 1);
 				u32 a;
 				POP_STACK(a);
-				PUSH_STACK(a & ((1U << n) - 1));
+				PUSH_STACK(zero_extend(a, n));
 				pc += 2;
 				break;
 			}
@@ -386,4 +417,372 @@ namespace gdb_stub::expression
 		}
 	}
 
+	std::expected<Compiled_expression, Execute_error> Compiled_expression::compile(
+		std::span<const u8> bytecode_sequence
+	)
+	{
+		// Compiled opcode and operand size in bytes of each supported bytecode
+		static const std::map<Bytecode, std::pair<Opcode, size_t>> translation = {
+			{Bytecode::Add,           {Opcode::Add, 0}          },
+			{Bytecode::Sub,           {Opcode::Sub, 0}          },
+			{Bytecode::Mul,           {Opcode::Mul, 0}          },
+			{Bytecode::Div_signed,    {Opcode::Div_signed, 0}   },
+			{Bytecode::Div_unsigned,  {Opcode::Div_unsigned, 0} },
+			{Bytecode::Rem_signed,    {Opcode::Rem_signed, 0}   },
+			{Bytecode::Rem_unsigned,  {Opcode::Rem_unsigned, 0} },
+			{Bytecode::Lsh,           {Opcode::Lsh, 0}          },
+			{Bytecode::Rsh_signed,    {Opcode::Rsh_signed, 0}   },
+			{Bytecode::Rsh_unsigned,  {Opcode::Rsh_unsigned, 0} },
+			{Bytecode::Log_not,       {Opcode::Log_not, 0}      },
+			{Bytecode::Bit_and,       {Opcode::Bit_and, 0}      },
+			{Bytecode::Bit_or,        {Opcode::Bit_or, 0}       },
+			{Bytecode::Bit_xor,       {Opcode::Bit_xor, 0}      },
+			{Bytecode::Bit_not,       {Opcode::Bit_not, 0}      },
+			{Bytecode::Equal,         {Opcode::Equal, 0}        },
+			{Bytecode::Less_signed,   {Opcode::Less_signed, 0}  },
+			{Bytecode::Less_unsigned, {Opcode::Less_unsigned, 0}},
+			{Bytecode::Ext,           {Opcode::Ext, 1}          },
+			{Bytecode::Zero_ext,      {Opcode::Zero_ext, 1}     },
+			{Bytecode::Ref8,          {Opcode::Ref8, 0}         },
+			{Bytecode::Ref16,         {Opcode::Ref16, 0}        },
+			{Bytecode::Ref32,         {Opcode::Ref32, 0}        },
+			{Bytecode::Dup,           {Opcode::Dup, 0}          },
+			{Bytecode::Swap,          {Opcode::Swap, 0}         },
+			{Bytecode::Pop,           {Opcode::Pop, 0}          },
+			{Bytecode::Pick,          {Opcode::Pick, 1}         },
+			{Bytecode::Rot,           {Opcode::Rot, 0}          },
+			{Bytecode::If_goto,       {Opcode::If_goto, 2}      },
+			{Bytecode::Goto,          {Opcode::Goto, 2}         },
+			{Bytecode::Const8,        {Opcode::Const, 1}        },
+			{Bytecode::Const16,       {Opcode::Const, 2}        },
+			{Bytecode::Const32,       {Opcode::Const, 4}        },
+			{Bytecode::Reg,           {Opcode::Reg_gpr, 2}      },
+			{Bytecode::End,           {Opcode::End, 0}          },
+		};
+
+		Compiled_expression compiled;
+		auto& instructions = compiled.instructions;
+
+		/* Decode */
+
+		constexpr auto no_instruction = std::numeric_limits<u32>::max();
+		std::vector<u32> instruction_at(bytecode_sequence.size(), no_instruction);  // Byte offset -> index
+
+		for (size_t offset = 0; offset < bytecode_sequence.size();)
+		{
+			const auto find = translation.find(static_cast<Bytecode>(bytecode_sequence[offset]));
+			if (find == translation.end()) return std::unexpected(Execute_error::Unsupported_bytecode);
+
+			const auto [opcode, operand_size] = find->second;
+			if (offset + 1 + operand_size > bytecode_sequence.size())
+				return std::unexpected(Execute_error::Bytecode_out_of_bound);
+
+			Instruction instruction{.opcode = opcode};
+			for (size_t i = 0; i < operand_size; i++)  // Most-significant byte first
+				instruction.operand = instruction.operand << 8 | bytecode_sequence[offset + 1 + i];
+
+			if (opcode == Opcode::Reg_gpr)
+			{
+				if (instruction.operand == 32)
+					instruction.opcode = Opcode::Reg_pc;
+				else if (instruction.operand >= 128)
+				{
+					instruction.opcode = Opcode::Reg_csr;
+					instruction.operand -= 128;
+				}
+				else if (instruction.operand > 32)
+					return std::unexpected(Execute_error::Register_access_error);
+			}
+
+			instruction_at[offset] = static_cast<u32>(instructions.size());
+			instructions.push_back(instruction);
+			offset += 1 + operand_size;
+		}
+
+		/* Resolve jump targets from byte offsets to instruction indices */
+
+		for (auto& instruction : instructions)
+		{
+			if (instruction.opcode != Opcode::If_goto && instruction.opcode != Opcode::Goto) continue;
+
+			if (instruction.operand >= instruction_at.size()
+				|| instruction_at[instruction.operand] == no_instruction)
+				return std::unexpected(Execute_error::Bytecode_out_of_bound);
+
+			instruction.operand = instruction_at[instruction.operand];
+		}
+
+		/* Check the stack depth on every path */
+
+		if (instructions.empty()) return std::unexpected(Execute_error::Bytecode_out_of_bound);
+
+		// Number of elements required, and change of the stack size
+		const auto get_stack_effect = [](const Instruction& instruction) -> std::pair<size_t, int>
+		{
+			switch (instruction.opcode)
+			{
+			case Opcode::Log_not:
+			case Opcode::Bit_not:
+			case Opcode::Ext:
+			case Opcode::Zero_ext:
+			case Opcode::Ref8:
+			case Opcode::Ref16:
+			case Opcode::Ref32:
+			case Opcode::End:
+				return {1, 0};
+			case Opcode::Dup:
+				return {1, 1};
+			case Opcode::Swap:
+				return {2, 0};
+			case Opcode::Pop:
+			case Opcode::If_goto:
+				return {1, -1};
+			case Opcode::Pick:
+				return {instruction.operand + 1, 1};
+			case Opcode::Rot:
+				return {3, 0};
+			case Opcode::Goto:
+				return {0, 0};
+			case Opcode::Const:
+			case Opcode::Reg_gpr:
+			case Opcode::Reg_pc:
+			case Opcode::Reg_csr:
+				return {0, 1};
+			default:  // Binary operations
+				return {2, -1};
+			}
+		};
+
+		std::vector<std::optional<size_t>> depth_at(instructions.size());
+		std::vector<size_t> pending = {0};
+		depth_at[0] = 0;
+
+		while (!pending.empty())
+		{
+			const auto index = pending.back();
+			pending.pop_back();
+
+			const auto& instruction = instructions[index];
+			const auto [required, change] = get_stack_effect(instruction);
+			if (*depth_at[index] < required) return std::unexpected(Execute_error::Stack_out_of_bound);
+
+			const auto depth = *depth_at[index] + change;
+			if (depth > max_stack_depth) return std::unexpected(Execute_error::Stack_out_of_bound);
+
+			std::array<size_t, 2> successors;
+			size_t successor_count = 0;
+
+			if (instruction.opcode == Opcode::If_goto || instruction.opcode == Opcode::Goto)
+				successors[successor_count++] = instruction.operand;
+			if (instruction.opcode != Opcode::Goto && instruction.opcode != Opcode::End)
+				successors[successor_count++] = index + 1;
+
+			for (const auto successor : std::span(successors).first(successor_count))
+			{
+				if (successor >= instructions.size())
+					return std::unexpected(Execute_error::Bytecode_out_of_bound);
+
+				if (!depth_at[successor].has_value())
+				{
+					depth_at[successor] = depth;
+					pending.push_back(successor);
+				}
+				else if (*depth_at[successor] != depth)
+					return std::unexpected(Execute_error::Stack_out_of_bound);
+			}
+		}
+
+		return compiled;
+	}
+
+	// Read `size` bytes at a possibly unaligned address, one word at a time
+	static std::optional<u32> read_memory(core::Memory_interface& memory, u32 address, u32 size)
+	{
+		const auto offset = address & 0x3;
+
+		const auto low = memory.read(address - offset);
+		if (!low) return std::nullopt;
+
+		u64 value = *low;
+		if (offset + size > 4)
+		{
+			const auto high = memory.read(static_cast<u32>(address - offset + 4));
+			if (!high) return std::nullopt;
+
+			value |= u64(*high) << 32;
+		}
+
+		return zero_extend(static_cast<u32>(value >> (offset * 8)), size * 8);
+	}
+
+	std::expected<Execute_result, Execute_error> Compiled_expression::execute(core::CPU_module& cpu) const
+	{
+		// Depth is checked by `compile()`, `size` never exceeds `max_stack_depth` nor goes below the
+		// number of elements an instruction uses
+		std::array<Stack_element, max_stack_depth> stack;
+		size_t size = 0;
+
+		const auto binary = [&stack, &size](auto operation)
+		{
+			stack[size - 2] = operation(stack[size - 2], stack[size - 1]);
+			size--;
+		};
+
+		const auto reference = [&stack, &size, &cpu](u32 bytes) -> bool
+		{
+			const auto value = read_memory(*cpu.interface, stack[size - 1], bytes);
+			if (!value) return false;
+
+			stack[size - 1] = *value;
+			return true;
+		};
+
+		for (size_t pc = 0;;)
+		{
+			const auto [opcode, operand] = instructions[pc++];
+
+			switch (opcode)
+			{
+			case Opcode::Add:
+				binary([](u32 a, u32 b) { return a + b; });
+				break;
+			case Opcode::Sub:
+				binary([](u32 a, u32 b) { return a - b; });
+				break;
+			case Opcode::Mul:
+				binary([](u32 a, u32 b) { return a * b; });
+				break;
+			case Opcode::Div_signed:
+			case Opcode::Div_unsigned:
+			case Opcode::Rem_signed:
+			case Opcode::Rem_unsigned:
+			{
+				const auto a = stack[size - 2], b = stack[size - 1];
+				if (b == 0) return std::unexpected(Execute_error::Division_by_zero);
+
+				switch (opcode)
+				{
+				case Opcode::Div_signed:
+					stack[size - 2] = divide_signed(a, b);
+					break;
+				case Opcode::Div_unsigned:
+					stack[size - 2] = a / b;
+					break;
+				case Opcode::Rem_signed:
+					stack[size - 2] = remainder_signed(a, b);
+					break;
+				default:
+					stack[size - 2] = a % b;
+					break;
+				}
+
+				size--;
+				break;
+			}
+			case Opcode::Lsh:
+				binary([](u32 a, u32 b) { return a << (b & 0x1F); });
+				break;
+			case Opcode::Rsh_signed:
+				binary([](u32 a, u32 b) { return static_cast<u32>(static_cast<i32>(a) >> (b & 0x1F)); });
+				break;
+			case Opcode::Rsh_unsigned:
+				binary([](u32 a, u32 b) { return a >> (b & 0x1F); });
+				break;
+			case Opcode::Log_not:
+				stack[size - 1] = stack[size - 1] == 0 ? 1 : 0;
+				break;
+			case Opcode::Bit_and:
+				binary([](u32 a, u32 b) { return a & b; });
+				break;
+			case Opcode::Bit_or:
+				binary([](u32 a, u32 b) { return a | b; });
+				break;
+			case Opcode::Bit_xor:
+				binary([](u32 a, u32 b) { return a ^ b; });
+				break;
+			case Opcode::Bit_not:
+				stack[size - 1] = ~stack[size - 1];
+				break;
+			case Opcode::Equal:
+				binary([](u32 a, u32 b) { return a == b ? 1u : 0u; });
+				break;
+			case Opcode::Less_signed:
+				binary([](u32 a, u32 b) { return static_cast<i32>(a) < static_cast<i32>(b) ? 1u : 0u; });
+				break;
+			case Opcode::Less_unsigned:
+				binary([](u32 a, u32 b) { return a < b ? 1u : 0u; });
+				break;
+			case Opcode::Ext:
+				stack[size - 1] = sign_extend(stack[size - 1], static_cast<u8>(operand));
+				break;
+			case Opcode::Zero_ext:
+				stack[size - 1] = zero_extend(stack[size - 1], static_cast<u8>(operand));
+				break;
+			case Opcode::Ref8:
+				if (!reference(1)) return std::unexpected(Execute_error::Memory_access_error);
+				break;
+			case Opcode::Ref16:
+				if (!reference(2)) return std::unexpected(Execute_error::Memory_access_error);
+				break;
+			case Opcode::Ref32:
+				if (!reference(4)) return std::unexpected(Execute_error::Memory_access_error);
+				break;
+			case Opcode::Dup:
+				stack[size] = stack[size - 1];
+				size++;
+				break;
+			case Opcode::Swap:
+				std::swap(stack[size - 1], stack[size - 2]);
+				break;
+			case Opcode::Pop:
+				size--;
+				break;
+			case Opcode::Pick:
+				stack[size] = stack[size - 1 - operand];
+				size++;
+				break;
+			case Opcode::Rot:
+			{
+				// a b c => c a b
+				const auto c = stack[size - 1];
+				stack[size - 1] = stack[size - 2];
+				stack[size - 2] = stack[size - 3];
+				stack[size - 3] = c;
+				break;
+			}
+			case Opcode::If_goto:
+				if (stack[--size] != 0) pc = operand;
+				break;
+			case Opcode::Goto:
+				pc = operand;
+				break;
+			case Opcode::Const:
+				stack[size++] = operand;
+				break;
+			case Opcode::Reg_gpr:
+				stack[size++] = cpu.registers.get_register(operand);
+				break;
+			case Opcode::Reg_pc:
+				stack[size++] = cpu.pc;
+				break;
+			case Opcode::Reg_csr:
+			{
+				const auto value = cpu.csr(
+					core::CSR_access_info{
+						.write_mode = core::CSR_write_mode::None,
+						.address = operand,
+						.read = true
+					}
+				);
+				if (!value) return std::unexpected(Execute_error::Register_access_error);
+
+				stack[size++] = *value;
+				break;
+			}
+			case Opcode::End:
+				if (size == 1) return Execute_result{.top = stack[0]};
+				return Execute_result{.top = stack[size - 1], .next_to_top = stack[size - 2]};
+			}
+		}
+	}
 }
\ No newline at end of file
@@ -1,98 +1,211 @@
 #include "gdb-stub/network.hpp"
 
 #include <print>
+#include <stdexcept>
+#include <utility>
 
 namespace gdb_stub
 {
-	Network_handler::Network_handler(u16 port)
+	Network_handler::Network_handler(asio::io_context& io_context, u16 port) :
+		io_context(io_context),
+		acceptor(io_context, asio::ip::tcp::endpoint(asio::ip::tcp::v4(), port)),
+		socket(io_context)
 	{
-		io_context = std::make_unique<asio::io_context>();
+		const std::scoped_lock lock(mutex);
+		post([this] { start_accept(); });
+	}
+
+	Network_handler::~Network_handler()
+	{
+		std::unique_lock lock(mutex);
 
-		acceptor = std::make_unique<asio::ip::tcp::acceptor>(
-			*io_context,
-			asio::ip::tcp::endpoint(asio::ip::tcp::v4(), port)
+		post(
+			[this]
+			{
+				asio::error_code error;
+				acceptor.close(error);
+				socket.close(error);
+			}
 		);
+
+		condition.wait(lock, [this] { return pending_handlers == 0; });
 	}
 
-	void Network_handler::setup_socket()
+	void Network_handler::post(std::function<void()> function)
 	{
-		if (socket && socket->is_open()) return;
+		pending_handlers++;
 
-		socket = std::make_unique<asio::ip::tcp::socket>(*io_context);
-		acceptor->accept(*socket);
+		asio::post(
+			io_context,
+			[this, function = std::move(function)]
+			{
+				const std::scoped_lock lock(mutex);
+				function();
+				pending_handlers--;
+				condition.notify_all();
+			}
+		);
 	}
 
-	std::expected<std::string, Network_handler::Error> Network_handler::get_packet_from_decoder()
+	void Network_handler::start_accept()
 	{
-		const auto timeout_begin = std::chrono::system_clock::now();
+		pending_handlers++;
 
-		while (!decoder.new_packet_available())
-		{
-			std::array<char, 1024> buf = {0};
-			const auto len = socket->read_some(asio::buffer(buf));
-
-			// Received **some** data
-			if (len > 0)
+		acceptor.async_accept(
+			socket,
+			[this](const asio::error_code& error)
 			{
-				decoder.push(std::string_view(buf.data(), len));
-				continue;
-			}
+				const std::scoped_lock lock(mutex);
+				pending_handlers--;
 
-			// Timeout exceeded
-			if (std::chrono::system_clock::now() - timeout_begin > std::chrono::milliseconds(timeout_ms))
-				return std::unexpected(Error::Protocol_retry);
+				// Failed after the acceptor is closed
+				if (!error)
+				{
+					connected = true;
+					start_read();
+				}
 
-			std::this_thread::yield();
-		}
+				condition.notify_all();
+			}
+		);
+	}
 
-		return decoder.pop_packet().or_else(
-			[](auto err) -> std::expected<std::string, Network_handler::Error>
+	void Network_handler::start_read()
+	{
+		reading = true;
+		pending_handlers++;
+
+		socket.async_read_some(
+			asio::buffer(read_buffer),
+			[this](const asio::error_code& error, size_t length)
 			{
-				switch (err)
+				const std::scoped_lock lock(mutex);
+				reading = false;
+				pending_handlers--;
+
+				// Cancelled reads belong to a closed connection
+				if (error && error != asio::error::operation_aborted) read_error = error;
+
+				if (!error)
 				{
-				case Packet_decoder::Error::Bad_checksum:
-				case Packet_decoder::Error::Bad_packet:
-					return std::unexpected(Error::Protocol_retry);
-				case Packet_decoder::Error::Buffer_overflow:
-					return std::unexpected(Error::Protocol_fail);
-				default:
-					return std::unexpected(Error::Internal_fail);
+					decoder.push(std::string_view(read_buffer.data(), length));
+					start_read();
 				}
+
+				condition.notify_all();
 			}
 		);
 	}
 
+	void Network_handler::write(std::string_view data)
+	{
+		std::unique_lock lock(mutex);
+
+		writing = true;
+		post(
+			[this, data]
+			{
+				pending_handlers++;
+
+				asio::async_write(
+					socket,
+					asio::buffer(data),
+					[this](const asio::error_code& error, size_t length [[maybe_unused]])
+					{
+						const std::scoped_lock lock(mutex);
+						writing = false;
+						write_error = error;
+						pending_handlers--;
+						condition.notify_all();
+					}
+				);
+			}
+		);
+
+		// `data` is referred to until written
+		condition.wait(lock, [this] { return !writing; });
+		if (write_error) throw std::runtime_error(std::exchange(write_error, {}).message());
+	}
+
+	bool Network_handler::wait_until(
+		std::unique_lock<std::mutex>& lock,
+		const std::function<bool()>& done,
+		std::optional<std::chrono::milliseconds> timeout
+	)
+	{
+		const auto stop = [this, &done] { return done() || read_error; };
+
+		if (!timeout.has_value())
+			condition.wait(lock, stop);
+		else if (!condition.wait_for(lock, *timeout, stop))
+			return false;
+
+		// Packets received before the error are still handled
+		if (done()) return true;
+		throw std::runtime_error(std::exchange(read_error, {}).message());
+	}
+
+	std::expected<std::optional<command::Command>, Network_handler::Error> Network_handler::
+		get_command_from_decoder(std::optional<std::chrono::milliseconds> timeout)
+	{
+		std::unique_lock lock(mutex);
+
+		if (!wait_until(lock, [this] { return decoder.new_packet_available(); }, timeout))
+			return std::unexpected(Error::Protocol_retry);
+
+		const auto packet = decoder.pop_packet();
+		if (packet.has_value()) return command::parse(*packet);
+
+		switch (packet.error())
+		{
+		case Packet_decoder::Error::Bad_checksum:
+		case Packet_decoder::Error::Bad_packet:
+			return std::unexpected(Error::Protocol_retry);
+		case Packet_decoder::Error::Buffer_overflow:
+			return std::unexpected(Error::Protocol_fail);
+		default:
+			return std::unexpected(Error::Internal_fail);
+		}
+	}
+
 	std::expected<void, Network_handler::Error> Network_handler::send(const Response& response)
 	{
-		const auto data = Packet_encoder::encode(response.to_string());
+		response_body.clear();
+		response.append_to(response_body);
+		const auto data = encoder.encode_buffered(response_body);
 
 		try
 		{
-			if (socket == nullptr) setup_socket();
+			wait_for_connection();
+
+			if (no_ack_mode)
+			{
+				write(data);
+				return {};
+			}
 
 			for (const auto _ : std::views::iota(0zu, max_retry_count))
 			{
 				// Step 1: Send the packet
-				asio::write(*socket, asio::buffer(data));
+				write(data);
 
 				// Step 2: Wait for ACK
-				const auto get_packet_result = get_packet_from_decoder();
-				if (!get_packet_result)
+				const auto get_command_result
+					= get_command_from_decoder(std::chrono::milliseconds(timeout_ms));
+				if (!get_command_result)
 				{
-					if (get_packet_result.error() == Error::Protocol_retry)
+					if (get_command_result.error() == Error::Protocol_retry)
 						continue;
 					else
-						return std::unexpected(get_packet_result.error());
+						return std::unexpected(get_command_result.error());
 				}
 
-				// Step 3: Parse ACK
-				const auto parse_command_result = command::parse(get_packet_result.value());
-				if (!parse_command_result.has_value()) return std::unexpected(Error::Protocol_fail);
-				if (parse_command_result.type() != typeid(Acknowledge_packet))
-					return std::unexpected(Error::Protocol_fail);  // Not ACK
+				// Step 3: Check ACK
+				if (!get_command_result->has_value()) return std::unexpected(Error::Protocol_fail);
 
-				const auto ack_packet = std::any_cast<Acknowledge_packet>(parse_command_result);
-				if (!ack_packet.success) continue;  // NAK, resend
+				const auto* const ack_packet = std::get_if<Acknowledge_packet>(&**get_command_result);
+				if (ack_packet == nullptr) return std::unexpected(Error::Protocol_fail);  // Not ACK
+				if (!ack_packet->success) continue;                                       // NAK, resend
 				return {};
 			}
 
@@ -105,35 +218,58 @@ namespace gdb_stub
 		}
 	}
 
-	std::expected<std::any, Network_handler::Error> Network_handler::receive()
+	std::expected<void, Network_handler::Error> Network_handler::send_notification(
+		std::string_view name,
+		const Response& response
+	)
+	{
+		response_body.assign(name);
+		response_body.push_back(':');
+		response.append_to(response_body);
+		const auto data = encoder.encode_buffered(response_body, '%');
+
+		try
+		{
+			wait_for_connection();
+			write(data);
+			return {};
+		}
+		catch (const std::exception&)
+		{
+			close();
+			return std::unexpected(Error::Connection_fault);
+		}
+	}
+
+	std::expected<command::Command, Network_handler::Error> Network_handler::receive()
 	{
 		try
 		{
-			if (socket == nullptr) setup_socket();
+			wait_for_connection();
 
 			for (const auto _ : std::views::iota(0zu, max_retry_count))
 			{
-				// Step 1: Wait for packet
-				const auto get_packet_result = get_packet_from_decoder();
-				if (!get_packet_result)
+				// Step 1: Wait for packet, GDB may stay idle for any time
+				auto get_command_result = get_command_from_decoder(std::nullopt);
+				if (!get_command_result)
 				{
-					if (get_packet_result.error() == Error::Protocol_retry)
+					if (get_command_result.error() == Error::Protocol_retry)
 					{
-						asio::write(*socket, asio::buffer("-"));  // Send NAK
+						// Without acknowledgements, corrupted packets are dropped
+						if (!no_ack_mode) write("-");  // Send NAK
 						continue;
 					}
 					else
-						return std::unexpected(get_packet_result.error());
+						return std::unexpected(get_command_result.error());
 				}
 
 				// Step 2: Receive successfully, send ACK
-				asio::write(*socket, asio::buffer("+"));
+				if (!no_ack_mode) write("+");
 
-				// Step 3: Parse command
-				auto parse_command_result = command::parse(get_packet_result.value());
-				if (!parse_command_result.has_value()) return std::unexpected(Error::Decode_fail);
+				// Step 3: Check command
+				if (!get_command_result->has_value()) return std::unexpected(Error::Decode_fail);
 
-				return parse_command_result;
+				return std::move(**get_command_result);
 			}
 
 			return std::unexpected(Error::Protocol_fail);
@@ -145,10 +281,67 @@ namespace gdb_stub
 		}
 	}
 
+	std::expected<Network_handler::Wait_result, Network_handler::Error> Network_handler::wait()
+	{
+		try
+		{
+			wait_for_connection();
+
+			std::unique_lock lock(mutex);
+			wait_until(lock, [this] { return notified || decoder.new_packet_available(); }, std::nullopt);
+
+			if (std::exchange(notified, false)) return Wait_result::Notified;
+			return Wait_result::Packet;
+		}
+		catch (const std::exception&)
+		{
+			close();
+			return std::unexpected(Error::Connection_fault);
+		}
+	}
+
+	void Network_handler::notify()
+	{
+		const std::scoped_lock lock(mutex);
+		notified = true;
+		condition.notify_all();
+	}
+
+	bool Network_handler::is_connected()
+	{
+		const std::scoped_lock lock(mutex);
+		return connected;
+	}
+
+	void Network_handler::wait_for_connection()
+	{
+		std::unique_lock lock(mutex);
+		condition.wait(lock, [this] { return connected; });
+	}
+
 	void Network_handler::close()
 	{
-		if (socket == nullptr) return;
-		if (socket->is_open()) socket->close();
-		socket.reset();
+		no_ack_mode = false;
+
+		std::unique_lock lock(mutex);
+		if (!connected) return;
+
+		post(
+			[this]
+			{
+				asio::error_code error;
+				socket.close(error);
+			}
+		);
+
+		// The cancelled read completes before the socket is reused
+		condition.wait(lock, [this] { return !reading && !writing; });
+		connected = false;
+		read_error = {};
+
+		// A packet cut by the old connection would corrupt the first one of the next
+		decoder.reset();
+
+		post([this] { start_accept(); });
 	}
 }
\ No newline at end of file
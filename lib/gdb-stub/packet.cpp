@@ -1,12 +1,42 @@
 #include "gdb-stub/packet.hpp"
 
 #include <algorithm>
-#include <iomanip>
-#include <print>
 #include <ranges>
+#include <span>
 
 namespace gdb_stub
 {
+	// Value of a hex digit, `-1` if invalid
+	static int hex_value(char c)
+	{
+		if (c >= '0' && c <= '9') return c - '0';
+		if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+		return -1;
+	}
+
+	// Remove escape characters in place, returns the decoded length or `std::nullopt` if invalid
+	static std::optional<size_t> remove_escape_in_place(std::span<char> body)
+	{
+		size_t length = 0;
+
+		for (size_t i = 0; i < body.size(); i++)
+		{
+			if (body[i] == '}')
+			{
+				i++;
+				if (i >= body.size()) return std::nullopt;
+				if (body[i] == '}') return std::nullopt;
+
+				body[length++] = static_cast<char>(body[i] ^ 0x20);
+			}
+			else
+				body[length++] = body[i];
+		}
+
+		return length;
+	}
+
 	namespace algo
 	{
 		u8 get_checksum(std::string_view body)
@@ -20,60 +50,75 @@ namespace gdb_stub
 
 		std::optional<std::string> remove_escape(std::string_view body)
 		{
-			std::string result;
+			std::string result(body);
 
-			for (size_t i = 0; i < body.length(); i++)
-			{
-				if (body[i] == '}')
-				{
-					i++;
-					if (i >= body.length()) return std::nullopt;
-					if (body[i] == '}') return std::nullopt;
-
-					result.push_back(static_cast<char>(body[i] ^ 0x20));
-				}
-				else
-				{
-					result.push_back(body[i]);
-				}
-			}
+			const auto length = remove_escape_in_place(result);
+			if (!length.has_value()) return std::nullopt;
 
+			result.resize(*length);
 			return result;
 		}
 	}
 
-	std::expected<std::string, Packet_decoder::Error> Packet_decoder::decode_in_buffer()
+	void Packet_decoder::push_error(Error error)
 	{
-		try
-		{
-			if (!std::ranges::all_of(checksum_buffer, [](char c) { return std::isxdigit(c); }))
-				return std::unexpected(Error::Bad_packet);
+		restart_body();
+		entries.push_back({.offset = body_offset, .error = error});
+	}
 
-			const std::string checksum_str = {checksum_buffer[0], checksum_buffer[1]};
-			const u8 received_checksum = static_cast<u8>(std::stoi(checksum_str, nullptr, 16));
-			const u8 computed_checksum = algo::get_checksum(in_buffer);
+	void Packet_decoder::push_single(char c)
+	{
+		restart_body();
+		buffer.push_back(c);
+		entries.push_back({.offset = body_offset, .length = 1});
+		body_offset = buffer.size();
+	}
 
-			if (received_checksum != computed_checksum) return std::unexpected(Error::Bad_checksum);
+	void Packet_decoder::restart_body()
+	{
+		buffer.resize(body_offset);
+		checksum = 0;
+	}
+
+	void Packet_decoder::finish_body()
+	{
+		const auto high = hex_value(checksum_buffer[0]);
+		const auto low = hex_value(checksum_buffer[1]);
+		if (high < 0 || low < 0)
+		{
+			push_error(Error::Bad_packet);
+			return;
+		}
 
-			const auto remove_escape_result = algo::remove_escape(in_buffer);
-			if (!remove_escape_result) return std::unexpected(Error::Bad_packet);
-			return remove_escape_result.value();
+		if (high * 16 + low != checksum)
+		{
+			push_error(Error::Bad_checksum);
+			return;
 		}
-		catch (...)
+
+		const auto length = remove_escape_in_place(std::span(buffer).subspan(body_offset));
+		if (!length.has_value())
 		{
-			return std::unexpected(Error::Internal_error);
+			push_error(Error::Bad_packet);
+			return;
 		}
+
+		buffer.resize(body_offset + *length);
+		entries.push_back({.offset = body_offset, .length = *length});
+		body_offset = buffer.size();
+		checksum = 0;
 	}
 
 	void Packet_decoder::push(std::string_view new_input)
 	{
-		auto push_result = [&](std::expected<std::string, Error> result)
+		// Every packet has been popped, reuse the buffer for the next ones
+		if (next_entry == entries.size() && next_entry != 0)
 		{
-			const std::scoped_lock lock(out_queue_mutex);
-			out_queue.emplace(std::move(result));
-			out_queue_available = true;
-			in_buffer.clear();
-		};
+			buffer.erase(0, body_offset);
+			body_offset = 0;
+			entries.clear();
+			next_entry = 0;
+		}
 
 		for (const char c : new_input)
 		{
@@ -81,9 +126,12 @@ namespace gdb_stub
 			{
 			case State::Waiting_dollar:
 				if (c == '$')
+				{
+					restart_body();
 					state = State::Receiving_body;
+				}
 				else if (c == '+' || c == '-' || c == '\x03')  // ACK, NAK, Ctrl-C
-					push_result(std::string({c}));
+					push_single(c);
 				break;
 
 			case State::Receiving_body:
@@ -95,33 +143,34 @@ namespace gdb_stub
 
 				if (c == '$')
 				{
-					push_result(std::unexpected(Error::Bad_packet));
+					push_error(Error::Bad_packet);
 					state = State::Receiving_body;
 					break;
 				}
 
-				if (in_buffer.size() >= max_buffer_size)
+				if (buffer.size() - body_offset >= max_buffer_size)
 				{
-					push_result(std::unexpected(Error::Buffer_overflow));
+					push_error(Error::Buffer_overflow);
 					state = State::Waiting_dollar;
 					break;
 				}
 
-				in_buffer.push_back(c);
+				buffer.push_back(c);
+				checksum += static_cast<u8>(c);
 				break;
 
 			case State::Receiving_checksum1:
 				if (c == '$')
 				{
-					push_result(std::unexpected(Error::Bad_packet));
+					push_error(Error::Bad_packet);
 					state = State::Receiving_body;
 					break;
 				}
 
 				if (c == '+' || c == '-' || c == '\x03')
 				{
-					push_result(std::unexpected(Error::Bad_packet));
-					push_result(std::string({c}));
+					push_error(Error::Bad_packet);
+					push_single(c);
 					state = State::Waiting_dollar;
 					break;
 				}
@@ -133,106 +182,121 @@ namespace gdb_stub
 			case State::Receiving_checksum2:
 				if (c == '$')
 				{
-					push_result(std::unexpected(Error::Bad_packet));
+					push_error(Error::Bad_packet);
 					state = State::Receiving_body;
 					break;
 				}
 
 				if (c == '+' || c == '-' || c == '\x03')
 				{
-					push_result(std::unexpected(Error::Bad_packet));
-					push_result(std::string({c}));
+					push_error(Error::Bad_packet);
+					push_single(c);
 					state = State::Waiting_dollar;
 					break;
 				}
 
 				checksum_buffer[1] = c;
-				push_result(decode_in_buffer());
+				finish_body();
 				state = State::Waiting_dollar;
 				break;
 			}
 		}
 	}
 
-	bool Packet_decoder::new_packet_available()
+	bool Packet_decoder::new_packet_available() const
 	{
-		return out_queue_available;
+		return next_entry < entries.size();
 	}
 
-	std::expected<std::string, Packet_decoder::Error> Packet_decoder::pop_packet()
+	std::expected<std::string_view, Packet_decoder::Error> Packet_decoder::pop_packet()
 	{
-		const std::scoped_lock lock(out_queue_mutex);
+		if (next_entry >= entries.size()) return std::unexpected(Error::No_new_packet);
 
-		if (out_queue.empty()) return std::unexpected(Error::No_new_packet);
+		const auto& entry = entries[next_entry++];
+		if (entry.error.has_value()) return std::unexpected(*entry.error);
 
-		auto packet = std::move(out_queue.front());
-		out_queue.pop();
-		out_queue_available = !out_queue.empty();
+		return std::string_view(buffer).substr(entry.offset, entry.length);
+	}
 
-		return packet;
+	void Packet_decoder::reset() noexcept
+	{
+		buffer.clear();
+		body_offset = 0;
+		entries.clear();
+		next_entry = 0;
+		checksum = 0;
+		state = State::Waiting_dollar;
 	}
 
-	void Packet_encoder::push_repeat()
+	void Packet_encoder::put(char c)
 	{
-		if (repeat == 0 || last_char == '\0') return;
+		packet.push_back(c);
+		checksum += static_cast<u8>(c);
+	}
 
-		if (repeat <= 2)
+	void Packet_encoder::put_escaped(char c)
+	{
+		if (c == '*' || c == '$' || c == '}' || c == '#')  // escape characters
 		{
-			stream << std::string(repeat, last_char);
-			return;
+			put('}');
+			put(static_cast<char>(u8(c) ^ 0x20));
 		}
+		else  // normal characters
+			put(c);
+	}
 
-		if (repeat == 6)
+	void Packet_encoder::put_repeat(char c, size_t count)
+	{
+		// Short runs are cheaper as they are. Counts of 6 and 7 would encode as `#` and `$`, so they are
+		// split into a run of 5 and the remaining characters.
+		if (count <= 2)
 		{
-			stream << std::format("*\"{}", last_char);
+			for (size_t i = 0; i < count; i++) put_escaped(c);
 			return;
 		}
-		if (repeat == 7)
+
+		if (count == 6 || count == 7)
 		{
-			stream << std::format("*\"{0}{0}", last_char);
+			put('*');
+			put('"');
+			put_repeat(c, count - 5);
 			return;
 		}
 
-		stream << std::format("*{}", char(repeat + 29));
+		put('*');
+		put(static_cast<char>(count + 29));
 	}
 
-	void Packet_encoder::push(char c)
+	std::string_view Packet_encoder::encode_buffered(std::string_view str, char leader)
 	{
-		if (c == '\0') return;
+		constexpr size_t max_repeat = 126 - 29;
 
-		if (c != last_char || repeat >= 126 - 29)
-		{
-			push_repeat();
-			last_char = c;
-			repeat = 0;
+		packet.clear();
+		checksum = 0;
 
-			if (c == '*' || c == '$' || c == '}' || c == '#')  // escape characters
-			{
-				stream << '}';
-				stream << char(u8(c) ^ 0x20);
-			}
-			else  // normal characters
-				stream << c;
-		}
-		else
+		packet.push_back(leader);
+
+		for (size_t i = 0; i < str.size();)
 		{
-			repeat++;
+			const char c = str[i];
+
+			size_t count = 1;
+			while (i + count < str.size() && str[i + count] == c && count <= max_repeat) count++;
+
+			put_escaped(c);
+			put_repeat(c, count - 1);
+			i += count;
 		}
-	}
 
-	std::string Packet_encoder::internal_encode(std::string_view str)
-	{
-		for (auto c : str) push(c);
-		push_repeat();
-		const auto result_str = stream.str();
-		const auto checksum = algo::get_checksum(result_str);
+		packet.push_back('#');
+		algo::append_hex(packet, checksum);
 
-		return std::format("${}#{:02x}", result_str, checksum);
+		return packet;
 	}
 
 	std::string Packet_encoder::encode(std::string_view str)
 	{
 		Packet_encoder encoder;
-		return encoder.internal_encode(str);
+		return std::string(encoder.encode_buffered(str));
 	}
-}
+}
\ No newline at end of file
@@ -1,39 +1,62 @@
 #include "gdb-stub/response.hpp"
+#include "gdb-stub/packet.hpp"
 
-#include <algorithm>
 #include <csignal>
-#include <ranges>
+#include <format>
+#include <iterator>
 
 namespace gdb_stub::response
 {
-	std::string Single_register_content::to_string() const
+	void Single_register_content::append_to(std::string& out) const
 	{
-		if (!value.has_value()) return "xxxxxxxx";
-		return std::format("{:08x}", *value);
+		if (!value.has_value())
+		{
+			out += "xxxxxxxx";
+			return;
+		}
+
+		for (const auto shift : {24, 16, 8, 0}) algo::append_hex(out, static_cast<u8>(*value >> shift));
+	}
+
+	void Register_content::append_to(std::string& out) const
+	{
+		out.reserve(out.size() + reg_values.size() * 8);
+
+		// Registers are sent in target byte order
+		for (const auto& value : reg_values)
+		{
+			if (!value.has_value())
+			{
+				out += "xxxxxxxx";
+				continue;
+			}
+
+			for (const auto shift : {0, 8, 16, 24}) algo::append_hex(out, static_cast<u8>(*value >> shift));
+		}
 	}
 
-	std::string Register_content::to_string() const
+	void Raw_byte_stream::append_to(std::string& out) const
 	{
-		return reg_values
-			 | std::views::transform(
-				   [](auto val)
-				   {
-					   return val.has_value() ? std::format("{:08x}", std::byteswap(val.value()))
-											  : std::string("xxxxxxxx");
-				   }
-			 )
-			 | std::views::join
-			 | std::ranges::to<std::string>();
+		if (data.empty())
+		{
+			out += "E00";
+			return;
+		}
+
+		out.reserve(out.size() + data.size() * 2);
+		for (const auto byte : data) algo::append_hex(out, byte);
 	}
 
-	std::string Raw_byte_stream::to_string() const
+	void Error_code::append_to(std::string& out) const
 	{
-		if (data.empty()) return "E00";
+		out += 'E';
+		algo::append_hex(out, code);
+	}
 
-		return data
-			 | std::views::transform([](auto val) { return std::format("{:02x}", val); })
-			 | std::views::join
-			 | std::ranges::to<std::string>();
+	void Error_message::append_to(std::string& out) const
+	{
+		out += "E.";
+		out += message;
 	}
 
 	Stop_reason::Stop_reason(u8 signal) :
@@ -51,12 +74,14 @@ namespace gdb_stub::response
 		hit(breakpoint_hit)
 	{}
 
-	std::string Stop_reason::parse_hit_string(std::monostate hit [[maybe_unused]])
-	{
-		return "";
-	}
+	Stop_reason::Stop_reason(History_begin history_begin) :
+		signal(SIGTRAP),
+		hit(history_begin)
+	{}
 
-	std::string Stop_reason::parse_hit_string(Watchpoint_hit hit)
+	void Stop_reason::append_hit(std::string& out [[maybe_unused]], std::monostate hit [[maybe_unused]]) {}
+
+	void Stop_reason::append_hit(std::string& out, Watchpoint_hit hit)
 	{
 		const char* watch_str;
 
@@ -67,35 +92,37 @@ namespace gdb_stub::response
 		else if (hit.is_write)
 			watch_str = "watch";
 		else
-			return "";
+			return;
 
-		return std::format("{}:{:x};", watch_str, hit.address);
+		std::format_to(std::back_inserter(out), "{}:{:x};", watch_str, hit.address);
 	}
 
-	std::string Stop_reason::parse_hit_string(Breakpoint_hit hit)
+	void Stop_reason::append_hit(std::string& out, Breakpoint_hit hit)
 	{
-		return std::format("{}:;", hit.is_hardware ? "hwbreak" : "swbreak");
+		out += hit.is_hardware ? "hwbreak:;" : "swbreak:;";
 	}
 
-	std::string Stop_reason::to_string() const
+	void Stop_reason::append_hit(std::string& out, History_begin hit [[maybe_unused]])
 	{
-		const auto hit_string = std::visit([](auto x) { return parse_hit_string(x); }, hit);
-
-		std::string signal_string = std::format("T{:02x}{}", signal, hit_string);
-
-		return signal_string;
+		out += "replaylog:begin;";
 	}
 
-	std::string Qxfer_response::to_string() const
+	void Stop_reason::append_to(std::string& out) const
 	{
-		using namespace std::string_literals;
+		out += 'T';
+		algo::append_hex(out, signal);
+		std::visit([&out](auto x) { append_hit(out, x); }, hit);
+	}
 
-		return (completed ? "l"s : "m"s) + std::string((const char*)data.data(), data.size());
+	void Qxfer_response::append_to(std::string& out) const
+	{
+		out += completed ? 'l' : 'm';
+		out.append(reinterpret_cast<const char*>(data.data()), data.size());
 	}
 
-	std::string Qsupported_response::to_string() const
+	void Qsupported_response::append_to(std::string& out) const
 	{
-		return
+		out +=
 #include "stub-feature.inc"
 			;
 	}
@@ -0,0 +1,20 @@
+#include "gdb-stub/server.hpp"
+
+namespace gdb_stub
+{
+	Debug_server::Debug_server() :
+		work_guard(asio::make_work_guard(io_context)),
+		io_thread([this] { io_context.run(); })
+	{}
+
+	Debug_server::~Debug_server()
+	{
+		work_guard.reset();
+		io_context.stop();
+	}
+
+	std::unique_ptr<Network_handler> Debug_server::listen(u16 port)
+	{
+		return std::make_unique<Network_handler>(io_context, port);
+	}
+}
@@ -1,29 +1,52 @@
 #include "gdb-stub/stop-point.hpp"
-#include "gdb-stub/accessor.hpp"
-#include "gdb-stub/expression.hpp"
+
+#include <algorithm>
 
 namespace gdb_stub
 {
-	bool Hw_breakpoint::is_triggered_by(core::CPU_module& cpu) const
+	bool Breakpoint::is_triggered_by(core::CPU_module& cpu) const
 	{
 		if (cpu.pc != address) return false;
-		if (!cond.has_value()) return true;
-
-		const Memory_accessor mem_accessor{.memory = *cpu.interface};
-		const CPU_register_accessor reg_accessor{.cpu = cpu};
+		if (conds.empty()) return true;
 
-		const auto result = expression::execute(
-			[&mem_accessor](u32 val) { return mem_accessor.read(val); },
-			[&reg_accessor](u32 val) { return reg_accessor.read(val); },
-			*cond
+		// A condition failing to evaluate doesn't hold
+		return std::ranges::any_of(
+			conds,
+			[&cpu](const expression::Compiled_expression& cond)
+			{
+				const auto result = cond.execute(cpu);
+				return result.has_value() && result->top;
+			}
 		);
+	}
+
+	std::expected<Breakpoint, expression::Execute_error> Breakpoint::from(const command::Add_breakpoint& cmd)
+	{
+		Breakpoint breakpoint{.address = cmd.address};
+
+		for (const auto& cond : cmd.conds)
+		{
+			auto compiled = expression::Compiled_expression::compile(cond);
+			if (!compiled) return std::unexpected(compiled.error());
+
+			breakpoint.conds.push_back(std::move(*compiled));
+		}
+
+		return breakpoint;
+	}
+
+	void Watch_page_filter::add(Address_range range)
+	{
+		if (range.size == 0) return;
+
+		const u64 last_address = std::min<u64>(u64(range.start) + range.size - 1, 0xffff'ffff);
 
-		if (!result) return false;
-		return result->top;
+		for (u64 page = range.start >> page_shift; page <= last_address >> page_shift; page++)
+			bitmap[page / 64] |= u64(1) << (page % 64);
 	}
 
-	Hw_breakpoint Hw_breakpoint::from(const command::Add_breakpoint& cmd)
+	void Watch_page_filter::clear() noexcept
 	{
-		return Hw_breakpoint{.address = cmd.address, .cond = cmd.cond};
+		std::ranges::fill(bitmap, 0);
 	}
 }
\ No newline at end of file
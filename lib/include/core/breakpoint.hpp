@@ -0,0 +1,79 @@
+#pragma once
+
+#include "common/type.hpp"
+
+#include <bitset>
+#include <unordered_map>
+
+namespace core
+{
+	/**
+	 * @brief Set of instruction addresses, indexed by 4 KiB page
+	 * @note Each page holding breakpoints has a bitmap of its 1024 instruction slots, so both testing an
+	 * address and enumerating the breakpoints of a page don't depend on the number of breakpoints.
+	 */
+	class Breakpoint_set
+	{
+	  public:
+
+		static constexpr u32 page_size_bytes = 4096;
+
+		/**
+		 * @brief Bitmap of the breakpoints in a page, one bit per 4-byte instruction slot
+		 *
+		 */
+		using Page_bitmap = std::bitset<page_size_bytes / 4>;
+
+		/**
+		 * @brief Add a breakpoint
+		 *
+		 * @param address Word-aligned address
+		 * @return `true` if added, `false` if already present
+		 */
+		bool insert(u32 address);
+
+		/**
+		 * @brief Remove a breakpoint
+		 *
+		 * @param address Address of the breakpoint
+		 * @return `true` if removed, `false` if not present
+		 */
+		bool erase(u32 address);
+
+		/**
+		 * @brief Check if there is a breakpoint at `address`
+		 *
+		 */
+		bool contains(u32 address) const noexcept
+		{
+			const auto* bitmap = get_page(address);
+			return bitmap != nullptr && bitmap->test(get_slot(address));
+		}
+
+		/**
+		 * @brief Get the bitmap of the page containing `address`
+		 *
+		 * @return Bitmap of the page, `nullptr` if the page has no breakpoint
+		 */
+		const Page_bitmap* get_page(u32 address) const noexcept
+		{
+			if (pages.empty()) [[likely]]
+				return nullptr;
+
+			const auto find = pages.find(address / page_size_bytes);
+			return find != pages.end() ? &find->second : nullptr;
+		}
+
+		/**
+		 * @brief Get the slot of `address` in its page bitmap
+		 *
+		 */
+		static size_t get_slot(u32 address) noexcept { return (address % page_size_bytes) / 4; }
+
+		bool empty() const noexcept { return pages.empty(); }
+
+	  private:
+
+		std::unordered_map<u32, Page_bitmap> pages;  // Page number -> bitmap, only pages with breakpoints
+	};
+}
@@ -10,6 +10,7 @@
 #include <functional>
 #include <memory>
 #include <optional>
+#include <span>
 #include <utility>
 
 namespace core
@@ -60,6 +61,21 @@ namespace core
 
 		std::shared_ptr<Memory_interface> interface;
 
+		/* Coverage */
+
+		/**
+		 * @brief Edge coverage counters, disabled if empty
+		 * @note Updated with the (source, target) edge of every branch and jump, taken or not. Size must be a
+		 * power of 2.
+		 */
+		std::span<u8> coverage_map;
+
+		/**
+		 * @brief Hashed location of the previous edge target, see `record_edge()`
+		 *
+		 */
+		u32 coverage_prev_location = 0;
+
 		/* Constructor */
 
 		CPU_module(u32 init_pc, std::shared_ptr<Memory_interface> interface) :
@@ -89,5 +105,19 @@ namespace core
 		 * @return Result of the emulation
 		 */
 		Result step();
+
+		/**
+		 * @brief Record an edge from the previous edge target to `target` in `coverage_map`
+		 *
+		 * @param target Address of the next instruction
+		 */
+		void record_edge(u32 target) noexcept
+		{
+			u32 location = (target >> 2) * 0x9e37'79b1;
+			location ^= location >> 16;
+
+			coverage_map[(location ^ coverage_prev_location) & (coverage_map.size() - 1)]++;
+			coverage_prev_location = location >> 1;
+		}
 	};
 }
@@ -8,6 +8,8 @@
 #include "trap.hpp"
 
 #include <expected>
+#include <span>
+#include <string_view>
 
 namespace core
 {
@@ -51,6 +53,7 @@ namespace core
 
 			bool fencei = false;
 			bool ecall = false;
+			bool ebreak = false;
 			bool mret = false;
 
 			CSR_access_info csr_access_info = {};
@@ -70,4 +73,99 @@ namespace core
 			u32 pc
 		) noexcept;
 	};
+
+	/**
+	 * @brief Encoding format of an instruction, selects where the immediate is taken from
+	 *
+	 */
+	enum class Inst_format : u8
+	{
+		R,
+		I,
+		S,
+		B,
+		U,
+		J
+	};
+
+	/**
+	 * @brief Operands filled into the decode result on top of `Inst_descriptor::preset`
+	 * @note The immediate is extracted as of `Inst_descriptor::format`
+	 */
+	enum class Operand_layout : u8
+	{
+		None,      // No operand
+		Upper,     // `rd`, ALU: U-type `imm`, `0`
+		Upper_pc,  // `rd`, ALU: `PC`, U-type `imm`
+		Jump,      // `rd`, ALU: `PC`, J-type `imm`
+		Reg_imm,   // `rd`, ALU: `rs1`, I-type `imm`
+		Reg_reg,   // `rd`, ALU: `rs1`, `rs2`
+		Store,     // ALU: `rs1`, S-type `imm`, store value: `rs2`
+		Branch,    // ALU: `PC`, B-type `imm`, branch: `rs1`, `rs2`
+		Csr_reg,   // `rd`, CSR: address `imm`, write value `rs1`
+		Csr_imm    // `rd`, CSR: address `imm`, write value: the `rs1` field
+	};
+
+	/**
+	 * @brief Description of an instruction encoding, an entry of the decode table
+	 * @note An instruction matches if `(instr & mask) == match`. Adding an instruction of an extension only
+	 * takes a new entry, if its operation is supported by the execution modules.
+	 */
+	struct Inst_descriptor
+	{
+		std::string_view name;  // Mnemonic
+		u32 mask;               // Bits fixed by the encoding
+		u32 match;              // Values of the bits in `mask`
+		Inst_format format;
+		Operand_layout operands;
+		Inst_decode_module::Result preset;  // Fields of the result that don't depend on the operands
+	};
+
+	/**
+	 * @brief Extract the immediate of an instruction, sign extended
+	 *
+	 * @param format Format of the instruction
+	 * @param instr Instruction word
+	 * @return Immediate, `0` for `Inst_format::R`
+	 */
+	constexpr u32 get_immediate(Inst_format format, u32 instr) noexcept
+	{
+		const auto upper = static_cast<i32>(instr);
+
+		switch (format)
+		{
+		case Inst_format::I:
+			return static_cast<u32>(upper >> 20);
+		case Inst_format::S:
+			return (static_cast<u32>(upper >> 20) & ~0x1fu) | ((instr >> 7) & 0x1f);
+		case Inst_format::B:
+			return (static_cast<u32>(upper >> 19) & ~0xfffu)
+				 | ((instr << 4) & 0x800)
+				 | ((instr >> 20) & 0x7e0)
+				 | ((instr >> 7) & 0x1e);
+		case Inst_format::U:
+			return instr & 0xfffff000;
+		case Inst_format::J:
+			return (static_cast<u32>(upper >> 11) & ~0xfffffu)
+				 | (instr & 0xff000)
+				 | ((instr >> 9) & 0x800)
+				 | ((instr >> 20) & 0x7fe);
+		default:
+			return 0;
+		}
+	}
+
+	/**
+	 * @brief Find the descriptor of an instruction in the decode table
+	 *
+	 * @param instr Instruction word
+	 * @return Matching descriptor, `nullptr` if the instruction is illegal
+	 */
+	const Inst_descriptor* find_inst_descriptor(u32 instr) noexcept;
+
+	/**
+	 * @brief Get all entries of the decode table
+	 *
+	 */
+	std::span<const Inst_descriptor> get_inst_descriptors() noexcept;
 }
\ No newline at end of file
@@ -1,11 +1,15 @@
 #pragma once
 
+#include "breakpoint.hpp"
 #include "common/bitset.hpp"
 #include "common/type.hpp"
 #include "trap.hpp"
 
+#include <array>
 #include <cstddef>
 #include <expected>
+#include <span>
+#include <utility>
 #include <vector>
 
 namespace core
@@ -60,6 +64,29 @@ namespace core
 		 * @return Size in bytes
 		 */
 		virtual u64 size() const = 0;
+
+		/**
+		 * @brief Reads a block of bytes from memory.
+		 * @note The default implementation uses word reads. Devices backed by plain storage override it to
+		 * copy whole pages at once.
+		 *
+		 * @param address 64-bit address, any alignment
+		 * @param data Buffer to store the read data, its size determines the number of bytes read
+		 * @return `Error` if any part of the block can't be read, `void` otherwise.
+		 */
+		virtual std::expected<void, Error> read_block(u64 address, std::span<u8> data);
+
+		/**
+		 * @brief Writes a block of bytes to memory.
+		 * @note The default implementation uses masked word writes. Devices backed by plain storage override
+		 * it to copy whole pages at once.
+		 *
+		 * @param address 64-bit address, any alignment
+		 * @param data Data to write
+		 * @return `Error` if any part of the block can't be written, `void` otherwise. Bytes before the
+		 * failing part may have been written.
+		 */
+		virtual std::expected<void, Error> write_block(u64 address, std::span<const u8> data);
 	};
 
 	/**
@@ -110,11 +137,33 @@ namespace core
 			std::array<u32, 1024> data;
 			u32 address = 0;
 			bool valid = false;
+
+			// Slot and original instruction of each breakpoint patched into `data`
+			std::vector<std::pair<u16, u32>> originals;
 		};
 
 		static constexpr size_t cache_num = 1024;
 		std::vector<Cache_entry> cache = std::vector<Cache_entry>(cache_num);
 
+		/**
+		 * @brief Encoding of `ebreak`, fetched in place of the instructions at `breakpoints`
+		 *
+		 */
+		static constexpr u32 ebreak_inst = 0x0010'0073;
+
+		/**
+		 * @brief Addresses of breakpoints
+		 * @note Breakpoints are patched into the cached copy when a page is loaded, memory itself is never
+		 * modified. Use `add_breakpoint()` and `remove_breakpoint()` to keep the cache coherent.
+		 */
+		Breakpoint_set breakpoints;
+
+		/**
+		 * @brief Fetch the original instruction instead of the `ebreak` of a breakpoint
+		 * @note Steps over a breakpoint without invalidating its cached page. Set for a single fetch.
+		 */
+		bool bypass_breakpoints = false;
+
 		std::expected<u32, Trap> operator()(Memory_interface& interface, u32 pc);
 
 		/**
@@ -122,6 +171,21 @@ namespace core
 		 *
 		 */
 		void fencei();
+
+		/**
+		 * @brief Fetch `ebreak` instead of the instruction at `address`
+		 *
+		 * @param address Word-aligned address of the instruction
+		 */
+		void add_breakpoint(u32 address);
+
+		/**
+		 * @brief Remove a breakpoint added by `add_breakpoint()`
+		 *
+		 * @param address Address of the breakpoint
+		 * @return `true` if removed, `false` if no such breakpoint
+		 */
+		bool remove_breakpoint(u32 address);
 	};
 
 	size_t get_size(Load_store_module::Funct funct);
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "common/type.hpp"
+
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace device
+{
+	/**
+	 * @brief Maps addresses to one of a set of non-overlapping ranges in constant time
+	 * @note
+	 * - The lower 4 GiB are covered by a two-level table: the top 12 address bits select a 1 MiB chunk, and
+	 *   chunks shared by several ranges are split again into 4 KiB pages. Each entry holds the only range
+	 *   that may contain the address, which is then bounds-checked.
+	 * - Addresses above 4 GiB and pages shared by several ranges fall back to a binary search.
+	 */
+	class Address_decoder
+	{
+	  public:
+
+		/**
+		 * @brief Address range `[base, base + size)`
+		 *
+		 */
+		struct Range
+		{
+			u64 base;
+			u64 size;
+		};
+
+		/**
+		 * @brief Rebuild the lookup table
+		 *
+		 * @param ranges Ranges to decode, sorted by base address and non-overlapping
+		 * @throws std::invalid_argument If a range is empty or exceeds the address space, if the ranges are
+		 * unsorted or overlapping, or if there are too many of them
+		 */
+		void build(std::span<const Range> ranges);
+
+		/**
+		 * @brief Find the range containing an address
+		 *
+		 * @param address Address to decode
+		 * @return Index of the range in the list given to `build()`, `std::nullopt` if not mapped
+		 */
+		std::optional<size_t> find(u64 address) const noexcept
+		{
+			if (address >> table_address_bits != 0) [[unlikely]]
+				return search(address);
+
+			auto candidate = chunk_table[address >> chunk_shift];
+
+			if (candidate & page_table_flag) [[unlikely]]
+			{
+				const auto page = (address >> page_shift) & (pages_per_chunk - 1);
+				candidate = page_tables[(candidate & ~page_table_flag) * pages_per_chunk + page];
+
+				if (candidate == ambiguous) [[unlikely]]
+					return search(address);
+			}
+
+			if (candidate == unmapped) [[unlikely]]
+				return std::nullopt;
+
+			const auto& range = ranges[candidate];
+			if (address - range.base >= range.size) [[unlikely]]
+				return std::nullopt;
+
+			return candidate;
+		}
+
+	  private:
+
+		static constexpr u32 table_address_bits = 32;
+		static constexpr u32 chunk_shift = 20;  // 1 MiB chunks, 4096 entries
+		static constexpr u32 page_shift = 12;   // 4 KiB pages, 256 entries per chunk
+		static constexpr u64 pages_per_chunk = 1 << (chunk_shift - page_shift);
+
+		// Entry: range index, `unmapped`, `ambiguous`, or page table index with `page_table_flag`
+		static constexpr u32 page_table_flag = 0x8000'0000;
+		static constexpr u32 unmapped = page_table_flag - 1;
+		static constexpr u32 ambiguous = page_table_flag - 2;
+
+		std::vector<Range> ranges;
+		std::vector<u32> chunk_table = std::vector<u32>(1 << (table_address_bits - chunk_shift), unmapped);
+		std::vector<u32> page_tables;
+
+		std::optional<size_t> search(u64 address) const noexcept;
+	};
+}
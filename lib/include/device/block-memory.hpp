@@ -19,7 +19,7 @@ namespace device
 		None,     // No filling. Use uninitialized memory (may contain garbage)
 		Zero,     // Fill with zeros
 		One,      // Fill with ones (`0xFF`)
-		Random,   // Fill with random data
+		Random,   // Fill with random data, given by the seed of the memory and the page index
 		Cdcdcdcd  // Fill with `0xCD` pattern
 	};
 
@@ -38,6 +38,30 @@ namespace device
 		static constexpr u64 page_size_bytes = 64 * 1024;
 		static_assert(page_size_bytes % sizeof(u32) == 0);
 
+		using Page = std::array<u32, page_size_bytes / sizeof(u32)>;
+
+		/**
+		 * @brief Copy of the memory content, see `take_snapshot()`
+		 *
+		 */
+		struct Snapshot
+		{
+			std::vector<std::unique_ptr<Page>> pages;  // `nullptr` for pages not allocated
+			u64 epoch = 0;                             // Dirty tracking epoch started by the snapshot
+		};
+
+		/**
+		 * @brief Copy of the memory content sharing unchanged pages with other checkpoints, see
+		 * `take_checkpoint()`
+		 *
+		 */
+		struct Checkpoint
+		{
+			// Allocated pages, by index
+			std::vector<std::pair<size_t, std::shared_ptr<const Page>>> pages;
+			u64 epoch = 0;  // Dirty tracking epoch started by the checkpoint
+		};
+
 		/**
 		 * @brief Construct a new `Block_memory`
 		 *
@@ -58,6 +82,8 @@ namespace device
 		std::expected<u32, Error> read(u64 address) override;
 		std::expected<void, Error> read_page(u64 address, std::span<u32, 1024> data) override;
 		std::expected<void, Error> write(u64 address, u32 data, core::Bitset<4> mask) override;
+		std::expected<void, Error> read_block(u64 address, std::span<u8> data) override;
+		std::expected<void, Error> write_block(u64 address, std::span<const u8> data) override;
 		size_t size() const override { return actual_size_bytes; }
 
 		/**
@@ -81,22 +107,124 @@ namespace device
 		 *
 		 * @return size_t Used space in bytes
 		 */
-		size_t used_space() const noexcept;
+		size_t used_space() const noexcept { return allocated_pages * page_size_bytes; }
 
 		/**
-		 * @brief Reset all contents, keeping the fill policy.
+		 * @brief Reset all contents, keeping the fill policy and the random seed.
+		 * @note Also clears the dirty pages
 		 *
 		 */
 		void reset_content() noexcept;
 
+		/**
+		 * @brief Get the seed of `Fill_policy::Random`, drawn from `std::random_device` at construction
+		 *
+		 */
+		u64 get_random_seed() const noexcept { return random_seed; }
+
+		/**
+		 * @brief Set the seed of `Fill_policy::Random`, e.g. to reproduce a previous run
+		 * @note Only pages allocated afterwards are affected. Set it before accessing the memory.
+		 *
+		 */
+		void set_random_seed(u64 seed) noexcept { random_seed = seed; }
+
+		/* Dirty Tracking */
+
+		/**
+		 * @brief Number of pages, including pages not allocated yet
+		 *
+		 */
+		size_t page_count() const noexcept { return storage.size(); }
+
+		/**
+		 * @brief Check whether a page was written since the last `clear_dirty_pages()`
+		 *
+		 * @param page_index Page index, address divided by `page_size_bytes`
+		 */
+		bool is_page_dirty(size_t page_index) const noexcept
+		{
+			return (dirty_bitmap[page_index / 64] >> (page_index % 64)) & 1;
+		}
+
+		/**
+		 * @brief Get indices of all pages written since the last `clear_dirty_pages()`
+		 *
+		 * @return Dirty page indices, in ascending order
+		 */
+		std::vector<size_t> get_dirty_pages() const;
+
+		/**
+		 * @brief Clear all dirty pages and start a new epoch
+		 *
+		 */
+		void clear_dirty_pages() noexcept;
+
+		/* Snapshot */
+
+		/**
+		 * @brief Copy the current content, and start a new dirty tracking epoch
+		 * @note Only allocated pages are copied. Clears the dirty pages.
+		 *
+		 * @return Snapshot of the content
+		 */
+		Snapshot take_snapshot();
+
+		/**
+		 * @brief Restore the content to a snapshot taken from this memory
+		 * @note If no other snapshot was taken and the dirty pages weren't cleared since `snapshot` was taken
+		 * or last restored, only the dirty pages are restored. Otherwise all pages are restored. Pages not
+		 * allocated in the snapshot are released. Clears the dirty pages.
+		 *
+		 * @param snapshot Snapshot returned by `take_snapshot()`
+		 */
+		void restore_snapshot(const Snapshot& snapshot);
+
+		/* Checkpoint */
+
+		/**
+		 * @brief Capture the current content, and start a new dirty tracking epoch
+		 * @note If `previous` is the latest checkpoint taken or restored and the dirty pages weren't cleared
+		 * since, only the dirty pages are copied and the others are shared with `previous`. Otherwise all
+		 * allocated pages are copied. Clears the dirty pages.
+		 *
+		 * @param previous Latest checkpoint, `nullptr` if none
+		 * @return Checkpoint of the content
+		 */
+		Checkpoint take_checkpoint(const Checkpoint* previous);
+
+		/**
+		 * @brief Restore the content to a checkpoint taken from this memory
+		 * @note If `latest` is the latest checkpoint taken or restored and the dirty pages weren't cleared
+		 * since, only the dirty pages and the pages not shared by `checkpoint` and `latest` are restored.
+		 * Otherwise all pages are restored. Clears the dirty pages.
+		 *
+		 * @param checkpoint Checkpoint returned by `take_checkpoint()`
+		 * @param latest Latest checkpoint, `nullptr` if unknown
+		 */
+		void restore_checkpoint(const Checkpoint& checkpoint, const Checkpoint* latest);
+
 	  private:
 
 		std::atomic<bool> write_lock = false;
 		u64 actual_size_bytes;
 		Fill_policy fill_policy;
-		std::vector<std::unique_ptr<std::array<u32, page_size_bytes / sizeof(u32)>>> storage;
+		std::vector<std::unique_ptr<Page>> storage;
+		size_t allocated_pages = 0;
 
-		void fill_page(std::array<u32, page_size_bytes / sizeof(u32)>& page);
+		u64 random_seed;                // Seed of `Fill_policy::Random`, mixed with the page index
+
+		std::vector<u64> dirty_bitmap;  // One bit per page
+		u64 epoch = 0;                  // Baseline of the dirty pages, a new value when they are cleared
+		u64 last_epoch = 0;             // Last epoch started, epochs are never reused
+
+		void fill_page(size_t page_index, Page& page);
 		void touch_page(size_t page_index);
+		void restore_page(size_t page_index, const Page* snapshot_page);
+
+		void mark_page_dirty(size_t page_index) noexcept
+		{
+			dirty_bitmap[page_index / 64] |= u64(1) << (page_index % 64);
+		}
 	};
 }
\ No newline at end of file
@@ -46,6 +46,8 @@ namespace device
 		std::expected<u32, Error> read(u64 address) override final;
 		std::expected<void, Error> read_page(u64 address, std::span<u32, 1024> data) override final;
 		std::expected<void, Error> write(u64 address, u32 data, core::Bitset<4> mask) override final;
+		std::expected<void, Error> read_block(u64 address, std::span<u8> data) override final;
+		std::expected<void, Error> write_block(u64 address, std::span<const u8> data) override final;
 		u64 size() const override final { return std::numeric_limits<u64>::max(); }
 	};
 }
\ No newline at end of file
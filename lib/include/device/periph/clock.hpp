@@ -32,6 +32,8 @@ namespace device::periph
 		std::optional<u32> counter_templow;
 		std::optional<u32> comp_templow;
 
+		u32 interrupt_mask = 1 << 7;  // mtimer interrupt
+
 	  public:
 
 		std::expected<u32, Error> read(u64 address) override;
@@ -43,5 +45,18 @@ namespace device::periph
 		 * @param mip `MIP` register of the CPU. Used to signal M-mode timer interrupt.
 		 */
 		void tick(core::csr::Mip& mip);
+
+		/**
+		 * @brief Clear the counter and the comparator, the interrupt line is kept
+		 *
+		 */
+		void reset() noexcept;
+
+		/**
+		 * @brief Set the interrupt line signaled when the counter exceeds the comparator
+		 *
+		 * @param line Bit index in `mip` and `mie`, `7` (M-mode timer interrupt) by default
+		 */
+		void set_interrupt_line(u32 line) noexcept { interrupt_mask = u32(1) << line; }
 	};
 }
\ No newline at end of file
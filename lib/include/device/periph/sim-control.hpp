@@ -0,0 +1,127 @@
+#pragma once
+
+#include "base.hpp"
+#include "common/bitset.hpp"
+
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+
+namespace device::periph
+{
+	/**
+	 * @brief Simulation control peripheral, lets the guest call into the host
+	 *
+	 * @details Registers (offsets in bytes):
+	 * - `0x00` `CMD`: Writing a command number executes the command with `ARG0`-`ARG2`
+	 * - `0x04` `ARG0`, `0x08` `ARG1`, `0x0c` `ARG2`: Command arguments
+	 * - `0x10` `RESULT`: Result of the last command, `0xffffffff` on failure (read-only)
+	 *
+	 * Commands:
+	 * - `Exit`: Stop simulation with exit code `ARG0`
+	 * - `Console_write`: Write `ARG1` bytes at guest address `ARG0` to the console. `RESULT` = bytes written
+	 * - `File_open`: Open the host file whose null-terminated path is at `ARG0`, with `File_mode` `ARG1`.
+	 *   `RESULT` = file handle
+	 * - `File_read`: Read at most `ARG2` bytes from file handle `ARG0` into guest address `ARG1`.
+	 *   `RESULT` = bytes read, `0` at end of file
+	 * - `File_write`: Write `ARG2` bytes at guest address `ARG1` to file handle `ARG0`. `RESULT` = bytes
+	 *   written
+	 * - `File_close`: Close file handle `ARG0`. `RESULT` = `0`
+	 *
+	 * @note Host file access is disabled unless a root directory is set with `set_host_file_root()`. Guest
+	 * paths are relative to the root and can't escape it, even through symbolic links.
+	 */
+	class Sim_control : public Periph_base
+	{
+	  public:
+
+		enum class Command : u32
+		{
+			Exit = 1,
+			Console_write = 2,
+			File_open = 3,
+			File_read = 4,
+			File_write = 5,
+			File_close = 6
+		};
+
+		enum class File_mode : u32
+		{
+			Read = 0,
+			Write = 1,   // Create or truncate
+			Append = 2,  // Create or append
+		};
+
+		static constexpr u32 failure = 0xffff'ffff;
+		static constexpr size_t max_open_files = 16;
+
+		/**
+		 * @brief Construct a new `Sim_control`
+		 *
+		 * @param guest_memory Memory seen by the guest, used to transfer command data. Must outlive this
+		 * object.
+		 */
+		Sim_control(core::Memory_interface& guest_memory) :
+			guest_memory(guest_memory)
+		{}
+
+		std::expected<u32, Error> read(u64 address) override;
+		std::expected<void, Error> write(u64 address, u32 data, core::Bitset<4> mask) override;
+
+		/**
+		 * @brief Get the exit code requested by the guest
+		 *
+		 * @return Exit code if the guest executed `Command::Exit`, `std::nullopt` otherwise
+		 */
+		std::optional<u32> get_exit_code() const noexcept { return exit_code; }
+
+		/**
+		 * @brief Set output stream of `Command::Console_write`
+		 *
+		 * @param output_stream Output stream reference
+		 */
+		void set_output_stream(std::ostream& output_stream) { this->output_stream = &output_stream; }
+
+		/**
+		 * @brief Enable host file access, relative to the given root directory
+		 *
+		 * @param root Root directory. Empty path disables host file access.
+		 */
+		void set_host_file_root(std::filesystem::path root) { host_file_root = std::move(root); }
+
+		/**
+		 * @brief Close all files, and clear registers and the exit code
+		 *
+		 */
+		void reset();
+
+	  private:
+
+		core::Memory_interface& guest_memory;
+		std::ostream* output_stream = &std::cerr;
+		std::filesystem::path host_file_root;
+
+		u32 command = 0;
+		std::array<u32, 3> args = {0, 0, 0};
+		u32 result = 0;
+		std::optional<u32> exit_code;
+
+		u32 next_handle = 0;
+		std::map<u32, std::fstream> files;
+
+		u32 execute(Command command);
+
+		u32 console_write(u32 address, u32 length);
+		u32 file_open(u32 path_address, File_mode mode);
+		u32 file_read(u32 handle, u32 address, u32 length);
+		u32 file_write(u32 handle, u32 address, u32 length);
+		u32 file_close(u32 handle);
+
+		// Resolve a guest path against the root, `std::nullopt` if disabled or escaping the root
+		std::optional<std::filesystem::path> resolve_path(const std::string& guest_path) const;
+	};
+}
@@ -3,6 +3,7 @@
 #include "base.hpp"
 #include "common/bitset.hpp"
 
+#include <functional>
 #include <iostream>
 
 namespace device::periph
@@ -13,8 +14,30 @@ namespace device::periph
 	 */
 	class Uart : public Periph_base
 	{
+	  public:
+
+		/**
+		 * @brief Register reads whose value comes from outside the emulator
+		 *
+		 */
+		enum class Input
+		{
+			Rx,     // Byte received from the input stream
+			Status  // Status register, with a random "data available" bit
+		};
+
+		/**
+		 * @brief Provides the value of an input read, see `set_input_source()`
+		 *
+		 */
+		using Input_source = std::function<u32(Input input)>;
+
+	  private:
+
 		u32 config_reg;
 		std::istream* input_stream = &std::cin;
+		std::ostream* output_stream = &std::cerr;
+		Input_source input_source;
 
 	  public:
 
@@ -27,5 +50,34 @@ namespace device::periph
 		 * @param input_stream Input stream reference
 		 */
 		void set_input_stream(std::istream& input_stream);
+
+		/**
+		 * @brief Set output stream for UART peripheral. Used when not outputting data to `std::cerr`
+		 *
+		 * @param output_stream Output stream reference
+		 */
+		void set_output_stream(std::ostream& output_stream);
+
+		/**
+		 * @brief Take the value of input reads from `source` instead of `read_input()`, e.g. to record or
+		 * replay them
+		 *
+		 * @param source Input source, empty to read the input stream again
+		 */
+		void set_input_source(Input_source source);
+
+		/**
+		 * @brief Get the input source set by `set_input_source()`, empty if none
+		 *
+		 */
+		const Input_source& get_input_source() const noexcept { return input_source; }
+
+		/**
+		 * @brief Read an input from the input stream, as done without an input source
+		 *
+		 * @param input Input to read
+		 * @return Register value
+		 */
+		u32 read_input(Input input);
 	};
 }
\ No newline at end of file
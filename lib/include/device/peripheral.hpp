@@ -1,4 +1,5 @@
 #pragma once
 
 #include "periph/clock.hpp"
+#include "periph/sim-control.hpp"
 #include "periph/uart.hpp"
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "core/memory.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace device
+{
+	/**
+	 * @brief Read-only memory device, backed either by a memory-mapped file or by an in-memory image
+	 * @note Bytes past the end of the image read as zero
+	 */
+	class Rom : public core::Memory_interface
+	{
+	  public:
+
+		/**
+		 * @brief Construct a new empty `Rom`
+		 *
+		 * @param size_bytes Size in bytes
+		 */
+		explicit Rom(u64 size_bytes) :
+			size_bytes(size_bytes)
+		{}
+
+		Rom(const Rom&) = delete;
+		Rom& operator=(const Rom&) = delete;
+
+		~Rom();
+
+		/**
+		 * @brief Copy an image into the ROM, starting at logic address `0`
+		 *
+		 * @param image Image data
+		 * @return `true` if loaded successfully, `false` if the image is larger than the ROM
+		 */
+		bool load(std::span<const u8> image);
+
+		/**
+		 * @brief Map a file into the ROM, starting at logic address `0`
+		 * @note The file is mapped private and read-only: nothing is copied at load time, and processes
+		 * mapping the same file share its pages through the page cache. The file must not be modified while
+		 * mapped.
+		 *
+		 * @param path Path to the file
+		 * @throws std::runtime_error If the file can't be mapped, is empty or is larger than the ROM
+		 */
+		void map_file(const std::filesystem::path& path);
+
+		std::expected<u32, Error> read(u64 address) override;
+		std::expected<void, Error> read_page(u64 address, std::span<u32, 1024> data) override;
+		std::expected<void, Error> write(u64 address, u32 data, core::Bitset<4> mask) override;
+		std::expected<void, Error> read_block(u64 address, std::span<u8> data) override;
+		std::expected<void, Error> write_block(u64 address, std::span<const u8> data) override;
+		size_t size() const override { return size_bytes; }
+
+		/**
+		 * @brief Reject writes, default state
+		 * @note This function is thread-safe.
+		 */
+		void lock() noexcept { write_lock = true; }
+
+		/**
+		 * @brief Accept writes, e.g. for loading additional images
+		 * @note The first write copies a mapped file into memory, the file itself is never modified
+		 */
+		void unlock() noexcept { write_lock = false; }
+
+		/**
+		 * @brief Check whether the content is a mapped file
+		 *
+		 */
+		bool is_mapped() const noexcept { return mapping != nullptr; }
+
+	  private:
+
+		std::atomic<bool> write_lock = true;
+		u64 size_bytes;
+
+		std::span<const u8> content;  // Either `mapping` or `owned`, may be shorter than the ROM
+		std::vector<u8> owned;
+
+		void* mapping = nullptr;
+		size_t mapping_size = 0;
+
+		void unmap() noexcept;
+
+		// Replace the content with an owned copy of the full ROM size
+		void make_writable();
+	};
+}
@@ -2,7 +2,6 @@
 
 #include "common/type.hpp"
 
-#include <any>
 #include <map>
 #include <optional>
 #include <string>
@@ -64,6 +63,37 @@ namespace gdb_stub::command
 		std::optional<u32> cycle_count;
 	};
 
+	/**
+	 * @brief `vCont?` packet, query supported `vCont` actions
+	 *
+	 */
+	struct Query_vcont
+	{};
+
+	/**
+	 * @brief `vCont;action[:thread-id]...` packet, resume with an action for each thread
+	 * @note Signals of `C` and `S` and thread IDs are ignored. The target has a single thread, to which the
+	 * first action applies.
+	 */
+	struct Vcont
+	{
+		struct Action
+		{
+			enum class Kind
+			{
+				Continue,    // `c` or `C sig`
+				Step,        // `s` or `S sig`
+				Range_step,  // `r start,end`, step while PC is in `[range_start, range_end)`
+				Stop         // `t`, stop the running target, only used in non-stop mode
+			} kind;
+
+			u32 range_start = 0;
+			u32 range_end = 0;
+		};
+
+		std::vector<Action> actions;  // Never empty
+	};
+
 	/**
 	 * @brief `k` packet, stop execution and kill the system
 	 *
@@ -82,7 +112,8 @@ namespace gdb_stub::command
 	};
 
 	/**
-	 * @brief `M` packet, write memory at @p address with @p data
+	 * @brief `M` or `X` packet, write memory at @p address with @p data
+	 * @note `M` sends @p data in hex, `X` in binary
 	 *
 	 */
 	struct Write_memory
@@ -126,6 +157,20 @@ namespace gdb_stub::command
 		std::optional<u32> address;
 	};
 
+	/**
+	 * @brief `bs` packet, step one instruction backwards
+	 *
+	 */
+	struct Reverse_step
+	{};
+
+	/**
+	 * @brief `bc` packet, continue execution backwards
+	 *
+	 */
+	struct Reverse_continue
+	{};
+
 	/**
 	 * @brief `qSupported` packet, query host features
 	 *
@@ -148,6 +193,36 @@ namespace gdb_stub::command
 		std::map<std::string, Host_feature_status> features;
 	};
 
+	/**
+	 * @brief `QStartNoAckMode` packet, stop acknowledging packets after the `OK` response
+	 *
+	 */
+	struct Start_no_ack_mode
+	{};
+
+	/**
+	 * @brief `QNonStop:1` or `QNonStop:0` packet, enter or leave non-stop mode
+	 *
+	 */
+	struct Set_non_stop
+	{
+		bool enable;
+	};
+
+	/**
+	 * @brief `vCtrlC` packet, interrupt the target as if Ctrl-C was pressed, replied with `OK`
+	 *
+	 */
+	struct Interrupt_request
+	{};
+
+	/**
+	 * @brief `vStopped` packet, acknowledge a `%Stop` notification in non-stop mode
+	 *
+	 */
+	struct Ack_stop_notification
+	{};
+
 	/**
 	 * @brief `qXfer:features:read:...` packet
 	 * @details Read target description XML file ( @p annex ) from @p offset for @p length bytes
@@ -178,7 +253,7 @@ namespace gdb_stub::command
 		bool is_hardware;
 		u32 address;
 		u32 length;
-		std::optional<std::vector<u8>> cond;
+		std::vector<std::vector<u8>> conds;  // Condition bytecodes, ORed together. Empty if unconditional.
 	};
 
 	/**
@@ -216,11 +291,47 @@ namespace gdb_stub::command
 		u32 length;
 	};
 
+	/**
+	 * @brief Any packet sent by GDB
+	 *
+	 */
+	using Command = std::variant<
+		Acknowledge_packet,
+		Interrupt_packet,
+		Enable_persistant,
+		Ask_halt_reason,
+		Continue,
+		Read_register,
+		Write_register,
+		Step_cycles,
+		Query_vcont,
+		Vcont,
+		Interrupt_request,
+		Ack_stop_notification,
+		Stop,
+		Read_memory,
+		Write_memory,
+		Read_single_register,
+		Write_single_register,
+		Restart,
+		Step_single_inst,
+		Reverse_step,
+		Reverse_continue,
+		Query_supported,
+		Start_no_ack_mode,
+		Set_non_stop,
+		Read_feature_xml,
+		Read_memory_map_xml,
+		Add_breakpoint,
+		Add_watchpoint,
+		Remove_breakpoint,
+		Remove_watchpoint>;
+
 	/**
 	 * @brief Parse command from string
 	 *
 	 * @param command Clean command string, escaped character removed
-	 * @return `std::any` containing one of the command structs if successful, empty
+	 * @return Parsed command if successful, `std::nullopt` otherwise
 	 */
-	std::any parse(std::string_view command);
-}
+	std::optional<Command> parse(std::string_view command);
+}
\ No newline at end of file
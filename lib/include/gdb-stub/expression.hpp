@@ -8,6 +8,7 @@
 #include <functional>
 #include <optional>
 #include <span>
+#include <vector>
 
 namespace gdb_stub::expression
 {
@@ -114,4 +115,90 @@ namespace gdb_stub::expression
 		const std::function<std::optional<u32>(u32)>& access_register_func,
 		std::span<const u8> bytecode_sequence
 	);
+
+	/**
+	 * @brief Bytecode sequence compiled for repeated execution on a CPU
+	 * @details Compilation decodes every instruction once, resolves jump targets and register numbers, and
+	 * checks the stack depth on every path. Execution then runs without bound checks, reading registers
+	 * directly from the CPU and memory a word at a time.
+	 */
+	class Compiled_expression
+	{
+	  public:
+
+		/**
+		 * @brief Maximum stack depth of a compiled expression
+		 *
+		 */
+		static constexpr size_t max_stack_depth = 64;
+
+		/**
+		 * @brief Compile a bytecode sequence
+		 *
+		 * @param bytecode_sequence Bytecode sequence
+		 * @return `Compiled_expression` if valid, `Execute_error` otherwise. Errors that only depend on the
+		 * bytecode (unsupported bytecode, out-of-bound operand or jump, stack underflow or overflow, invalid
+		 * register number) are reported here rather than during execution.
+		 */
+		static std::expected<Compiled_expression, Execute_error> compile(
+			std::span<const u8> bytecode_sequence
+		);
+
+		/**
+		 * @brief Execute the expression on the state of `cpu`
+		 *
+		 * @param cpu CPU providing the registers, and the memory through its interface
+		 * @return `Execute_result` if successful, `Execute_error` otherwise
+		 */
+		std::expected<Execute_result, Execute_error> execute(core::CPU_module& cpu) const;
+
+	  private:
+
+		enum class Opcode : u8
+		{
+			Add,
+			Sub,
+			Mul,
+			Div_signed,
+			Div_unsigned,
+			Rem_signed,
+			Rem_unsigned,
+			Lsh,
+			Rsh_signed,
+			Rsh_unsigned,
+			Log_not,
+			Bit_and,
+			Bit_or,
+			Bit_xor,
+			Bit_not,
+			Equal,
+			Less_signed,
+			Less_unsigned,
+			Ext,       // Operand: bit count
+			Zero_ext,  // Operand: bit count
+			Ref8,
+			Ref16,
+			Ref32,
+			Dup,
+			Swap,
+			Pop,
+			Pick,     // Operand: depth
+			Rot,
+			If_goto,  // Operand: instruction index
+			Goto,     // Operand: instruction index
+			Const,    // Operand: value
+			Reg_gpr,  // Operand: register index
+			Reg_pc,
+			Reg_csr,  // Operand: CSR address
+			End
+		};
+
+		struct Instruction
+		{
+			Opcode opcode;
+			u32 operand = 0;
+		};
+
+		std::vector<Instruction> instructions;
+	};
 }
\ No newline at end of file
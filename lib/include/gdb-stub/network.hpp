@@ -5,15 +5,25 @@
 #include "packet.hpp"
 #include "response.hpp"
 
+#include <array>
 #include <asio.hpp>
 #include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
 
 namespace gdb_stub
 {
 	/**
 	 * @brief Network handler for GDB remote protocol
 	 * @details This wrapper wraps: ASIO networking, packet encoding/decoding and command parsing. It
-	 * automatically responds `+/-` to host, but doesn't handle the actual response logic.
+	 * automatically responds `+/-` to host until no-ack mode is enabled, but doesn't handle the actual
+	 * response logic.
+	 * @note All socket operations are asynchronous, and run on the I/O thread of the `io_context`, see
+	 * `Debug_server`. The methods can be called from another thread, which blocks on a condition variable
+	 * until the operation completes, so waiting uses no CPU. Once a connection is closed, the handler
+	 * accepts the next one.
 	 */
 	class Network_handler
 	{
@@ -28,6 +38,12 @@ namespace gdb_stub
 			Decode_fail        // Unknown command
 		};
 
+		enum class Wait_result
+		{
+			Packet,   // Data from GDB is available, call `receive()`
+			Notified  // `notify()` was called
+		};
+
 		Network_handler(const Network_handler&) = delete;
 		Network_handler(Network_handler&&) = delete;
 		Network_handler& operator=(const Network_handler&) = delete;
@@ -36,9 +52,17 @@ namespace gdb_stub
 		/**
 		 * @brief Create a new network handler that listens on the given port
 		 *
+		 * @param io_context I/O context run by another thread, must outlive the handler
 		 * @param port TCP port
+		 * @throws std::system_error If the port can't be listened on
+		 */
+		Network_handler(asio::io_context& io_context, u16 port);
+
+		/**
+		 * @brief Close the connection and stop listening
+		 * @note Waits for the pending operations on the I/O thread to complete
 		 */
-		Network_handler(u16 port);
+		~Network_handler();
 
 		/**
 		 * @brief Sends a response to GDB and returns the status
@@ -47,43 +71,140 @@ namespace gdb_stub
 		 */
 		std::expected<void, Error> send(const Response& response);
 
+		/**
+		 * @brief Sends an asynchronous notification to GDB, such as `%Stop` in non-stop mode
+		 * @note Notifications are not acknowledged
+		 *
+		 * @param name Notification name, without the trailing `:`
+		 * @param response Notification content
+		 */
+		std::expected<void, Error> send_notification(std::string_view name, const Response& response);
+
 		/**
 		 * @brief Receives a command from GDB
 		 *
 		 * @return `Command` if successful, `Error` otherwise
 		 * @note Handle `Error` carefully, call `close()` if necessary
 		 */
-		std::expected<std::any, Error> receive();
+		std::expected<command::Command, Error> receive();
 
 		/**
-		 * @brief Forcefully close the connection to GDB
+		 * @brief Wait until data from GDB is available, or `notify()` is called
+		 * @note Uses no CPU while waiting. A `notify()` before the call isn't lost, it wakes the next wait.
 		 *
+		 * @return `Wait_result` if successful, `Error` otherwise
+		 */
+		std::expected<Wait_result, Error> wait();
+
+		/**
+		 * @brief Wake up the thread in `wait()`
+		 * @note This function is thread-safe.
+		 */
+		void notify();
+
+		/**
+		 * @brief Check whether GDB is connected, without waiting
+		 * @note This function is thread-safe.
+		 */
+		bool is_connected();
+
+		/**
+		 * @brief Forcefully close the connection to GDB, and accept the next one
+		 * @note Also leaves no-ack mode and drops the received data, the next connection starts afresh with
+		 * acknowledgements
 		 */
 		void close();
 
+		/**
+		 * @brief Stop sending and waiting for `+/-` acknowledgements
+		 * @note Call after the `OK` response to `QStartNoAckMode` is sent and acknowledged
+		 */
+		void enable_no_ack_mode() noexcept { no_ack_mode = true; }
+
 	  private:
 
 		static constexpr size_t max_retry_count = 5;
 		static constexpr size_t timeout_ms = 5000;
 
-		std::unique_ptr<asio::io_context> io_context;
-		std::unique_ptr<asio::ip::tcp::acceptor> acceptor;
-		std::unique_ptr<asio::ip::tcp::socket> socket;
+		asio::io_context& io_context;
+		asio::ip::tcp::acceptor acceptor;
+		asio::ip::tcp::socket socket;
 
+		// Only used by the calling thread
+		Packet_encoder encoder;
+		std::string response_body;  // Reused between responses to avoid allocations
+		bool no_ack_mode = false;
+
+		// Guarded by `mutex`, `condition` is notified when any of them changes
+		std::mutex mutex;
+		std::condition_variable condition;
 		Packet_decoder decoder;
+		bool connected = false;        // Accepted, until `close()`
+		bool notified = false;         // Set by `notify()`
+		bool reading = false;          // An asynchronous read is pending
+		bool writing = false;          // An asynchronous write is pending
+		asio::error_code read_error;   // Error of the last read, reported by `wait_until()`
+		asio::error_code write_error;  // Error of the last write, reported by `write()`
+		size_t pending_handlers = 0;   // Handlers queued on the I/O thread, which refer to `this`
+
+		std::array<char, 65536> read_buffer;  // Large enough for a full `X` packet in a few reads
+
+		/**
+		 * @brief Wait until GDB is connected
+		 *
+		 */
+		void wait_for_connection();
+
+		/**
+		 * @brief Start accepting the next connection, on the I/O thread
+		 *
+		 */
+		void start_accept();
+
+		/**
+		 * @brief Start an asynchronous read into the decoder, on the I/O thread with `mutex` locked
+		 * @note The read restarts itself after each completion, until an error occurs
+		 */
+		void start_read();
+
+		/**
+		 * @brief Run `function` on the I/O thread, with `mutex` locked
+		 *
+		 */
+		void post(std::function<void()> function);
+
+		/**
+		 * @brief Write `data` to the socket on the I/O thread, and wait until written
+		 *
+		 * @throws std::runtime_error If the write fails
+		 */
+		void write(std::string_view data);
 
 		/**
-		 * @brief Setup the socket if it is not already open
+		 * @brief Wait until `done()` returns `true`
 		 *
+		 * @param lock Lock of `mutex`
+		 * @param done Condition to wait for, checked whenever the state changes
+		 * @param timeout Maximum waiting time, `std::nullopt` to wait indefinitely
+		 * @return `true` if `done()` returned `true`, `false` on timeout
+		 * @throws std::runtime_error If a read fails
 		 */
-		void setup_socket();
+		bool wait_until(
+			std::unique_lock<std::mutex>& lock,
+			const std::function<bool()>& done,
+			std::optional<std::chrono::milliseconds> timeout
+		);
 
 		/**
-		 * @brief Get a packet from the decoder, waiting if necessary
+		 * @brief Get a command from the decoder, waiting if necessary
+		 * @note The packet is parsed with `mutex` locked, as the I/O thread may overwrite it afterwards
 		 *
-		 * @retval std::string the packet string
+		 * @param timeout Maximum waiting time, `std::nullopt` to wait indefinitely
+		 * @retval std::optional<command::Command> Parsed command, `std::nullopt` if unknown
 		 * @retval Error On failure
 		 */
-		std::expected<std::string, Network_handler::Error> get_packet_from_decoder();
+		std::expected<std::optional<command::Command>, Network_handler::Error> get_command_from_decoder(
+			std::optional<std::chrono::milliseconds> timeout
+		);
 	};
 }
\ No newline at end of file
@@ -2,14 +2,12 @@
 
 #include "common/type.hpp"
 
-#include <atomic>
+#include <array>
 #include <expected>
-#include <mutex>
 #include <optional>
-#include <queue>
-#include <sstream>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace gdb_stub
 {
@@ -31,16 +29,46 @@ namespace gdb_stub
 		 * @return Decoded string, or `std::nullopt` if the input was invalid
 		 */
 		std::optional<std::string> remove_escape(std::string_view body);
+
+		/**
+		 * @brief Lowercase hex digits of every byte value
+		 *
+		 */
+		inline constexpr auto hex_table = []
+		{
+			constexpr std::string_view digits = "0123456789abcdef";
+
+			std::array<std::array<char, 2>, 256> table;
+			for (size_t i = 0; i < table.size(); i++) table[i] = {digits[i >> 4], digits[i & 0xf]};
+			return table;
+		}();
+
+		/**
+		 * @brief Append a byte as two lowercase hex digits
+		 *
+		 * @param out Output string
+		 * @param byte Byte to append
+		 */
+		inline void append_hex(std::string& out, u8 byte)
+		{
+			out.append(hex_table[byte].data(), 2);
+		}
 	}
 
 	/**
 	 * @brief Decoder for decoding packets from GDB. Supports streaming input.
-	 *
+	 * @note Packets are unescaped in place in an internal buffer that is reused once all packets are popped,
+	 * so decoding doesn't allocate after the buffer has grown to the largest packet. The decoder is not
+	 * synchronized, it must be used by a single thread.
 	 */
 	class Packet_decoder
 	{
 	  public:
 
+		/**
+		 * @brief Maximum packet body size, advertised to GDB as `PacketSize` (in hex) in `stub-feature.inc`
+		 *
+		 */
 		static constexpr size_t max_buffer_size = 1048576;
 
 		enum class Error
@@ -63,24 +91,41 @@ namespace gdb_stub
 		/**
 		 * @brief Pop a new packet from decoder
 		 *
-		 * @return `std::string` if successful, `Error` otherwise
+		 * @return Packet body if successful, `Error` otherwise. The body is valid until the next `push()`.
 		 */
-		std::expected<std::string, Error> pop_packet();
+		std::expected<std::string_view, Error> pop_packet();
 
 		/**
 		 * @brief Queries if a new packet is available
 		 *
 		 * @return `true` if a new packet is available, `false` otherwise
 		 */
-		bool new_packet_available();
+		bool new_packet_available() const;
+
+		/**
+		 * @brief Drop the pending packets and any partially received one
+		 * @note Call when the input stream restarts, such as on a new connection. Keeps the buffer allocated.
+		 */
+		void reset() noexcept;
 
 	  private:
 
-		std::string in_buffer;
-		std::queue<std::expected<std::string, Error>> out_queue;
+		/**
+		 * @brief Decoded packet, as a range of `buffer` or an error
+		 *
+		 */
+		struct Entry
+		{
+			size_t offset = 0;
+			size_t length = 0;
+			std::optional<Error> error;
+		};
 
-		std::mutex out_queue_mutex;
-		std::atomic<bool> out_queue_available = false;
+		std::string buffer;          // Decoded packets, followed by the raw body being received
+		size_t body_offset = 0;      // Start of the body being received in `buffer`
+		std::vector<Entry> entries;  // Packets not popped yet, from `next_entry`
+		size_t next_entry = 0;       // Index of the next packet to pop
+		u8 checksum = 0;             // Running checksum of the body being received
 
 		enum class State
 		{
@@ -92,7 +137,10 @@ namespace gdb_stub
 
 		std::array<char, 2> checksum_buffer;
 
-		std::expected<std::string, Error> decode_in_buffer();
+		void push_error(Error error);
+		void push_single(char c);
+		void restart_body();
+		void finish_body();
 	};
 
 	/**
@@ -101,17 +149,26 @@ namespace gdb_stub
 	 */
 	class Packet_encoder
 	{
-		std::stringstream stream;
-		char last_char = '\0';
-		u8 repeat = 0;
-
-		void push_repeat();
-		void push(char c);
+		std::string packet;  // Output buffer, reused between packets
+		u8 checksum = 0;
 
-		std::string internal_encode(std::string_view str);
+		void put(char c);
+		void put_escaped(char c);
+		void put_repeat(char c, size_t count);
 
 	  public:
 
+		/**
+		 * @brief Encode a string into a GDB packet, in the output buffer of the encoder
+		 * @note Doesn't allocate once the output buffer has grown to the largest packet
+		 *
+		 * @param str Input string
+		 * @param leader First character, `$` for packets and `%` for notifications
+		 * @return Run-length encoded packet string (including `$`, `#` and checksum), valid until the next
+		 * call
+		 */
+		std::string_view encode_buffered(std::string_view str, char leader = '$');
+
 		/**
 		 * @brief Encode a string into a GDB packet
 		 *
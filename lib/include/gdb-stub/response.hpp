@@ -3,9 +3,9 @@
 #include "common/type.hpp"
 
 #include <flat_map>
-#include <format>
 #include <map>
 #include <optional>
+#include <span>
 #include <string>
 #include <variant>
 #include <vector>
@@ -21,11 +21,24 @@ namespace gdb_stub
 	  public:
 
 		/**
-		 * @brief Stub function to convert response to string
+		 * @brief Append the response to a string
+		 * @note Used by `Network_handler` with a reused string, so responses don't allocate by themselves
+		 *
+		 * @param out Output string. The response is not escaped or runlength-encoded yet.
+		 */
+		virtual void append_to(std::string& out) const = 0;
+
+		/**
+		 * @brief Convert response to string
 		 *
 		 * @return Converted string, not escaped or runlength-encoded yet
 		 */
-		virtual std::string to_string() const = 0;
+		std::string to_string() const
+		{
+			std::string result;
+			append_to(result);
+			return result;
+		}
 
 		virtual ~Response() = default;
 	};
@@ -40,7 +53,18 @@ namespace gdb_stub
 		{
 		  public:
 
-			std::string to_string() const override { return "OK"; }
+			void append_to(std::string& out) const override { out += "OK"; }
+		};
+
+		/**
+		 * @brief Response for `vCont?` command, lists supported `vCont` actions
+		 *
+		 */
+		class Vcont_actions : public Response
+		{
+		  public:
+
+			void append_to(std::string& out) const override { out += "vCont;c;C;s;S;r;t"; }
 		};
 
 		/**
@@ -57,7 +81,7 @@ namespace gdb_stub
 				value(value)
 			{}
 
-			std::string to_string() const override;
+			void append_to(std::string& out) const override;
 		};
 
 		/**
@@ -66,20 +90,21 @@ namespace gdb_stub
 		 */
 		class Register_content : public Response
 		{
-			std::vector<std::optional<u32>> reg_values;
+			std::span<const std::optional<u32>> reg_values;
 
 		  public:
 
 			/**
-			 * @brief Construct a new `Register_content` from map of register values
+			 * @brief Construct a new `Register_content` from register values
 			 *
-			 * @param reg_values Map of register number to register value
+			 * @param reg_values Register values, indexed by register number. Not copied, must outlive the
+			 * response.
 			 */
-			Register_content(std::vector<std::optional<u32>> reg_values) :
-				reg_values(std::move(reg_values))
+			Register_content(std::span<const std::optional<u32>> reg_values) :
+				reg_values(reg_values)
 			{}
 
-			std::string to_string() const override;
+			void append_to(std::string& out) const override;
 		};
 
 		/**
@@ -88,20 +113,20 @@ namespace gdb_stub
 		 */
 		class Raw_byte_stream : public Response
 		{
-			std::vector<u8> data;
+			std::span<const u8> data;
 
 		  public:
 
 			/**
 			 * @brief Construct a new `Raw_byte_stream` from raw data bytes
 			 *
-			 * @param data Raw data span
+			 * @param data Raw data span. Not copied, must outlive the response.
 			 */
 			Raw_byte_stream(std::span<const u8> data) :
-				data(data.begin(), data.end())
+				data(data)
 			{}
 
-			std::string to_string() const override;
+			void append_to(std::string& out) const override;
 		};
 
 		/**
@@ -112,7 +137,7 @@ namespace gdb_stub
 		{
 		  public:
 
-			std::string to_string() const override { return ""; }
+			void append_to(std::string& out [[maybe_unused]]) const override {}
 		};
 
 		/**
@@ -129,7 +154,7 @@ namespace gdb_stub
 				code(code)
 			{}
 
-			std::string to_string() const override { return std::format("E{:02x}", code); }
+			void append_to(std::string& out) const override;
 		};
 
 		/**
@@ -146,7 +171,7 @@ namespace gdb_stub
 				message(std::move(message))
 			{}
 
-			std::string to_string() const override { return std::format("E.{}", message); }
+			void append_to(std::string& out) const override;
 		};
 
 		/**
@@ -176,6 +201,13 @@ namespace gdb_stub
 				bool is_hardware;  // `true` if is hardware breakpoint
 			};
 
+			/**
+			 * @brief Reverse execution reached the beginning of the recorded history
+			 *
+			 */
+			struct History_begin
+			{};
+
 			/**
 			 * @brief Construct a new `Stop_reason` with only signals and register contents
 			 *
@@ -197,16 +229,24 @@ namespace gdb_stub
 			 */
 			Stop_reason(Breakpoint_hit breakpoint_hit);
 
-			std::string to_string() const override;
+			/**
+			 * @brief Construct a new `Stop_reason` for the beginning of the history
+			 *
+			 * @param history_begin Tag
+			 */
+			Stop_reason(History_begin history_begin);
+
+			void append_to(std::string& out) const override;
 
 		  private:
 
 			u8 signal;
-			std::variant<std::monostate, Watchpoint_hit, Breakpoint_hit> hit;
+			std::variant<std::monostate, Watchpoint_hit, Breakpoint_hit, History_begin> hit;
 
-			static std::string parse_hit_string(std::monostate hit);
-			static std::string parse_hit_string(Watchpoint_hit hit);
-			static std::string parse_hit_string(Breakpoint_hit hit);
+			static void append_hit(std::string& out, std::monostate hit);
+			static void append_hit(std::string& out, Watchpoint_hit hit);
+			static void append_hit(std::string& out, Breakpoint_hit hit);
+			static void append_hit(std::string& out, History_begin hit);
 		};
 
 		/**
@@ -231,7 +271,7 @@ namespace gdb_stub
 				data(std::move(data))
 			{}
 
-			std::string to_string() const override;
+			void append_to(std::string& out) const override;
 		};
 
 		/**
@@ -242,7 +282,7 @@ namespace gdb_stub
 		{
 		  public:
 
-			std::string to_string() const override;
+			void append_to(std::string& out) const override;
 		};
 	}
 
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "network.hpp"
+
+#include <memory>
+#include <thread>
+
+namespace gdb_stub
+{
+	/**
+	 * @brief Serves the connections of any number of `Network_handler` from a single I/O thread
+	 * @note Each handler listens on its own port, so GDB can attach to any of several emulators running
+	 * in parallel. The server must outlive its handlers.
+	 */
+	class Debug_server
+	{
+	  public:
+
+		/**
+		 * @brief Start the I/O thread
+		 *
+		 */
+		Debug_server();
+
+		/**
+		 * @brief Stop the I/O thread
+		 *
+		 */
+		~Debug_server();
+
+		Debug_server(const Debug_server&) = delete;
+		Debug_server(Debug_server&&) = delete;
+		Debug_server& operator=(const Debug_server&) = delete;
+		Debug_server& operator=(Debug_server&&) = delete;
+
+		/**
+		 * @brief Create a network handler served by this server
+		 *
+		 * @param port TCP port to listen on
+		 * @throws std::system_error If the port can't be listened on
+		 */
+		std::unique_ptr<Network_handler> listen(u16 port);
+
+	  private:
+
+		asio::io_context io_context;
+		asio::executor_work_guard<asio::io_context::executor_type> work_guard;
+		std::jthread io_thread;  // Declared last, started last
+	};
+}
@@ -4,7 +4,9 @@
 #include "core/cpu.hpp"
 #include "gdb-stub/addr-range.hpp"
 #include "gdb-stub/command.hpp"
+#include "gdb-stub/expression.hpp"
 
+#include <expected>
 #include <optional>
 #include <vector>
 
@@ -24,16 +26,53 @@ namespace gdb_stub
 	};
 
 	/**
-	 * @brief Struct representing a hardware breakpoint
+	 * @brief Bitmap of the 4 KiB pages covered by watchpoints
+	 * @note Memory accesses outside the watched pages can skip the watchpoint lookup with a single bit test
+	 */
+	class Watch_page_filter
+	{
+	  public:
+
+		static constexpr u32 page_shift = 12;
+
+		/**
+		 * @brief Mark the pages covered by `range` as watched
+		 *
+		 */
+		void add(Address_range range);
+
+		/**
+		 * @brief Unmark all pages
+		 *
+		 */
+		void clear() noexcept;
+
+		/**
+		 * @brief Check if the page containing `address` is watched
+		 *
+		 */
+		bool contains(u32 address) const noexcept
+		{
+			const auto page = address >> page_shift;
+			return (bitmap[page / 64] >> (page % 64)) & 1;
+		}
+
+	  private:
+
+		std::vector<u64> bitmap = std::vector<u64>((u64(1) << (32 - page_shift)) / 64, 0);
+	};
+
+	/**
+	 * @brief Struct representing a breakpoint, either hardware or software
 	 *
 	 */
-	struct Hw_breakpoint
+	struct Breakpoint
 	{
 		u32 address;
-		std::optional<std::vector<u8>> cond;
+		std::vector<expression::Compiled_expression> conds;  // ORed together, empty if unconditional
 
 		/**
-		 * @brief Checks if the breakpoint is triggered by the CPU. If `cond` is set, it will be evaluated.
+		 * @brief Checks if the breakpoint is triggered by the CPU. Conditions are evaluated until one holds.
 		 *
 		 * @param cpu The CPU instance
 		 * @return `true` if triggered, `false` otherwise
@@ -41,11 +80,11 @@ namespace gdb_stub
 		bool is_triggered_by(core::CPU_module& cpu) const;
 
 		/**
-		 * @brief Create a `Hw_breakpoint` from a `Add_breakpoint` command
+		 * @brief Create a `Breakpoint` from a `Add_breakpoint` command, compiling its conditions
 		 *
 		 * @param cmd `Add_breakpoint` command
-		 * @return New `Hw_breakpoint`
+		 * @return New `Breakpoint`, `Execute_error` if a condition is invalid
 		 */
-		static Hw_breakpoint from(const command::Add_breakpoint& cmd);
+		static std::expected<Breakpoint, expression::Execute_error> from(const command::Add_breakpoint& cmd);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "device/address-decoder.hpp"
+#include "device/interconnect.hpp"
+
+#include <string>
+
+namespace machine
+{
+	/**
+	 * @brief Interconnect backed by a table of non-overlapping regions, sorted by base address
+	 * @note Lookup goes through a `device::Address_decoder`, its cost doesn't depend on the number of regions
+	 */
+	class Bus : public device::Interconnect
+	{
+	  public:
+
+		/**
+		 * @brief A device mapped on the bus
+		 *
+		 */
+		struct Region
+		{
+			std::string name;
+			u64 base;
+			u64 size;
+			std::shared_ptr<core::Memory_interface> device;
+		};
+
+		/**
+		 * @brief Map a device on the bus
+		 *
+		 * @param name Name of the region, unique on the bus
+		 * @param base Base address
+		 * @param device Device to map, occupies `[base, base + device->size())`
+		 *
+		 * @throws std::invalid_argument If the device is null or empty, its name is taken, or it overlaps an
+		 * existing region
+		 */
+		void attach(std::string name, u64 base, std::shared_ptr<core::Memory_interface> device);
+
+		/**
+		 * @brief Get all regions
+		 *
+		 * @return Regions, sorted by base address
+		 */
+		std::span<const Region> get_regions() const noexcept { return regions; }
+
+	  protected:
+
+		std::expected<Memory_query_result, Error> get_memory(u64 address) const noexcept override final;
+
+	  private:
+
+		std::vector<Region> regions;
+		device::Address_decoder decoder;
+	};
+}
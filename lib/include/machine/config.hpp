@@ -0,0 +1,132 @@
+#pragma once
+
+#include "common/type.hpp"
+#include "device/block-memory.hpp"
+
+#include <filesystem>
+#include <istream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace machine
+{
+	/**
+	 * @brief Describes a device mapped on the bus
+	 *
+	 */
+	struct Region_config
+	{
+		enum class Type
+		{
+			Rom,         // Boot ROM, receives the flash image
+			Ram,         // Block memory
+			Uart,        // UART peripheral
+			Clock,       // Clock peripheral
+			Sim_control  // Sim control peripheral
+		};
+
+		Type type;
+
+		/**
+		 * @brief Name of the region, for diagnostics
+		 *
+		 */
+		std::string name;
+
+		u64 base;
+
+		/**
+		 * @brief Size in bytes. Required for ROM and RAM, ignored for peripherals.
+		 * @note `Machine` replaces it with the actual size of the device, see `Machine::get_config()`
+		 */
+		u64 size = 0;
+
+		/**
+		 * @brief Fill policy of a RAM region
+		 * @note Uses `Config::ram_fill_policy` if not set
+		 */
+		std::optional<device::Fill_policy> fill_policy;
+
+		/**
+		 * @brief Interrupt line of a clock region, as the bit index in `mip` and `mie`
+		 * @note Standard lines are taken in the priority order of the privileged spec, other lines after them
+		 */
+		u32 irq = 7;
+	};
+
+	/**
+	 * @brief Describes the platform built by `Machine`
+	 * @note Default values describe the standard platform, see the readme for details
+	 */
+	struct Config
+	{
+		/**
+		 * @brief PC after reset
+		 *
+		 */
+		u32 reset_pc = 0x0010'0000;
+
+		/**
+		 * @brief Devices mapped on the bus
+		 * @note Exactly one ROM, at least one RAM, and at most one of each peripheral. Peripherals not listed
+		 * exist but are not reachable by the guest.
+		 */
+		std::vector<Region_config> regions = get_standard_regions();
+
+		/**
+		 * @brief Fill policy of RAM regions without their own fill policy
+		 * @note To emulate DDR, use `device::Fill_policy::Random`
+		 */
+		device::Fill_policy ram_fill_policy = device::Fill_policy::Random;
+
+		/**
+		 * @brief Root directory of host files accessible through the sim control device
+		 * @note Empty path disables host file access
+		 */
+		std::filesystem::path host_file_root;
+
+		/**
+		 * @brief Get the regions of the standard platform
+		 *
+		 */
+		static std::vector<Region_config> get_standard_regions();
+
+		/**
+		 * @brief Parse a layout description
+		 * @note Format: one statement per line, empty lines and lines starting with `#` are ignored.
+		 * ```
+		 * reset-pc <address>
+		 * <type> <name> base=<address> [size=<bytes>] [fill=<policy>] [irq=<line>]
+		 * ```
+		 * - `<type>`: `rom`, `ram`, `uart`, `clock` or `sim-control`
+		 * - Numbers can be decimal or `0x` prefixed hexadecimal. Sizes accept a `K`, `M` or `G` suffix
+		 *   (powers of 1024).
+		 * - `size` is required for `rom` and `ram`. `fill` is only valid for `ram`, `irq` only for `clock`.
+		 * - The described regions replace the standard regions. Other fields keep their default values.
+		 *
+		 * @param input Layout description
+		 * @return Parsed configuration
+		 * @throws std::invalid_argument If the description is malformed, with the line number in the message
+		 */
+		static Config parse_layout(std::istream& input);
+
+		/**
+		 * @brief Parse a layout description file, see `parse_layout()`
+		 *
+		 * @param path Path to the layout file
+		 * @return Parsed configuration
+		 * @throws std::runtime_error If the file can't be read
+		 * @throws std::invalid_argument If the description is malformed
+		 */
+		static Config load_layout_file(const std::filesystem::path& path);
+	};
+
+	/**
+	 * @brief Parse name of a fill policy: `none`, `zero`, `one`, `random` or `cdcdcdcd`
+	 *
+	 * @throws std::invalid_argument If the name is invalid
+	 */
+	device::Fill_policy parse_fill_policy(std::string_view name);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "machine.hpp"
+
+#include <deque>
+#include <functional>
+
+namespace machine
+{
+	/**
+	 * @brief Execution history of a `Machine`, for reverse execution
+	 * @note
+	 * - A checkpoint is taken every `interval` instructions, see `Machine::take_checkpoint()`. Going back
+	 *   restores the nearest checkpoint before the target, and replays the instructions up to it.
+	 * - Replay relies on the execution being deterministic. Writes of the state by anything else than
+	 *   `Machine::step()` (debugger, `Machine::reset()`) invalidate the history, call `clear()` after them.
+	 * - UART input reads are recorded by position, and served again to the replay and to the execution
+	 *   going forward over the recorded part. The history takes over the UART input source, see
+	 *   `device::periph::Uart::set_input_source()`.
+	 * - UART output and console writes of the sim control device are not undone, and repeated by the
+	 *   replay. Host file access can't be replayed, so the history refuses machines that enable it.
+	 */
+	class History
+	{
+	  public:
+
+		/**
+		 * @brief Construct a new `History` of `machine`
+		 *
+		 * @param machine Machine to record, must outlive the history
+		 * @param interval Number of instructions between checkpoints, at least `1`
+		 * @param capacity Maximum number of checkpoints, the oldest ones are dropped
+		 * @throws std::invalid_argument If an argument is invalid, or `machine` enables host file access
+		 */
+		History(Machine& machine, u64 interval, size_t capacity);
+
+		/**
+		 * @brief Destroy the `History`, giving the UART input source back
+		 *
+		 */
+		~History();
+
+		History(const History&) = delete;
+		History& operator=(const History&) = delete;
+
+		/**
+		 * @brief Take a checkpoint if due. Call before every `Machine::step()` to be recorded.
+		 *
+		 */
+		void record()
+		{
+			if (machine.get_inst_executed() >= next_checkpoint) [[unlikely]]
+				take_checkpoint();
+		}
+
+		/**
+		 * @brief Drop all checkpoints. The history starts again at the next `record()`.
+		 *
+		 */
+		void clear();
+
+		/**
+		 * @brief Go back by one instruction
+		 *
+		 * @return `false` if already at the beginning of the history, the machine is unchanged
+		 */
+		bool step_back();
+
+		/**
+		 * @brief Go back to the latest breakpoint hit before the current position
+		 * @note Breakpoints are the ones of `Machine::add_breakpoint()`. Hits where `is_triggered` returns
+		 * `false` are ignored.
+		 *
+		 * @param is_triggered Called when the machine stops on a breakpoint during the replay
+		 * @return `false` if no breakpoint was hit, the machine is then at the beginning of the history
+		 */
+		bool continue_back(const std::function<bool(Machine&)>& is_triggered);
+
+	  private:
+
+		/**
+		 * @brief Run of identical UART input reads, at `position + k * stride` for `k` below `count`
+		 * @note Merges the status polls of busy waits.
+		 */
+		struct Input_read
+		{
+			u64 position;  // `inst_executed` of the first read
+			u64 stride;    // `1` for a single read
+			u64 count;
+			device::periph::Uart::Input input;
+			u32 value;
+
+			u64 get_last_position() const noexcept { return position + stride * (count - 1); }
+		};
+
+		Machine& machine;
+		u64 interval;
+		size_t capacity;
+
+		std::deque<Machine::Checkpoint> checkpoints;  // By position (`inst_executed`)
+		const Machine::Checkpoint* latest = nullptr;  // Latest checkpoint taken or restored
+		u64 next_checkpoint = 0;
+
+		std::deque<Input_read> inputs;  // By position
+		u64 live_position = 0;          // Reads before it are served from `inputs`
+		device::periph::Uart::Input_source previous_input_source;
+
+		void take_checkpoint();
+		u32 read_input(device::periph::Uart::Input input);
+
+		/**
+		 * @brief Restore the latest checkpoint at or before `position`
+		 *
+		 * @return `false` if there is no such checkpoint, the machine is unchanged
+		 */
+		bool restore_before(u64 position);
+
+		/**
+		 * @brief Execute until `position`, stepping over breakpoints
+		 *
+		 */
+		void replay(u64 position);
+	};
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "machine.hpp"
+
+#include <filesystem>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace machine
+{
+	/**
+	 * @brief Log of the nondeterministic inputs of a run, to reproduce the run exactly
+	 * @note
+	 * - Covers the seeds of `device::Fill_policy::Random` and the UART input reads (RX bytes and status
+	 *   polls). Host files read through the sim control device are not logged, and must be the same when
+	 *   replaying.
+	 * - The machine of the replay must have the same layout and flash image as the recorded one.
+	 */
+	class Input_log
+	{
+	  public:
+
+		enum class Kind : u8
+		{
+			Fill_seed,   // Seed of a RAM region, in the order of RAM regions
+			Uart_rx,     // Byte read from the UART RX register
+			Uart_status  // Value of the UART status register
+		};
+
+		/**
+		 * @brief Input read, or repeated identical status polls
+		 *
+		 */
+		struct Entry
+		{
+			Kind kind;
+			u64 inst_executed;  // Instruction count when read, see `Machine::get_inst_executed()`
+			u64 value;
+			u64 count = 1;  // Number of consecutive identical reads, only for `Kind::Uart_status`
+
+			bool operator==(const Entry&) const = default;
+		};
+
+		/**
+		 * @brief Start recording the inputs of `machine` into this log
+		 * @note Logs the current seeds of the RAM regions, call before accessing the memory. `machine` must
+		 * outlive the recording, which lasts until the UART input source is replaced.
+		 *
+		 */
+		void record(Machine& machine);
+
+		/**
+		 * @brief Start replaying this log as the inputs of `machine`
+		 * @note Sets the seeds of the RAM regions, call before accessing the memory. `machine` must outlive
+		 * the replay, which lasts until the UART input source is replaced.
+		 *
+		 * @throws std::runtime_error If the log doesn't match the RAM regions of `machine`
+		 */
+		void replay(Machine& machine);
+
+		const std::vector<Entry>& get_entries() const noexcept { return entries; }
+
+		/**
+		 * @brief Write the log in its binary format
+		 *
+		 */
+		void save(std::ostream& output) const;
+
+		/**
+		 * @brief Read a log written by `save()`
+		 *
+		 * @throws std::runtime_error If the input is not a valid log
+		 */
+		static Input_log load(std::istream& input);
+
+		/**
+		 * @brief Write the log into a file, see `save()`
+		 *
+		 * @throws std::runtime_error If the file can't be written
+		 */
+		void save_file(const std::filesystem::path& path) const;
+
+		/**
+		 * @brief Read a log from a file, see `load()`
+		 *
+		 * @throws std::runtime_error If the file can't be read or is not a valid log
+		 */
+		static Input_log load_file(const std::filesystem::path& path);
+
+	  private:
+
+		std::vector<Entry> entries;
+
+		// Replay position
+		size_t next_entry = 0;
+		u64 repeated = 0;  // Reads already replayed from `entries[next_entry]`
+
+		u32 record_uart_input(Machine& machine, device::periph::Uart::Input input);
+		u32 replay_uart_input(const Machine& machine, device::periph::Uart::Input input);
+	};
+}
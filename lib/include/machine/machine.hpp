@@ -0,0 +1,424 @@
+#pragma once
+
+#include "bus.hpp"
+#include "config.hpp"
+#include "core/cpu.hpp"
+#include "device/block-memory.hpp"
+#include "device/peripheral.hpp"
+#include "device/rom.hpp"
+
+#include <concepts>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <span>
+
+namespace machine
+{
+	/**
+	 * @brief A complete emulated platform (CPU, ROM, RAM and peripherals) with a programmatic interface
+	 * @note Not thread-safe. Independent `Machine` instances can run in parallel.
+	 */
+	class Machine
+	{
+	  public:
+
+		using Result = core::CPU_module::Result;
+		using Error = core::Memory_interface::Error;
+
+		/**
+		 * @brief Hook called after every executed instruction
+		 *
+		 */
+		using Instruction_hook = std::function<void(Machine& machine, const Result& result)>;
+
+		/**
+		 * @brief Handle of a registered hook, used to remove it
+		 *
+		 */
+		struct Hook_handle
+		{
+			u64 id;
+		};
+
+		/**
+		 * @brief Architectural state of the CPU, the clock and the RAM, see `take_snapshot()`
+		 *
+		 */
+		struct Snapshot
+		{
+			u32 pc;
+			bool waiting_for_interrupt;
+			core::Register_file_module registers;
+			core::CSR_module csr;
+			device::periph::Clock clock;
+			std::vector<device::Block_memory::Snapshot> rams;  // In the order of RAM regions
+			u64 inst_executed;
+		};
+
+		/**
+		 * @brief Architectural state like `Snapshot`, with the RAM pages shared between checkpoints, see
+		 * `take_checkpoint()`
+		 *
+		 */
+		struct Checkpoint
+		{
+			u32 pc;
+			bool waiting_for_interrupt;
+			core::Register_file_module registers;
+			core::CSR_module csr;
+			device::periph::Clock clock;
+			std::vector<device::Block_memory::Checkpoint> rams;  // In the order of RAM regions
+			u64 inst_executed;
+		};
+
+		/**
+		 * @brief Construct a new `Machine`
+		 *
+		 * @param config Platform configuration
+		 * @throws std::invalid_argument If the layout is invalid, e.g. regions overlap or no ROM region
+		 */
+		explicit Machine(const Config& config = {});
+
+		Machine(const Machine&) = delete;
+		Machine(Machine&&) = default;
+		Machine& operator=(const Machine&) = delete;
+		Machine& operator=(Machine&&) = default;
+
+		~Machine();
+
+		/* Images */
+
+		/**
+		 * @brief Load a raw binary image into the boot ROM, starting at its base address
+		 *
+		 * @param image Raw binary image
+		 * @throws std::runtime_error If the image is larger than the ROM
+		 */
+		void load_flash(std::span<const u8> image);
+
+		/**
+		 * @brief Load a raw binary flash file into the boot ROM
+		 * @note The file is memory-mapped instead of copied, see `device::Rom::map_file()`
+		 *
+		 * @param path Path to the raw binary file
+		 * @throws std::runtime_error If failed to read the file, or the file is empty or too large
+		 */
+		void load_flash_file(const std::filesystem::path& path);
+
+		/**
+		 * @brief Load a raw binary image at an arbitrary address
+		 * @note Also writes read-only memories such as the boot ROM
+		 *
+		 * @param address Start address
+		 * @param image Raw binary image
+		 * @throws std::runtime_error If any part of the image is not writable
+		 */
+		void load_image(u64 address, std::span<const u8> image);
+
+		/**
+		 * @brief Reset the CPU and the peripherals, and clear all RAM regions. ROM content is kept.
+		 *
+		 */
+		void reset();
+
+		/**
+		 * @brief Capture the current state, to be restored with `restore_snapshot()`
+		 * @note ROM content, UART state and sim control state are not captured. Clears the dirty pages of
+		 * the RAM, see `device::Block_memory::take_snapshot()`.
+		 *
+		 * @return Snapshot of the current state
+		 */
+		Snapshot take_snapshot();
+
+		/**
+		 * @brief Restore a snapshot taken from this machine, and reset the sim control device
+		 * @note Invalidates the instruction cache of the CPU. Restoring the latest snapshot only copies the
+		 * RAM pages written since it was taken or last restored.
+		 *
+		 * @param snapshot Snapshot returned by `take_snapshot()`
+		 */
+		void restore_snapshot(const Snapshot& snapshot);
+
+		/**
+		 * @brief Capture the current state, to be restored with `restore_checkpoint()`
+		 * @note Captures the same state as `take_snapshot()`, but only copies the RAM pages written since
+		 * `previous`, see `device::Block_memory::take_checkpoint()`.
+		 *
+		 * @param previous Latest checkpoint, `nullptr` if none
+		 * @return Checkpoint of the current state
+		 */
+		Checkpoint take_checkpoint(const Checkpoint* previous);
+
+		/**
+		 * @brief Restore a checkpoint taken from this machine
+		 * @note Invalidates the instruction cache of the CPU. The sim control device is kept, so that a
+		 * replay from the checkpoint doesn't reopen host files.
+		 *
+		 * @param checkpoint Checkpoint returned by `take_checkpoint()`
+		 * @param latest Latest checkpoint taken or restored, `nullptr` if unknown
+		 */
+		void restore_checkpoint(const Checkpoint& checkpoint, const Checkpoint* latest);
+
+		/* Execution */
+
+		/**
+		 * @brief Execute one instruction (including trap handling) and tick the peripherals
+		 * @note Stops in front of a breakpoint without executing anything, see `add_breakpoint()`
+		 *
+		 * @return Result of the instruction
+		 */
+		Result step()
+		{
+			const auto result = cpu->execute();
+			if (is_breakpoint_hit(result)) [[unlikely]]
+				return result;
+
+			complete_step(result);
+			return result;
+		}
+
+		/**
+		 * @brief Execute one instruction like `step()`, running the original instruction if the PC is on a
+		 * breakpoint
+		 * @note Unlike removing and adding the breakpoint again, keeps the cached page of the breakpoint.
+		 *
+		 * @return Result of the instruction
+		 */
+		Result step_over_breakpoint()
+		{
+			cpu->inst_fetch.bypass_breakpoints = true;
+			const auto result = cpu->execute();
+			cpu->inst_fetch.bypass_breakpoints = false;
+
+			complete_step(result);
+			return result;
+		}
+
+		/**
+		 * @brief Execute `count` instructions
+		 *
+		 * @param count Number of instructions
+		 */
+		void run(u64 count)
+		{
+			for (u64 i = 0; i < count; i++) step();
+		}
+
+		/**
+		 * @brief Execute until `predicate` returns `true` for the result of an instruction
+		 *
+		 * @param predicate Called with the `Result` of every executed instruction
+		 * @param max_count Maximum number of instructions to execute
+		 * @return Result of the instruction that satisfied `predicate`, or `std::nullopt` if `max_count`
+		 * instructions were executed without satisfying it
+		 */
+		template <typename Predicate>
+			requires std::predicate<Predicate&, const Result&>
+		std::optional<Result> run_until(
+			Predicate&& predicate,
+			u64 max_count = std::numeric_limits<u64>::max()
+		)
+		{
+			for (u64 i = 0; i < max_count; i++)
+			{
+				const auto result = step();
+				if (std::invoke(predicate, result)) return result;
+			}
+
+			return std::nullopt;
+		}
+
+		/* Breakpoints */
+
+		/**
+		 * @brief Add a breakpoint
+		 * @note The instruction is replaced by `ebreak` in the instruction cache only, so it costs nothing
+		 * until hit and reads of the memory still return the original instruction. When hit, `step()`
+		 * returns a `core::Trap::Breakpoint` result with the PC left on the breakpoint. Breakpoints are kept
+		 * across `reset()`.
+		 *
+		 * @param address Word-aligned address of the instruction
+		 */
+		void add_breakpoint(u32 address) { cpu->inst_fetch.add_breakpoint(address); }
+
+		/**
+		 * @brief Remove a breakpoint
+		 *
+		 * @param address Address of the breakpoint
+		 * @return `true` if removed, `false` if no such breakpoint
+		 */
+		bool remove_breakpoint(u32 address) { return cpu->inst_fetch.remove_breakpoint(address); }
+
+		/**
+		 * @brief Check whether `result` is a stop on a breakpoint added by `add_breakpoint()`, as opposed to
+		 * an `ebreak` of the guest itself
+		 *
+		 */
+		bool is_breakpoint_hit(const Result& result) const noexcept
+		{
+			return result.trap == core::Trap::Breakpoint && cpu->inst_fetch.breakpoints.contains(result.pc);
+		}
+
+		/**
+		 * @brief Number of instructions executed since construction or the last `reset()`
+		 *
+		 */
+		u64 get_inst_executed() const noexcept { return inst_executed; }
+
+		/* Registers */
+
+		u32 get_pc() const noexcept { return cpu->pc; }
+		void set_pc(u32 pc) noexcept { cpu->pc = pc; }
+
+		/**
+		 * @brief Read a general purpose register
+		 *
+		 * @param index Register index, `0` to `31`
+		 */
+		u32 get_register(u32 index) const noexcept { return cpu->registers.get_register(index); }
+
+		/**
+		 * @brief Write a general purpose register. Writes to `x0` are ignored.
+		 *
+		 * @param index Register index, `0` to `31`
+		 * @param value Value to write
+		 */
+		void set_register(u32 index, u32 value) noexcept { cpu->registers.set_register(index, value); }
+
+		/**
+		 * @brief Read all general purpose registers
+		 *
+		 * @param registers Output, `registers[i]` receives `x<i>`
+		 */
+		void get_registers(std::span<u32, 32> registers) const noexcept;
+
+		/**
+		 * @brief Write all general purpose registers. `registers[0]` is ignored.
+		 *
+		 * @param registers Input, `registers[i]` is written to `x<i>`
+		 */
+		void set_registers(std::span<const u32, 32> registers) noexcept;
+
+		/* Memory */
+
+		/**
+		 * @brief Read a block of memory as seen by the CPU
+		 *
+		 * @param address Start address, any alignment
+		 * @param data Output buffer, its size determines the number of bytes read
+		 * @return `Error` if any part of the block can't be read
+		 */
+		std::expected<void, Error> read_memory(u64 address, std::span<u8> data);
+
+		/**
+		 * @brief Write a block of memory as seen by the CPU
+		 * @note Invalidates the instruction cache of the CPU
+		 *
+		 * @param address Start address, any alignment
+		 * @param data Data to write
+		 * @return `Error` if any part of the block can't be written. Preceding bytes are written.
+		 */
+		std::expected<void, Error> write_memory(u64 address, std::span<const u8> data);
+
+		/* Devices */
+
+		/**
+		 * @brief Map a device model on the bus
+		 *
+		 * @param name Name of the device, unique among the regions and devices
+		 * @param base Base address
+		 * @param device Device model
+		 * @throws std::invalid_argument If the device overlaps an existing one, or its name is taken
+		 */
+		void attach_device(std::string name, u64 base, std::shared_ptr<core::Memory_interface> device);
+
+		/**
+		 * @brief Generate the GDB memory map XML of the regions on the bus
+		 * @note RAM regions are reported as `ram`, everything else as `rom`
+		 *
+		 * @return Memory map XML, as expected by `qXfer:memory-map:read`
+		 */
+		std::string generate_memory_map_xml() const;
+
+		/* Hooks */
+
+		/**
+		 * @brief Register a hook called after every executed instruction
+		 * @note Execution takes a slower path while any hook is registered. Hooks must not add or remove
+		 * hooks.
+		 *
+		 * @param hook Hook function
+		 * @return Handle to remove the hook
+		 */
+		Hook_handle add_instruction_hook(Instruction_hook hook);
+
+		/**
+		 * @brief Remove a registered hook
+		 *
+		 * @param handle Handle returned by `add_instruction_hook()`
+		 * @return `true` if removed, `false` if no such hook
+		 */
+		bool remove_hook(Hook_handle handle);
+
+		/* Coverage */
+
+		/**
+		 * @brief Collect edge coverage of the guest into `map`, see `core::CPU_module::coverage_map`
+		 *
+		 * @param map Coverage counters, size must be a power of 2. Empty span disables coverage. Must outlive
+		 * this object or be replaced.
+		 */
+		void set_coverage_map(std::span<u8> map);
+
+		/* Components */
+
+		/**
+		 * @brief Get the configuration, with the actual sizes of all regions
+		 *
+		 */
+		const Config& get_config() const noexcept { return config; }
+		core::CPU_module& get_cpu() noexcept { return *cpu; }
+		const core::CPU_module& get_cpu() const noexcept { return *cpu; }
+		Bus& get_bus() noexcept { return *bus; }
+		device::Rom& get_rom() noexcept { return *rom; }
+		device::Block_memory& get_ram(size_t index = 0) noexcept { return *rams[index]; }  // In region order
+		size_t get_ram_count() const noexcept { return rams.size(); }
+		device::periph::Uart& get_uart() noexcept { return *uart; }
+		device::periph::Clock& get_clock() noexcept { return *clock; }
+		device::periph::Sim_control& get_sim_control() noexcept { return *sim_control; }
+
+	  private:
+
+		Config config;
+
+		std::shared_ptr<Bus> bus;
+		std::shared_ptr<device::Rom> rom;
+		std::vector<std::shared_ptr<device::Block_memory>> rams;
+		std::shared_ptr<device::periph::Uart> uart;
+		std::shared_ptr<device::periph::Clock> clock;
+		std::shared_ptr<device::periph::Sim_control> sim_control;
+		std::unique_ptr<core::CPU_module> cpu;
+
+		u64 inst_executed = 0;
+		std::span<u8> coverage_map;
+
+		u64 next_hook_id = 0;
+		std::vector<std::pair<u64, Instruction_hook>> instruction_hooks;
+
+		void call_instruction_hooks(const Result& result);
+
+		// Handle the trap of an executed instruction and tick the peripherals
+		void complete_step(const Result& result)
+		{
+			cpu->handle_trap(result);
+			cpu->csr.tick();
+			clock->tick(cpu->csr.mip);
+			inst_executed++;
+
+			if (!instruction_hooks.empty()) [[unlikely]]
+				call_instruction_hooks(result);
+		}
+	};
+}
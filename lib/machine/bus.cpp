@@ -0,0 +1,62 @@
+#include "machine/bus.hpp"
+
+#include <algorithm>
+#include <format>
+
+namespace machine
+{
+	void Bus::attach(std::string name, u64 base, std::shared_ptr<core::Memory_interface> device)
+	{
+		if (device == nullptr) throw std::invalid_argument(std::format("Device \"{}\" is null", name));
+
+		const auto size = device->size();
+		if (size == 0) throw std::invalid_argument(std::format("Device \"{}\" is empty", name));
+		if (base + size < base)
+			throw std::invalid_argument(std::format("Device \"{}\" exceeds the address space", name));
+
+		// Regions are told apart by name, e.g. for the RAM type in the memory map
+		if (std::ranges::find(regions, name, &Region::name) != regions.end())
+			throw std::invalid_argument(std::format("Device \"{}\" is already mapped", name));
+
+		const auto position = std::ranges::upper_bound(regions, base, {}, &Region::base);
+		const auto overlap_error = [&name](const Region& other)
+		{
+			return std::invalid_argument(std::format("Device \"{}\" overlaps with \"{}\"", name, other.name));
+		};
+
+		if (position != regions.end() && base + size > position->base) throw overlap_error(*position);
+
+		if (position != regions.begin())
+		{
+			const auto& prev = *std::prev(position);
+			if (prev.base + prev.size > base) throw overlap_error(prev);
+		}
+
+		regions.insert(
+			position,
+			Region{.name = std::move(name), .base = base, .size = size, .device = std::move(device)}
+		);
+
+		std::vector<device::Address_decoder::Range> ranges(regions.size());
+		std::ranges::transform(
+			regions,
+			ranges.begin(),
+			[](const Region& region) { return device::Address_decoder::Range{region.base, region.size}; }
+		);
+		decoder.build(ranges);
+	}
+
+	std::expected<Bus::Memory_query_result, Bus::Error> Bus::get_memory(u64 address) const noexcept
+	{
+		const auto index = decoder.find(address);
+		if (!index.has_value()) [[unlikely]]
+			return std::unexpected(Error::Out_of_range);
+
+		const auto& region = regions[*index];
+
+		return Memory_query_result{
+			.entry = *region.device,
+			.offset = static_cast<size_t>(address - region.base)
+		};
+	}
+}
@@ -0,0 +1,192 @@
+#include "machine/config.hpp"
+
+#include <format>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <sstream>
+
+namespace machine
+{
+	namespace
+	{
+		const std::map<std::string_view, Region_config::Type> region_type_map = {
+			{"rom",         Region_config::Type::Rom        },
+			{"ram",         Region_config::Type::Ram        },
+			{"uart",        Region_config::Type::Uart       },
+			{"clock",       Region_config::Type::Clock      },
+			{"sim-control", Region_config::Type::Sim_control},
+		};
+
+		// Parse a number, with an optional `K`, `M` or `G` suffix if `allow_suffix`
+		std::optional<u64> parse_number(std::string_view text, bool allow_suffix)
+		{
+			u64 multiplier = 1;
+
+			if (allow_suffix && !text.empty())
+			{
+				switch (text.back())
+				{
+				case 'K':
+					multiplier = 1024;
+					break;
+				case 'M':
+					multiplier = 1024 * 1024;
+					break;
+				case 'G':
+					multiplier = 1024 * 1024 * 1024;
+					break;
+				default:
+					break;
+				}
+
+				if (multiplier != 1) text.remove_suffix(1);
+			}
+
+			if (text.empty()) return std::nullopt;
+
+			try
+			{
+				const std::string str(text);
+				size_t parsed_length;
+				const auto value = std::stoull(str, &parsed_length, 0);
+				if (parsed_length != str.size()) return std::nullopt;
+
+				if (value > std::numeric_limits<u64>::max() / multiplier) return std::nullopt;
+				return value * multiplier;
+			}
+			catch (const std::logic_error&)
+			{
+				return std::nullopt;
+			}
+		}
+
+		Region_config parse_region(Region_config::Type type, std::istringstream& tokens)
+		{
+			Region_config region{.type = type};
+			if (!(tokens >> region.name)) throw std::invalid_argument("Missing region name");
+
+			const bool is_memory = type == Region_config::Type::Rom || type == Region_config::Type::Ram;
+
+			std::optional<u64> base;
+			std::optional<u64> size;
+
+			for (std::string token; tokens >> token;)
+			{
+				const auto separator = token.find('=');
+				if (separator == std::string::npos)
+					throw std::invalid_argument(std::format("Expected <key>=<value>, got \"{}\"", token));
+
+				const auto key = std::string_view(token).substr(0, separator);
+				const auto value = std::string_view(token).substr(separator + 1);
+
+				const auto parse_value = [key, value](bool allow_suffix)
+				{
+					const auto number = parse_number(value, allow_suffix);
+					if (!number.has_value())
+						throw std::invalid_argument(std::format("Invalid value of {}: {}", key, value));
+					return *number;
+				};
+
+				if (key == "base")
+					base = parse_value(false);
+				else if (key == "size" && is_memory)
+					size = parse_value(true);
+				else if (key == "fill" && type == Region_config::Type::Ram)
+					region.fill_policy = parse_fill_policy(value);
+				else if (key == "irq" && type == Region_config::Type::Clock)
+					region.irq = static_cast<u32>(parse_value(false));
+				else
+					throw std::invalid_argument(std::format("Unexpected key: {}", key));
+			}
+
+			if (!base.has_value()) throw std::invalid_argument("Missing base");
+			region.base = *base;
+
+			if (is_memory)
+			{
+				if (!size.has_value()) throw std::invalid_argument("Missing size");
+				region.size = *size;
+			}
+
+			return region;
+		}
+	}
+
+	device::Fill_policy parse_fill_policy(std::string_view name)
+	{
+		static const std::map<std::string_view, device::Fill_policy> fill_policy_map = {
+			{"none",     device::Fill_policy::None    },
+			{"zero",     device::Fill_policy::Zero    },
+			{"one",      device::Fill_policy::One     },
+			{"random",   device::Fill_policy::Random  },
+			{"cdcdcdcd", device::Fill_policy::Cdcdcdcd},
+		};
+
+		const auto find = fill_policy_map.find(name);
+		if (find == fill_policy_map.end())
+			throw std::invalid_argument(std::format("Invalid fill policy: {}", name));
+
+		return find->second;
+	}
+
+	std::vector<Region_config> Config::get_standard_regions()
+	{
+		return {
+			{.type = Region_config::Type::Rom, .name = "rom", .base = 0x0010'0000, .size = 128 * 1024},
+			{.type = Region_config::Type::Ram, .name = "ram", .base = 0x8000'0000, .size = 2ull << 30},
+			{.type = Region_config::Type::Uart, .name = "uart", .base = 0x0001'0000},
+			{.type = Region_config::Type::Clock, .name = "clock", .base = 0x0001'1000},
+			{.type = Region_config::Type::Sim_control, .name = "sim-control", .base = 0x0001'2000},
+		};
+	}
+
+	Config Config::parse_layout(std::istream& input)
+	{
+		Config config;
+		config.regions.clear();
+
+		std::string line;
+		for (size_t line_number = 1; std::getline(input, line); line_number++)
+		{
+			std::istringstream tokens(line);
+
+			std::string keyword;
+			if (!(tokens >> keyword) || keyword.starts_with('#')) continue;
+
+			try
+			{
+				if (keyword == "reset-pc")
+				{
+					std::string value;
+					const auto reset_pc = tokens >> value ? parse_number(value, false) : std::nullopt;
+					if (!reset_pc.has_value() || *reset_pc > std::numeric_limits<u32>::max())
+						throw std::invalid_argument("Invalid reset PC");
+
+					config.reset_pc = static_cast<u32>(*reset_pc);
+					continue;
+				}
+
+				const auto find = region_type_map.find(keyword);
+				if (find == region_type_map.end())
+					throw std::invalid_argument(std::format("Unknown region type: {}", keyword));
+
+				config.regions.push_back(parse_region(find->second, tokens));
+			}
+			catch (const std::invalid_argument& e)
+			{
+				throw std::invalid_argument(std::format("Layout line {}: {}", line_number, e.what()));
+			}
+		}
+
+		return config;
+	}
+
+	Config Config::load_layout_file(const std::filesystem::path& path)
+	{
+		std::ifstream file(path);
+		if (!file) throw std::runtime_error(std::format("Failed to open layout file {}", path.string()));
+
+		return parse_layout(file);
+	}
+}
@@ -0,0 +1,165 @@
+#include "machine/history.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+
+namespace machine
+{
+	History::History(Machine& machine, u64 interval, size_t capacity) :
+		machine(machine),
+		interval(interval),
+		capacity(capacity)
+	{
+		if (interval == 0) throw std::invalid_argument("Checkpoint interval must be at least 1");
+		if (capacity == 0) throw std::invalid_argument("Checkpoint capacity must be at least 1");
+		if (!machine.get_config().host_file_root.empty())
+			throw std::invalid_argument("Host file access of the sim control device can't be replayed");
+
+		auto& uart = machine.get_uart();
+		previous_input_source = uart.get_input_source();
+		uart.set_input_source([this](device::periph::Uart::Input input) { return read_input(input); });
+	}
+
+	History::~History()
+	{
+		machine.get_uart().set_input_source(std::move(previous_input_source));
+	}
+
+	void History::clear()
+	{
+		checkpoints.clear();
+		latest = nullptr;
+		next_checkpoint = 0;
+
+		inputs.clear();
+		live_position = 0;
+	}
+
+	void History::take_checkpoint()
+	{
+		// References to the other elements of a deque stay valid when pushing or popping at the ends
+		checkpoints.push_back(machine.take_checkpoint(latest));
+		latest = &checkpoints.back();
+
+		if (checkpoints.size() > capacity)
+		{
+			checkpoints.pop_front();
+
+			// Reads before the oldest checkpoint are never replayed again
+			const auto start = checkpoints.front().inst_executed;
+			while (!inputs.empty() && inputs.front().get_last_position() < start) inputs.pop_front();
+		}
+
+		next_checkpoint = checkpoints.back().inst_executed + interval;
+	}
+
+	u32 History::read_input(device::periph::Uart::Input input)
+	{
+		const auto position = machine.get_inst_executed();
+
+		// Executed before, serve the recorded read
+		if (position < live_position)
+		{
+			const auto after = std::ranges::upper_bound(inputs, position, {}, &Input_read::position);
+			if (after != inputs.begin())
+			{
+				const auto& read = *std::prev(after);
+				const auto offset = position - read.position;
+				if (read.input == input && offset % read.stride == 0 && offset / read.stride < read.count)
+					return read.value;
+			}
+		}
+
+		// Not recorded, e.g. read by the debugger: read live
+		const auto value = previous_input_source ? previous_input_source(input)
+												 : machine.get_uart().read_input(input);
+		if (position < live_position) return value;
+
+		live_position = position + 1;
+
+		if (!inputs.empty())
+		{
+			auto& last = inputs.back();
+			if (last.input == input && last.value == value && position > last.position)
+			{
+				if (last.count == 1) last.stride = position - last.position;
+
+				if (position == last.position + last.stride * last.count)
+				{
+					last.count++;
+					return value;
+				}
+			}
+		}
+
+		inputs.push_back({.position = position, .stride = 1, .count = 1, .input = input, .value = value});
+		return value;
+	}
+
+	bool History::restore_before(u64 position)
+	{
+		const auto after
+			= std::ranges::upper_bound(checkpoints, position, {}, &Machine::Checkpoint::inst_executed);
+		if (after == checkpoints.begin()) return false;
+
+		// Later checkpoints are kept, as the replay reaches them again
+		const auto& checkpoint = *std::prev(after);
+		machine.restore_checkpoint(checkpoint, latest);
+		latest = &checkpoint;
+
+		return true;
+	}
+
+	void History::replay(u64 position)
+	{
+		while (machine.get_inst_executed() < position)
+		{
+			const auto result = machine.step();
+			if (machine.is_breakpoint_hit(result)) [[unlikely]]
+				machine.step_over_breakpoint();
+		}
+	}
+
+	bool History::step_back()
+	{
+		const auto position = machine.get_inst_executed();
+		if (position == 0 || !restore_before(position - 1)) return false;
+
+		replay(position - 1);
+		return true;
+	}
+
+	bool History::continue_back(const std::function<bool(Machine&)>& is_triggered)
+	{
+		// Scan the intervals between checkpoints backwards, for the last hit before `end`
+		for (auto end = machine.get_inst_executed(); end != 0 && restore_before(end - 1);)
+		{
+			const auto start = machine.get_inst_executed();
+			std::optional<u64> last_hit;
+
+			while (machine.get_inst_executed() < end)
+			{
+				const auto result = machine.step();
+				if (!machine.is_breakpoint_hit(result)) [[likely]]
+					continue;
+
+				if (is_triggered(machine)) last_hit = machine.get_inst_executed();
+				machine.step_over_breakpoint();
+			}
+
+			if (last_hit.has_value())
+			{
+				restore_before(*last_hit);
+				replay(*last_hit);
+				return true;
+			}
+
+			end = start;
+		}
+
+		// No hit, stay at the beginning
+		if (!checkpoints.empty()) restore_before(checkpoints.front().inst_executed);
+		return false;
+	}
+}
@@ -0,0 +1,202 @@
+#include "machine/input-log.hpp"
+
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace machine
+{
+	namespace
+	{
+		// Format: magic, then for each entry: kind byte, instruction count delta, value, and the count of
+		// status entries, all numbers as LEB128 varints. Deltas are zigzag encoded, as `Machine::reset()`
+		// restarts the instruction count.
+		constexpr std::string_view magic = "RVIL\x01";
+
+		void write_varint(std::ostream& output, u64 value)
+		{
+			for (; value >= 0x80; value >>= 7) output.put(static_cast<char>((value & 0x7f) | 0x80));
+			output.put(static_cast<char>(value));
+		}
+
+		u64 read_varint(std::istream& input)
+		{
+			u64 value = 0;
+
+			for (u32 shift = 0; shift < 64; shift += 7)
+			{
+				const auto byte = input.get();
+				if (byte == std::istream::traits_type::eof()) throw std::runtime_error("Input log truncated");
+
+				value |= u64(byte & 0x7f) << shift;
+				if ((byte & 0x80) == 0) return value;
+			}
+
+			throw std::runtime_error("Input log has an invalid number");
+		}
+
+		u64 zigzag_encode(u64 delta)
+		{
+			return (delta << 1) ^ (static_cast<i64>(delta) < 0 ? ~u64(0) : 0);
+		}
+
+		u64 zigzag_decode(u64 value)
+		{
+			return (value >> 1) ^ (~(value & 1) + 1);
+		}
+
+		Input_log::Kind to_kind(device::periph::Uart::Input input)
+		{
+			return input == device::periph::Uart::Input::Rx ? Input_log::Kind::Uart_rx
+															  : Input_log::Kind::Uart_status;
+		}
+	}
+
+	void Input_log::record(Machine& machine)
+	{
+		for (size_t i = 0; i < machine.get_ram_count(); i++)
+		{
+			entries.push_back(
+				Entry{
+					.kind = Kind::Fill_seed,
+					.inst_executed = machine.get_inst_executed(),
+					.value = machine.get_ram(i).get_random_seed()
+				}
+			);
+		}
+
+		machine.get_uart().set_input_source(
+			[this, &machine](device::periph::Uart::Input input) { return record_uart_input(machine, input); }
+		);
+	}
+
+	u32 Input_log::record_uart_input(Machine& machine, device::periph::Uart::Input input)
+	{
+		const auto value = machine.get_uart().read_input(input);
+		const auto kind = to_kind(input);
+
+		// Status polls of a busy wait are merged
+		if (kind == Kind::Uart_status
+			&& !entries.empty()
+			&& entries.back().kind == Kind::Uart_status
+			&& entries.back().value == value)
+		{
+			entries.back().count++;
+			return value;
+		}
+
+		entries.push_back(Entry{.kind = kind, .inst_executed = machine.get_inst_executed(), .value = value});
+		return value;
+	}
+
+	void Input_log::replay(Machine& machine)
+	{
+		next_entry = 0;
+		repeated = 0;
+
+		for (size_t i = 0; i < machine.get_ram_count(); i++, next_entry++)
+		{
+			if (next_entry >= entries.size() || entries[next_entry].kind != Kind::Fill_seed)
+				throw std::runtime_error("Input log doesn't match the RAM regions of the platform");
+
+			machine.get_ram(i).set_random_seed(entries[next_entry].value);
+		}
+
+		if (next_entry < entries.size() && entries[next_entry].kind == Kind::Fill_seed)
+			throw std::runtime_error("Input log doesn't match the RAM regions of the platform");
+
+		machine.get_uart().set_input_source(
+			[this, &machine](device::periph::Uart::Input input) { return replay_uart_input(machine, input); }
+		);
+	}
+
+	u32 Input_log::replay_uart_input(const Machine& machine, device::periph::Uart::Input input)
+	{
+		const auto position = machine.get_inst_executed();
+
+		if (next_entry >= entries.size())
+			throw std::runtime_error(std::format("Input log exhausted at instruction {}", position));
+
+		const auto& entry = entries[next_entry];
+		if (entry.kind != to_kind(input) || (repeated == 0 && entry.inst_executed != position))
+			throw std::runtime_error(
+				std::format(
+					"Replay diverged at instruction {}, input log entry #{} was read at instruction {}",
+					position,
+					next_entry,
+					entry.inst_executed
+				)
+			);
+
+		if (++repeated == entry.count)
+		{
+			next_entry++;
+			repeated = 0;
+		}
+
+		return static_cast<u32>(entry.value);
+	}
+
+	void Input_log::save(std::ostream& output) const
+	{
+		output.write(magic.data(), magic.size());
+
+		u64 previous = 0;
+		for (const auto& entry : entries)
+		{
+			output.put(static_cast<char>(entry.kind));
+			write_varint(output, zigzag_encode(entry.inst_executed - previous));
+			write_varint(output, entry.value);
+			if (entry.kind == Kind::Uart_status) write_varint(output, entry.count);
+
+			previous = entry.inst_executed;
+		}
+	}
+
+	Input_log Input_log::load(std::istream& input)
+	{
+		std::string header(magic.size(), '\0');
+		if (!input.read(header.data(), header.size()) || header != magic)
+			throw std::runtime_error("Not an input log");
+
+		Input_log log;
+		u64 previous = 0;
+
+		for (int kind; (kind = input.get()) != std::istream::traits_type::eof();)
+		{
+			if (kind > static_cast<int>(Kind::Uart_status))
+				throw std::runtime_error(std::format("Input log has an invalid entry kind: {}", kind));
+
+			Entry entry{.kind = static_cast<Kind>(kind), .inst_executed = 0, .value = 0};
+			entry.inst_executed = previous + zigzag_decode(read_varint(input));
+			entry.value = read_varint(input);
+			if (entry.kind == Kind::Uart_status) entry.count = read_varint(input);
+
+			if (entry.count == 0) throw std::runtime_error("Input log has an empty entry");
+
+			previous = entry.inst_executed;
+			log.entries.push_back(entry);
+		}
+
+		return log;
+	}
+
+	void Input_log::save_file(const std::filesystem::path& path) const
+	{
+		std::ofstream file(path, std::ios::binary);
+		if (!file) throw std::runtime_error(std::format("Failed to open input log {}", path.string()));
+
+		save(file);
+		if (!file.flush())
+			throw std::runtime_error(std::format("Failed to write input log {}", path.string()));
+	}
+
+	Input_log Input_log::load_file(const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file) throw std::runtime_error(std::format("Failed to open input log {}", path.string()));
+
+		return load(file);
+	}
+}
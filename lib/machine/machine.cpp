@@ -0,0 +1,267 @@
+#include "machine/machine.hpp"
+
+#include <format>
+#include <set>
+
+namespace machine
+{
+	Machine::Machine(const Config& config) :
+		config(config)
+	{
+		bus = std::make_shared<Bus>();
+
+		uart = std::make_shared<device::periph::Uart>();
+		clock = std::make_shared<device::periph::Clock>();
+		sim_control = std::make_shared<device::periph::Sim_control>(*bus);
+		sim_control->set_host_file_root(config.host_file_root);
+
+		std::set<Region_config::Type> attached_peripherals;
+
+		for (auto& region : this->config.regions)
+		{
+			std::shared_ptr<core::Memory_interface> device;
+
+			switch (region.type)
+			{
+			case Region_config::Type::Rom:
+				if (rom != nullptr) throw std::invalid_argument("Only one ROM region is supported");
+				rom = std::make_shared<device::Rom>(region.size);
+				device = rom;
+				break;
+
+			case Region_config::Type::Ram:
+				device = rams.emplace_back(
+					std::make_shared<device::Block_memory>(
+						region.size,
+						region.fill_policy.value_or(config.ram_fill_policy)
+					)
+				);
+				break;
+
+			case Region_config::Type::Uart:
+				device = uart;
+				break;
+
+			case Region_config::Type::Clock:
+				if (region.irq >= 32)
+					throw std::invalid_argument(
+						std::format("Invalid IRQ line of \"{}\": {}", region.name, region.irq)
+					);
+				clock->set_interrupt_line(region.irq);
+				device = clock;
+				break;
+
+			case Region_config::Type::Sim_control:
+				device = sim_control;
+				break;
+			}
+
+			const bool is_peripheral = region.type != Region_config::Type::Rom
+									&& region.type != Region_config::Type::Ram;
+			if (is_peripheral && !attached_peripherals.insert(region.type).second)
+				throw std::invalid_argument(std::format("Duplicated peripheral region \"{}\"", region.name));
+
+			bus->attach(region.name, region.base, device);
+			region.size = device->size();
+		}
+
+		if (rom == nullptr) throw std::invalid_argument("Layout has no ROM region");
+		if (rams.empty()) throw std::invalid_argument("Layout has no RAM region");
+
+		cpu = std::make_unique<core::CPU_module>(config.reset_pc, bus);
+	}
+
+	Machine::~Machine() = default;
+
+	void Machine::load_flash(std::span<const u8> image)
+	{
+		if (!rom->load(image))
+			throw std::runtime_error(
+				std::format(
+					"ROM init data size ({} Bytes) exceeds ROM size ({} Bytes)",
+					image.size(),
+					rom->size()
+				)
+			);
+
+		cpu->inst_fetch.fencei();
+	}
+
+	void Machine::load_flash_file(const std::filesystem::path& path)
+	{
+		rom->map_file(path);
+		cpu->inst_fetch.fencei();
+	}
+
+	void Machine::load_image(u64 address, std::span<const u8> image)
+	{
+		rom->unlock();
+		const auto result = write_memory(address, image);
+		rom->lock();
+
+		if (!result)
+			throw std::runtime_error(
+				std::format("Failed to load image of {} Bytes at 0x{:08x}", image.size(), address)
+			);
+	}
+
+	void Machine::reset()
+	{
+		auto breakpoints = std::move(cpu->inst_fetch.breakpoints);
+
+		cpu = std::make_unique<core::CPU_module>(config.reset_pc, bus);
+		cpu->coverage_map = coverage_map;
+		cpu->inst_fetch.breakpoints = std::move(breakpoints);
+		for (const auto& ram : rams) ram->reset_content();
+		clock->reset();
+		sim_control->reset();
+		inst_executed = 0;
+	}
+
+	Machine::Snapshot Machine::take_snapshot()
+	{
+		Snapshot snapshot{
+			.pc = cpu->pc,
+			.waiting_for_interrupt = cpu->waiting_for_interrupt,
+			.registers = cpu->registers,
+			.csr = cpu->csr,
+			.clock = *clock,
+			.rams = {},
+			.inst_executed = inst_executed
+		};
+
+		snapshot.rams.reserve(rams.size());
+		for (const auto& ram : rams) snapshot.rams.push_back(ram->take_snapshot());
+
+		return snapshot;
+	}
+
+	void Machine::restore_snapshot(const Snapshot& snapshot)
+	{
+		cpu->pc = snapshot.pc;
+		cpu->waiting_for_interrupt = snapshot.waiting_for_interrupt;
+		cpu->registers = snapshot.registers;
+		cpu->csr = snapshot.csr;
+		cpu->coverage_prev_location = 0;
+		cpu->inst_fetch.fencei();
+
+		*clock = snapshot.clock;
+		for (size_t i = 0; i < rams.size(); i++) rams[i]->restore_snapshot(snapshot.rams[i]);
+		sim_control->reset();
+		inst_executed = snapshot.inst_executed;
+	}
+
+	Machine::Checkpoint Machine::take_checkpoint(const Checkpoint* previous)
+	{
+		Checkpoint checkpoint{
+			.pc = cpu->pc,
+			.waiting_for_interrupt = cpu->waiting_for_interrupt,
+			.registers = cpu->registers,
+			.csr = cpu->csr,
+			.clock = *clock,
+			.rams = {},
+			.inst_executed = inst_executed
+		};
+
+		checkpoint.rams.reserve(rams.size());
+		for (size_t i = 0; i < rams.size(); i++)
+			checkpoint.rams.push_back(rams[i]->take_checkpoint(previous ? &previous->rams[i] : nullptr));
+
+		return checkpoint;
+	}
+
+	void Machine::restore_checkpoint(const Checkpoint& checkpoint, const Checkpoint* latest)
+	{
+		cpu->pc = checkpoint.pc;
+		cpu->waiting_for_interrupt = checkpoint.waiting_for_interrupt;
+		cpu->registers = checkpoint.registers;
+		cpu->csr = checkpoint.csr;
+		cpu->coverage_prev_location = 0;
+		cpu->inst_fetch.fencei();
+
+		*clock = checkpoint.clock;
+		for (size_t i = 0; i < rams.size(); i++)
+			rams[i]->restore_checkpoint(checkpoint.rams[i], latest ? &latest->rams[i] : nullptr);
+		inst_executed = checkpoint.inst_executed;
+	}
+
+	void Machine::get_registers(std::span<u32, 32> registers) const noexcept
+	{
+		for (u32 i = 0; i < 32; i++) registers[i] = cpu->registers.get_register(i);
+	}
+
+	void Machine::set_registers(std::span<const u32, 32> registers) noexcept
+	{
+		for (u32 i = 1; i < 32; i++) cpu->registers.set_register(i, registers[i]);
+	}
+
+	std::expected<void, Machine::Error> Machine::read_memory(u64 address, std::span<u8> data)
+	{
+		return bus->read_block(address, data);
+	}
+
+	std::expected<void, Machine::Error> Machine::write_memory(u64 address, std::span<const u8> data)
+	{
+		const auto result = bus->write_block(address, data);
+		if (!data.empty()) cpu->inst_fetch.fencei();
+
+		return result;
+	}
+
+	void Machine::attach_device(std::string name, u64 base, std::shared_ptr<core::Memory_interface> device)
+	{
+		bus->attach(std::move(name), base, std::move(device));
+	}
+
+	void Machine::set_coverage_map(std::span<u8> map)
+	{
+		coverage_map = map;
+		cpu->coverage_map = map;
+		cpu->coverage_prev_location = 0;
+	}
+
+	std::string Machine::generate_memory_map_xml() const
+	{
+		std::string xml = "<?xml version=\"1.0\"?>\n<memory-map>\n";
+
+		for (const auto& region : bus->get_regions())
+		{
+			const auto find = std::ranges::find(config.regions, region.name, &Region_config::name);
+			const auto is_ram = find != config.regions.end() && find->type == Region_config::Type::Ram;
+
+			// Peripherals are reported as ROM, so GDB reads them but doesn't write them
+			xml += std::format(
+				"\t<!-- {} -->\n\t<memory type=\"{}\" start=\"0x{:08x}\" length=\"0x{:08x}\"/>\n",
+				region.name,
+				is_ram ? "ram" : "rom",
+				region.base,
+				region.size
+			);
+		}
+
+		xml += "</memory-map>\n";
+		return xml;
+	}
+
+	Machine::Hook_handle Machine::add_instruction_hook(Instruction_hook hook)
+	{
+		const auto id = next_hook_id++;
+		instruction_hooks.emplace_back(id, std::move(hook));
+		return Hook_handle{.id = id};
+	}
+
+	bool Machine::remove_hook(Hook_handle handle)
+	{
+		const auto removed = std::erase_if(
+			instruction_hooks,
+			[handle](const auto& entry) { return entry.first == handle.id; }
+		);
+
+		return removed != 0;
+	}
+
+	void Machine::call_instruction_hooks(const Result& result)
+	{
+		for (const auto& [id, hook] : instruction_hooks) hook(*this, result);
+	}
+}
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include "core/decode.hpp"
+
+namespace
+{
+	core::Register_file_module create_registers()
+	{
+		core::Register_file_module registers;
+		for (u32 i = 1; i < registers.registers.size(); i++) registers.registers[i] = 0x100 + i;
+		return registers;
+	}
+}
+
+TEST(Decode, Immediate)
+{
+	using core::Inst_format;
+
+	EXPECT_EQ(core::get_immediate(Inst_format::I, 0xfff50513), 0xffffffff);  // addi a0, a0, -1
+	EXPECT_EQ(core::get_immediate(Inst_format::I, 0x7ff50513), 0x7ff);       // addi a0, a0, 2047
+	EXPECT_EQ(core::get_immediate(Inst_format::S, 0xfea42e23), 0xfffffffc);  // sw a0, -4(s0)
+	EXPECT_EQ(core::get_immediate(Inst_format::B, 0xfe050ee3), 0xfffffffc);  // beqz a0, -4
+	EXPECT_EQ(core::get_immediate(Inst_format::B, 0x00b50863), 0x10);        // beq a0, a1, 16
+	EXPECT_EQ(core::get_immediate(Inst_format::U, 0x800002b7), 0x80000000);  // lui t0, 0x80000
+	EXPECT_EQ(core::get_immediate(Inst_format::J, 0xff9ff0ef), 0xfffffff8);  // jal -8
+	EXPECT_EQ(core::get_immediate(Inst_format::J, 0x0000006f), 0);           // j .
+	EXPECT_EQ(core::get_immediate(Inst_format::R, 0x00b50533), 0);           // add a0, a0, a1
+}
+
+TEST(Decode, Descriptors)
+{
+	const auto descriptors = core::get_inst_descriptors();
+	ASSERT_FALSE(descriptors.empty());
+
+	// Each descriptor is found from its own encoding
+	for (const auto& descriptor : descriptors)
+	{
+		const auto* found = core::find_inst_descriptor(descriptor.match);
+		ASSERT_NE(found, nullptr) << descriptor.name;
+		EXPECT_EQ(found->name, descriptor.name);
+	}
+
+	EXPECT_EQ(core::find_inst_descriptor(0x00b50533)->name, "add");
+	EXPECT_EQ(core::find_inst_descriptor(0x40b50533)->name, "sub");
+	EXPECT_EQ(core::find_inst_descriptor(0x0e55d533)->name, "czero.eqz");
+	EXPECT_EQ(core::find_inst_descriptor(0x30200073)->name, "mret");
+
+	EXPECT_EQ(core::find_inst_descriptor(0x0000000f), nullptr);  // fence
+	EXPECT_EQ(core::find_inst_descriptor(0x00002063), nullptr);  // Reserved branch
+	EXPECT_EQ(core::find_inst_descriptor(0x00000001), nullptr);  // RV32C
+	EXPECT_EQ(core::find_inst_descriptor(0x2015d513), nullptr);  // srai with a reserved `funct7`
+	EXPECT_EQ(core::find_inst_descriptor(0x00001067), nullptr);  // jalr with a reserved `funct3`
+	EXPECT_EQ(core::find_inst_descriptor(0x00100173), nullptr);  // ebreak with a nonzero `rd`
+}
+
+TEST(Decode, Operands)
+{
+	const auto registers = create_registers();
+	core::Inst_decode_module decode;
+
+	// add a0, a1, a2
+	const auto add = decode(registers, 0x00c58533, 0x1000);
+	ASSERT_TRUE(add.has_value());
+	EXPECT_EQ(add->writeback_source, core::Register_source::Alu);
+	EXPECT_EQ(add->dest_register, 10u);
+	EXPECT_EQ(add->alu_opcode, core::ALU_module::Opcode::Add);
+	EXPECT_EQ(add->alu_num1, 0x10b);
+	EXPECT_EQ(add->alu_num2, 0x10c);
+
+	// sw a0, -4(s0)
+	const auto sw = decode(registers, 0xfea42e23, 0x1000);
+	ASSERT_TRUE(sw.has_value());
+	EXPECT_EQ(sw->writeback_source, core::Register_source::None);
+	EXPECT_EQ(sw->memory_opcode, core::Load_store_module::Opcode::Store);
+	EXPECT_EQ(sw->memory_funct, core::Load_store_module::Funct::Store_word);
+	EXPECT_EQ(sw->alu_num1, 0x108);
+	EXPECT_EQ(sw->alu_num2, 0xfffffffc);
+	EXPECT_EQ(sw->memory_store_value, 0x10a);
+
+	// beq a0, a1, 16
+	const auto beq = decode(registers, 0x00b50863, 0x1000);
+	ASSERT_TRUE(beq.has_value());
+	EXPECT_EQ(beq->branch_opcode, core::Branch_module::Opcode::Eq);
+	EXPECT_EQ(beq->alu_num1, 0x1000);
+	EXPECT_EQ(beq->alu_num2, 0x10);
+	EXPECT_EQ(beq->branch_num1, 0x10a);
+	EXPECT_EQ(beq->branch_num2, 0x10b);
+
+	// jal ra, -8
+	const auto jal = decode(registers, 0xff9ff0ef, 0x1000);
+	ASSERT_TRUE(jal.has_value());
+	EXPECT_EQ(jal->writeback_source, core::Register_source::Pc_plus_4);
+	EXPECT_EQ(jal->dest_register, 1u);
+	EXPECT_EQ(jal->alu_num1, 0x1000);
+	EXPECT_EQ(jal->alu_num2, 0xfffffff8);
+
+	EXPECT_EQ(decode(registers, 0x00002063, 0x1000), std::unexpected(core::Trap::Illegal_instruction));
+}
+
+TEST(Decode, Csr)
+{
+	const auto registers = create_registers();
+	core::Inst_decode_module decode;
+
+	// csrrwi a0, mscratch, 31: the immediate is zero-extended
+	const auto csrrwi = decode(registers, 0x340fd573, 0x1000);
+	ASSERT_TRUE(csrrwi.has_value());
+	EXPECT_EQ(csrrwi->writeback_source, core::Register_source::Csr);
+	EXPECT_EQ(csrrwi->csr_access_info.address, 0x340u);
+	EXPECT_EQ(csrrwi->csr_access_info.write_mode, core::CSR_write_mode::Overwrite);
+	EXPECT_EQ(csrrwi->csr_access_info.write_value, 31u);
+	EXPECT_TRUE(csrrwi->csr_access_info.read);
+
+	// csrw mscratch, a1: no read without `rd`
+	const auto csrw = decode(registers, 0x34059073, 0x1000);
+	ASSERT_TRUE(csrw.has_value());
+	EXPECT_EQ(csrw->csr_access_info.write_value, 0x10bu);
+	EXPECT_FALSE(csrw->csr_access_info.read);
+
+	// csrr a0, mscratch: no write from `x0`
+	const auto csrr = decode(registers, 0x34002573, 0x1000);
+	ASSERT_TRUE(csrr.has_value());
+	EXPECT_EQ(csrr->csr_access_info.write_mode, core::CSR_write_mode::None);
+	EXPECT_TRUE(csrr->csr_access_info.read);
+
+	// csrrw a0, mscratch, x0: clears the CSR
+	const auto csrrw = decode(registers, 0x34001573, 0x1000);
+	ASSERT_TRUE(csrrw.has_value());
+	EXPECT_EQ(csrrw->csr_access_info.write_mode, core::CSR_write_mode::Overwrite);
+	EXPECT_EQ(csrrw->csr_access_info.write_value, 0u);
+	EXPECT_TRUE(csrrw->csr_access_info.read);
+}
@@ -0,0 +1 @@
+generate_tests("core")
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <random>
+
+#include "device/address-decoder.hpp"
+
+namespace
+{
+	using Range = device::Address_decoder::Range;
+
+	// Reference implementation
+	std::optional<size_t> linear_find(std::span<const Range> ranges, u64 address)
+	{
+		for (size_t i = 0; i < ranges.size(); i++)
+			if (address >= ranges[i].base && address - ranges[i].base < ranges[i].size) return i;
+
+		return std::nullopt;
+	}
+}
+
+TEST(AddressDecoder, StandardLayout)
+{
+	const std::vector<Range> ranges = {
+		{0x0001'0000, 0x100        },  // UART
+		{0x0001'1000, 0x100        },  // Clock
+		{0x0001'2000, 0x100        },  // Sim control
+		{0x0010'0000, 128 * 1024   },  // ROM
+		{0x8000'0000, 0x8000'0000  },  // RAM
+	};
+
+	device::Address_decoder decoder;
+	decoder.build(ranges);
+
+	EXPECT_EQ(decoder.find(0x0001'0000), 0);
+	EXPECT_EQ(decoder.find(0x0001'00fc), 0);
+	EXPECT_EQ(decoder.find(0x0001'0100), std::nullopt);
+	EXPECT_EQ(decoder.find(0x0001'1004), 1);
+	EXPECT_EQ(decoder.find(0x0001'2010), 2);
+	EXPECT_EQ(decoder.find(0x0001'3000), std::nullopt);
+	EXPECT_EQ(decoder.find(0x0010'0000), 3);
+	EXPECT_EQ(decoder.find(0x0011'fffc), 3);
+	EXPECT_EQ(decoder.find(0x0012'0000), std::nullopt);
+	EXPECT_EQ(decoder.find(0x7fff'fffc), std::nullopt);
+	EXPECT_EQ(decoder.find(0x8000'0000), 4);
+	EXPECT_EQ(decoder.find(0xffff'fffc), 4);
+	EXPECT_EQ(decoder.find(0x1'0000'0000), std::nullopt);
+	EXPECT_EQ(decoder.find(0), std::nullopt);
+}
+
+TEST(AddressDecoder, SharedPage)
+{
+	// Several ranges in a page, and ranges above 4 GiB
+	const std::vector<Range> ranges = {
+		{0x1000,        0x10       },
+		{0x1010,        0x10       },
+		{0x1040,        0x2000     },
+		{0xffff'f000,   0x2000     },
+		{0x2'0000'0000, 0x1000     },
+	};
+
+	device::Address_decoder decoder;
+	decoder.build(ranges);
+
+	for (const u64 address : {0x0ff0, 0x1000, 0x100c, 0x1010, 0x1020, 0x1040, 0x303c, 0x3040})
+		EXPECT_EQ(decoder.find(address), linear_find(ranges, address)) << std::hex << address;
+
+	EXPECT_EQ(decoder.find(0xffff'fffc), 3);
+	EXPECT_EQ(decoder.find(0x1'0000'0ffc), 3);
+	EXPECT_EQ(decoder.find(0x1'0000'1000), std::nullopt);
+	EXPECT_EQ(decoder.find(0x2'0000'0000), 4);
+}
+
+TEST(AddressDecoder, Random)
+{
+	std::mt19937_64 random(1);
+
+	for (int round = 0; round < 20; round++)
+	{
+		std::vector<Range> ranges;
+		u64 base = 0;
+		for (int i = 0; i < 64; i++)
+		{
+			base += std::uniform_int_distribution<u64>(0, 0x20'0000)(random);
+			const auto size = std::uniform_int_distribution<u64>(1, 0x10'0000)(random);
+			ranges.push_back({base, size});
+			base += size;
+		}
+
+		device::Address_decoder decoder;
+		decoder.build(ranges);
+
+		for (int i = 0; i < 10000; i++)
+		{
+			const auto address = std::uniform_int_distribution<u64>(0, base + 0x1000)(random);
+			ASSERT_EQ(decoder.find(address), linear_find(ranges, address)) << std::hex << address;
+		}
+
+		for (const auto& range : ranges)
+		{
+			const auto end = range.base + range.size;
+			ASSERT_EQ(decoder.find(range.base), linear_find(ranges, range.base));
+			ASSERT_EQ(decoder.find(end - 1), linear_find(ranges, end - 1));
+			ASSERT_EQ(decoder.find(end), linear_find(ranges, end));
+		}
+	}
+}
+
+TEST(AddressDecoder, InvalidRanges)
+{
+	device::Address_decoder decoder;
+
+	EXPECT_THROW(decoder.build(std::vector<Range>{{0x1000, 0}}), std::invalid_argument);
+	EXPECT_THROW(decoder.build(std::vector<Range>{{~u64(0), 2}}), std::invalid_argument);
+	EXPECT_THROW(decoder.build(std::vector<Range>{{0x1000, 0x100}, {0x10f0, 0x100}}), std::invalid_argument);
+	EXPECT_THROW(decoder.build(std::vector<Range>{{0x2000, 0x100}, {0x1000, 0x100}}), std::invalid_argument);
+
+	EXPECT_NO_THROW(decoder.build(std::vector<Range>{}));
+	EXPECT_EQ(decoder.find(0), std::nullopt);
+}
@@ -122,4 +122,149 @@ TEST(BlockMemory, Unaligned)
 		ASSERT_FALSE(write_result.has_value());
 		EXPECT_EQ(write_result.error(), core::Memory_interface::Error::Unaligned);
 	}
-}
\ No newline at end of file
+}
+TEST(BlockMemory, BlockAccess)
+{
+	constexpr u64 page_size = device::Block_memory::page_size_bytes;
+	device::Block_memory mem(4 * page_size, device::Fill_policy::Zero);
+
+	// Crosses two page boundaries, unaligned at both ends
+	std::vector<u8> input(page_size + 9);
+	std::ranges::generate(input, [i = 0]() mutable { return static_cast<u8>(i++ * 7); });
+	ASSERT_TRUE(mem.write_block(page_size - 3, input).has_value());
+
+	std::vector<u8> output(input.size());
+	ASSERT_TRUE(mem.read_block(page_size - 3, output).has_value());
+	EXPECT_EQ(input, output);
+
+	EXPECT_EQ(mem.read(page_size - 4), u32(input[0]) << 8 | u32(input[1]) << 16 | u32(input[2]) << 24);
+	EXPECT_EQ(mem.get_dirty_pages(), std::vector<size_t>({0, 1, 2}));
+
+	// Last byte is readable, one past it isn't
+	std::array<u8, 2> pair;
+	EXPECT_TRUE(mem.read_block(4 * page_size - 2, pair).has_value());
+	EXPECT_EQ(mem.read_block(4 * page_size - 1, pair).error(), core::Memory_interface::Error::Out_of_range);
+	EXPECT_EQ(mem.write_block(4 * page_size - 1, pair).error(), core::Memory_interface::Error::Out_of_range);
+
+	mem.lock();
+	EXPECT_EQ(mem.write_block(0, pair).error(), core::Memory_interface::Error::Access_fault);
+}
+
+TEST(BlockMemory, DirtyPages)
+{
+	constexpr auto page_size = device::Block_memory::page_size_bytes;
+	device::Block_memory mem(16 * page_size, device::Fill_policy::Zero);
+
+	EXPECT_EQ(mem.page_count(), 16);
+	EXPECT_TRUE(mem.get_dirty_pages().empty());
+
+	// Reads allocate pages, but don't dirty them
+	ASSERT_TRUE(mem.read(3 * page_size).has_value());
+	EXPECT_FALSE(mem.is_page_dirty(3));
+	EXPECT_EQ(mem.used_space(), page_size);
+
+	ASSERT_TRUE(mem.write(1 * page_size + 4, 0x12345678, 0b1111).has_value());
+	ASSERT_TRUE(mem.write(1 * page_size + 8, 0x12345678, 0b1111).has_value());
+	ASSERT_TRUE(mem.write(15 * page_size, 0x12345678, 0b0001).has_value());
+	EXPECT_TRUE(mem.is_page_dirty(1));
+	EXPECT_EQ(mem.get_dirty_pages(), (std::vector<size_t>{1, 15}));
+	EXPECT_EQ(mem.used_space(), 3 * page_size);
+
+	mem.clear_dirty_pages();
+	EXPECT_TRUE(mem.get_dirty_pages().empty());
+
+	// Writes masked out or rejected don't dirty the page
+	ASSERT_TRUE(mem.write(2 * page_size, 0x12345678, 0b0000).has_value());
+	mem.lock();
+	ASSERT_FALSE(mem.write(2 * page_size, 0x12345678, 0b1111).has_value());
+	EXPECT_TRUE(mem.get_dirty_pages().empty());
+
+	mem.unlock();
+	mem.reset_content();
+	EXPECT_EQ(mem.used_space(), 0);
+}
+
+TEST(BlockMemory, Snapshot)
+{
+	constexpr auto page_size = device::Block_memory::page_size_bytes;
+	device::Block_memory mem(16 * page_size, device::Fill_policy::Zero);
+
+	ASSERT_TRUE(mem.write(0, 0x11111111, 0b1111).has_value());
+	ASSERT_TRUE(mem.write(page_size, 0x22222222, 0b1111).has_value());
+
+	const auto snapshot = mem.take_snapshot();
+	EXPECT_TRUE(mem.get_dirty_pages().empty());
+
+	for (int i = 0; i < 2; i++)
+	{
+		ASSERT_TRUE(mem.write(0, 0x33333333, 0b1111).has_value());
+		ASSERT_TRUE(mem.write(5 * page_size, 0x44444444, 0b1111).has_value());
+		EXPECT_EQ(mem.used_space(), 3 * page_size);
+
+		mem.restore_snapshot(snapshot);
+		EXPECT_EQ(mem.read(0), 0x11111111);
+		EXPECT_EQ(mem.read(page_size), 0x22222222);
+		EXPECT_EQ(mem.used_space(), 2 * page_size);
+		EXPECT_TRUE(mem.get_dirty_pages().empty());
+	}
+
+	// Restores all pages after the dirty pages are cleared
+	ASSERT_TRUE(mem.write(page_size, 0x55555555, 0b1111).has_value());
+	mem.clear_dirty_pages();
+	mem.restore_snapshot(snapshot);
+	EXPECT_EQ(mem.read(page_size), 0x22222222);
+}
+
+TEST(BlockMemory, Checkpoint)
+{
+	constexpr auto page_size = device::Block_memory::page_size_bytes;
+	device::Block_memory mem(16 * page_size, device::Fill_policy::Zero);
+
+	ASSERT_TRUE(mem.write(0, 0x11111111, 0b1111).has_value());
+	ASSERT_TRUE(mem.write(page_size, 0x22222222, 0b1111).has_value());
+	const auto first = mem.take_checkpoint(nullptr);
+	EXPECT_TRUE(mem.get_dirty_pages().empty());
+
+	// Unchanged pages are shared with the previous checkpoint
+	ASSERT_TRUE(mem.write(0, 0x33333333, 0b1111).has_value());
+	ASSERT_TRUE(mem.write(5 * page_size, 0x44444444, 0b1111).has_value());
+	const auto second = mem.take_checkpoint(&first);
+	ASSERT_EQ(second.pages.size(), 3);
+	EXPECT_NE(second.pages[0].second, first.pages[0].second);
+	EXPECT_EQ(second.pages[1].second, first.pages[1].second);
+
+	ASSERT_TRUE(mem.write(page_size, 0x55555555, 0b1111).has_value());
+
+	mem.restore_checkpoint(first, &second);
+	EXPECT_EQ(mem.read(0), 0x11111111);
+	EXPECT_EQ(mem.read(page_size), 0x22222222);
+	EXPECT_EQ(mem.used_space(), 2 * page_size);
+	EXPECT_TRUE(mem.get_dirty_pages().empty());
+
+	mem.restore_checkpoint(second, &first);
+	EXPECT_EQ(mem.read(0), 0x33333333);
+	EXPECT_EQ(mem.read(page_size), 0x22222222);
+	EXPECT_EQ(mem.read(5 * page_size), 0x44444444);
+
+	// Restores all pages without the latest checkpoint
+	ASSERT_TRUE(mem.write(page_size, 0x55555555, 0b1111).has_value());
+	mem.clear_dirty_pages();
+	mem.restore_checkpoint(first, nullptr);
+	EXPECT_EQ(mem.read(page_size), 0x22222222);
+	EXPECT_EQ(mem.used_space(), 2 * page_size);
+}
+
+TEST(BlockMemory, RandomFillRepeatable)
+{
+	constexpr auto page_size = device::Block_memory::page_size_bytes;
+	device::Block_memory mem(16 * page_size, device::Fill_policy::Random);
+
+	const auto checkpoint = mem.take_checkpoint(nullptr);
+	const auto value = mem.read(3 * page_size);
+	ASSERT_TRUE(value.has_value());
+
+	// The page released by the restore gets the same content when allocated again
+	mem.restore_checkpoint(checkpoint, nullptr);
+	EXPECT_EQ(mem.used_space(), 0);
+	EXPECT_EQ(mem.read(3 * page_size), value);
+}
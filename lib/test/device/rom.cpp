@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+#include "device/rom.hpp"
+
+namespace
+{
+	constexpr std::array<u8, 6> test_image = {0x78, 0x56, 0x34, 0x12, 0xef, 0xbe};
+}
+
+TEST(Rom, Load)
+{
+	device::Rom rom(64 * 1024);
+	EXPECT_EQ(rom.size(), 64 * 1024);
+
+	ASSERT_TRUE(rom.load(test_image));
+	EXPECT_FALSE(rom.is_mapped());
+
+	EXPECT_EQ(rom.read(0), 0x12345678);
+	EXPECT_EQ(rom.read(4), 0x0000beef);  // Partial word, padded with zeros
+	EXPECT_EQ(rom.read(8), 0);
+	EXPECT_EQ(rom.read(1).error(), core::Memory_interface::Error::Unaligned);
+	EXPECT_EQ(rom.read(64 * 1024).error(), core::Memory_interface::Error::Out_of_range);
+
+	std::array<u32, 1024> page;
+	ASSERT_TRUE(rom.read_page(0, page).has_value());
+	EXPECT_EQ(page[0], 0x12345678);
+	EXPECT_EQ(page[1], 0x0000beef);
+	EXPECT_EQ(page[2], 0);
+	EXPECT_FALSE(rom.read_page(64 * 1024, page).has_value());
+
+	std::vector<u8> large_image(64 * 1024 + 1);
+	EXPECT_FALSE(rom.load(large_image));
+}
+
+TEST(Rom, Write)
+{
+	device::Rom rom(64 * 1024);
+	ASSERT_TRUE(rom.load(test_image));
+
+	const auto locked_result = rom.write(0, 0xdeadbeef, 0b1111);
+	ASSERT_FALSE(locked_result.has_value());
+	EXPECT_EQ(locked_result.error(), core::Memory_interface::Error::Access_fault);
+
+	rom.unlock();
+	ASSERT_TRUE(rom.write(0, 0xdeadbeef, 0b0011).has_value());
+	ASSERT_TRUE(rom.write(1024, 0xcafebabe, 0b1111).has_value());
+	rom.lock();
+
+	EXPECT_EQ(rom.read(0), 0x1234beef);
+	EXPECT_EQ(rom.read(4), 0x0000beef);
+	EXPECT_EQ(rom.read(1024), 0xcafebabe);
+
+	// Block access, content past the image reads as zero
+	std::array<u8, 6> block;
+	ASSERT_TRUE(rom.read_block(3, block).has_value());
+	EXPECT_EQ(block, (std::array<u8, 6>{0x12, 0xef, 0xbe, 0x00, 0x00, 0x00}));
+
+	const std::array<u8, 3> patch = {0xaa, 0xbb, 0xcc};
+	EXPECT_EQ(rom.write_block(1, patch).error(), core::Memory_interface::Error::Access_fault);
+
+	rom.unlock();
+	ASSERT_TRUE(rom.write_block(1, patch).has_value());
+	EXPECT_EQ(rom.read(0), 0xccbbaaef);
+	EXPECT_EQ(rom.write_block(64 * 1024 - 2, patch).error(), core::Memory_interface::Error::Out_of_range);
+}
+
+TEST(Rom, MapFile)
+{
+	const auto path = std::filesystem::temp_directory_path() / "rom-test.bin";
+	std::ofstream(path, std::ios::binary)
+		.write(reinterpret_cast<const char*>(test_image.data()), test_image.size());
+
+	device::Rom rom(64 * 1024);
+	rom.map_file(path);
+	EXPECT_TRUE(rom.is_mapped());
+	EXPECT_EQ(rom.read(0), 0x12345678);
+	EXPECT_EQ(rom.read(4), 0x0000beef);
+
+	// Writing copies the content, the file is left untouched
+	rom.unlock();
+	ASSERT_TRUE(rom.write(0, 0xdeadbeef, 0b1111).has_value());
+	EXPECT_FALSE(rom.is_mapped());
+	EXPECT_EQ(rom.read(0), 0xdeadbeef);
+	EXPECT_EQ(rom.read(4), 0x0000beef);
+	EXPECT_EQ(std::filesystem::file_size(path), test_image.size());
+
+	device::Rom small_rom(4);
+	EXPECT_THROW(small_rom.map_file(path), std::runtime_error);
+	EXPECT_THROW(small_rom.map_file(path.string() + ".missing"), std::runtime_error);
+
+	std::filesystem::remove(path);
+}
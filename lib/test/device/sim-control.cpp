@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+
+#include "device/block-memory.hpp"
+#include "device/periph/sim-control.hpp"
+
+namespace
+{
+	using Command = device::periph::Sim_control::Command;
+	using File_mode = device::periph::Sim_control::File_mode;
+
+	constexpr auto failure = device::periph::Sim_control::failure;
+
+	u32 execute(device::periph::Sim_control& sim, Command command, u32 arg0 = 0, u32 arg1 = 0, u32 arg2 = 0)
+	{
+		EXPECT_TRUE(sim.write(0x04, arg0, 0b1111).has_value());
+		EXPECT_TRUE(sim.write(0x08, arg1, 0b1111).has_value());
+		EXPECT_TRUE(sim.write(0x0c, arg2, 0b1111).has_value());
+		EXPECT_TRUE(sim.write(0x00, static_cast<u32>(command), 0b1111).has_value());
+
+		const auto result = sim.read(0x10);
+		EXPECT_TRUE(result.has_value());
+		return result.value_or(0);
+	}
+
+	void write_string(core::Memory_interface& memory, u64 address, std::string_view str)
+	{
+		const std::span data(reinterpret_cast<const u8*>(str.data()), str.size());
+		ASSERT_TRUE(memory.write_block(address, data).has_value());
+	}
+}
+
+TEST(SimControl, Exit)
+{
+	device::Block_memory mem(4096, device::Fill_policy::Zero);
+	device::periph::Sim_control sim(mem);
+
+	EXPECT_FALSE(sim.get_exit_code().has_value());
+	EXPECT_EQ(execute(sim, Command::Exit, 42), 0);
+	EXPECT_EQ(sim.get_exit_code(), 42);
+
+	sim.reset();
+	EXPECT_FALSE(sim.get_exit_code().has_value());
+}
+
+TEST(SimControl, ConsoleWrite)
+{
+	device::Block_memory mem(16 * 1024, device::Fill_policy::Zero);
+	device::periph::Sim_control sim(mem);
+
+	std::ostringstream output;
+	sim.set_output_stream(output);
+
+	// Longer than one transfer chunk and unaligned
+	const std::string message = std::string(5000, 'x') + "Hello";
+	write_string(mem, 3, message);
+
+	EXPECT_EQ(execute(sim, Command::Console_write, 3, message.size()), message.size());
+	EXPECT_EQ(output.str(), message);
+
+	EXPECT_EQ(execute(sim, Command::Console_write, 16 * 1024 - 2, 4), failure);
+}
+
+TEST(SimControl, HostFiles)
+{
+	const auto root = std::filesystem::temp_directory_path() / "sim-control-test";
+	std::filesystem::create_directories(root);
+
+	device::Block_memory mem(4096, device::Fill_policy::Zero);
+	device::periph::Sim_control sim(mem);
+
+	constexpr u32 path_address = 0x000;
+	constexpr u32 data_address = 0x100;
+	constexpr u32 read_address = 0x200;
+	constexpr auto read_mode = static_cast<u32>(File_mode::Read);
+	constexpr auto write_mode = static_cast<u32>(File_mode::Write);
+
+	write_string(mem, path_address, std::string_view("test.txt\0", 9));
+	write_string(mem, data_address, "0123456789");
+
+	// Disabled without a root directory
+	EXPECT_EQ(execute(sim, Command::File_open, path_address, write_mode), failure);
+
+	sim.set_host_file_root(root);
+
+	const auto write_handle = execute(sim, Command::File_open, path_address, write_mode);
+	ASSERT_NE(write_handle, failure);
+	EXPECT_EQ(execute(sim, Command::File_write, write_handle, data_address, 10), 10);
+	EXPECT_EQ(execute(sim, Command::File_close, write_handle), 0);
+	EXPECT_EQ(execute(sim, Command::File_close, write_handle), failure);
+
+	const auto read_handle = execute(sim, Command::File_open, path_address, read_mode);
+	ASSERT_NE(read_handle, failure);
+	EXPECT_EQ(execute(sim, Command::File_read, read_handle, read_address, 6), 6);
+	EXPECT_EQ(execute(sim, Command::File_read, read_handle, read_address + 6, 100), 4);
+	EXPECT_EQ(execute(sim, Command::File_read, read_handle, read_address, 100), 0);
+	EXPECT_EQ(execute(sim, Command::File_close, read_handle), 0);
+
+	std::array<u8, 10> read_back;
+	ASSERT_TRUE(mem.read_block(read_address, read_back).has_value());
+	EXPECT_EQ(std::string(read_back.begin(), read_back.end()), "0123456789");
+
+	// Escaping the root is denied
+	write_string(mem, path_address, std::string_view("../escape.txt\0", 14));
+	EXPECT_EQ(execute(sim, Command::File_open, path_address, write_mode), failure);
+
+	// Also through a symbolic link pointing outside
+	const auto outside = std::filesystem::temp_directory_path() / "sim-control-test-outside";
+	std::filesystem::create_directories(outside);
+	std::ofstream(outside / "secret.txt") << "secret";
+	std::filesystem::remove(root / "link");
+	std::filesystem::create_directory_symlink(outside, root / "link");
+
+	write_string(mem, path_address, std::string_view("link/secret.txt\0", 16));
+	EXPECT_EQ(execute(sim, Command::File_open, path_address, read_mode), failure);
+	EXPECT_EQ(execute(sim, Command::File_open, path_address, write_mode), failure);
+	EXPECT_EQ(std::filesystem::file_size(outside / "secret.txt"), 6);
+
+	std::filesystem::remove_all(root);
+	std::filesystem::remove_all(outside);
+}
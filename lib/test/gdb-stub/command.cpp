@@ -10,8 +10,8 @@ using namespace gdb_stub;
 	{                                                                                                        \
 		const auto result = command::parse(str);                                                             \
 		ASSERT_TRUE(result.has_value());                                                                     \
-		ASSERT_TRUE(result.type() == typeid(_type));                                                         \
-		const auto& value [[maybe_unused]] = std::any_cast<_type>(result);                                   \
+		ASSERT_TRUE(std::holds_alternative<_type>(*result));                                                 \
+		const auto& value [[maybe_unused]] = std::get<_type>(*result);                                       \
 		__VA_ARGS__                                                                                          \
 	}
 
@@ -158,6 +158,28 @@ TEST(CommandParse, WriteMemory)
 	TEST_NEGATIVE("Mdeadbeef,3:ABcd")
 }
 
+TEST(CommandParse, WriteMemoryBinary)
+{
+	using namespace std::string_view_literals;
+
+	TEST_POSITIVE("X123,4:\x00:#*"sv, command::Write_memory, {
+		EXPECT_EQ(value.address, 0x123);
+		EXPECT_EQ(value.data, std::vector<u8>({0x00, ':', '#', '*'}));
+	});
+
+	// Support probe
+	TEST_POSITIVE("X80000000,0:", command::Write_memory, {
+		EXPECT_EQ(value.address, 0x80000000);
+		EXPECT_TRUE(value.data.empty());
+	});
+
+	TEST_NEGATIVE("X")
+	TEST_NEGATIVE("X123,4")
+	TEST_NEGATIVE("X123,4:abc")
+	TEST_NEGATIVE("X123,2:abc")
+	TEST_NEGATIVE("X,2:ab")
+}
+
 TEST(CommandParse, ReadWriteSingleRegister)
 {
 	TEST_POSITIVE("p0", command::Read_single_register, { EXPECT_EQ(value.regno, 0); });
@@ -199,6 +221,16 @@ TEST(CommandParse, StepSingle)
 	TEST_NEGATIVE("s1234w555");
 }
 
+TEST(CommandParse, Reverse)
+{
+	TEST_POSITIVE("bs", command::Reverse_step);
+	TEST_POSITIVE("bc", command::Reverse_continue);
+
+	TEST_NEGATIVE("b");
+	TEST_NEGATIVE("bx");
+	TEST_NEGATIVE("bss");
+}
+
 TEST(CommandParse, qSupported)
 {
 	using namespace std::string_view_literals;
@@ -228,6 +260,68 @@ TEST(CommandParse, qSupported)
 	});
 }
 
+TEST(CommandParse, Vcont)
+{
+	using Kind = command::Vcont::Action::Kind;
+
+	TEST_POSITIVE("vCont?", command::Query_vcont, {});
+
+	TEST_POSITIVE("vCont;c", command::Vcont, {
+		ASSERT_EQ(value.actions.size(), 1);
+		EXPECT_EQ(value.actions[0].kind, Kind::Continue);
+	});
+
+	TEST_POSITIVE("vCont;s:1;C05", command::Vcont, {
+		ASSERT_EQ(value.actions.size(), 2);
+		EXPECT_EQ(value.actions[0].kind, Kind::Step);
+		EXPECT_EQ(value.actions[1].kind, Kind::Continue);
+	});
+
+	TEST_POSITIVE("vCont;r100,11c:p1.1;c", command::Vcont, {
+		ASSERT_EQ(value.actions.size(), 2);
+		EXPECT_EQ(value.actions[0].kind, Kind::Range_step);
+		EXPECT_EQ(value.actions[0].range_start, 0x100);
+		EXPECT_EQ(value.actions[0].range_end, 0x11c);
+	});
+
+	TEST_POSITIVE("vCont;t:p1.-1", command::Vcont, {
+		ASSERT_EQ(value.actions.size(), 1);
+		EXPECT_EQ(value.actions[0].kind, Kind::Stop);
+	});
+
+	TEST_POSITIVE("vCtrlC", command::Interrupt_request, {});
+	TEST_POSITIVE("vStopped", command::Ack_stop_notification, {});
+
+	TEST_NEGATIVE("vCont")
+	TEST_NEGATIVE("vCont;")
+	TEST_NEGATIVE("vCont;c;")
+	TEST_NEGATIVE("vCont;x")
+	TEST_NEGATIVE("vCont;cc")
+	TEST_NEGATIVE("vCont;C")
+	TEST_NEGATIVE("vCont;r100")
+	TEST_NEGATIVE("vCont;t0")
+	TEST_NEGATIVE("vStopped;")
+}
+
+TEST(CommandParse, StartNoAckMode)
+{
+	TEST_POSITIVE("QStartNoAckMode", command::Start_no_ack_mode, {});
+
+	TEST_NEGATIVE("Q")
+	TEST_NEGATIVE("QStartNoAckMode:1")
+	TEST_NEGATIVE("qStartNoAckMode")
+}
+
+TEST(CommandParse, NonStop)
+{
+	TEST_POSITIVE("QNonStop:1", command::Set_non_stop, { EXPECT_TRUE(value.enable); });
+	TEST_POSITIVE("QNonStop:0", command::Set_non_stop, { EXPECT_FALSE(value.enable); });
+
+	TEST_NEGATIVE("QNonStop")
+	TEST_NEGATIVE("QNonStop:2")
+	TEST_NEGATIVE("qNonStop:1")
+}
+
 TEST(CommandParse, qXferFeatureRead)
 {
 	TEST_POSITIVE("qXfer:features:read:target.xml:0,ffb", command::Read_feature_xml, {
@@ -279,15 +373,24 @@ TEST(CommandParse, AddBreakWatch)
 			EXPECT_EQ(value.is_hardware, num == 1);
 			EXPECT_EQ(value.address, 0xdeadbeef);
 			EXPECT_EQ(value.length, 2);
-			EXPECT_FALSE(value.cond.has_value());
+			EXPECT_TRUE(value.conds.empty());
 		});
 
 		TEST_POSITIVE(std::format("Z{},deadbeef,2;X8,00112233AABBCCDD", num), command::Add_breakpoint, {
 			EXPECT_EQ(value.is_hardware, num == 1);
 			EXPECT_EQ(value.address, 0xdeadbeef);
 			EXPECT_EQ(value.length, 2);
-			ASSERT_TRUE(value.cond.has_value());
-			EXPECT_EQ(value.cond.value(), std::vector<u8>({0x00, 0x11, 0x22, 0x33, 0xAA, 0xBB, 0xCC, 0xDD}));
+			ASSERT_EQ(value.conds.size(), 1);
+			EXPECT_EQ(value.conds[0], std::vector<u8>({0x00, 0x11, 0x22, 0x33, 0xAA, 0xBB, 0xCC, 0xDD}));
+		});
+
+		// One condition per breakpoint location at the address, concatenated
+		TEST_POSITIVE(std::format("Z{},deadbeef,4;X3,0a0b0cX2,2122", num), command::Add_breakpoint, {
+			EXPECT_EQ(value.address, 0xdeadbeef);
+			EXPECT_EQ(value.length, 4);
+			ASSERT_EQ(value.conds.size(), 2);
+			EXPECT_EQ(value.conds[0], std::vector<u8>({0x0A, 0x0B, 0x0C}));
+			EXPECT_EQ(value.conds[1], std::vector<u8>({0x21, 0x22}));
 		});
 
 		TEST_NEGATIVE(std::format("Z{},deadbeef,2;X8,00112233AABBCC", num));
@@ -296,6 +399,10 @@ TEST(CommandParse, AddBreakWatch)
 		TEST_NEGATIVE(std::format("Z{},deadbeef,2;X8", num));
 		TEST_NEGATIVE(std::format("Z{},deadbeef,2;X", num));
 		TEST_NEGATIVE(std::format("Z{},deadbeef,2;X,", num));
+		TEST_NEGATIVE(std::format("Z{},deadbeef,2;", num));
+		TEST_NEGATIVE(std::format("Z{},deadbeef,2;X1,00X", num));
+		TEST_NEGATIVE(std::format("Z{},deadbeef,2;X1,000", num));
+		TEST_NEGATIVE(std::format("Z{},deadbeef,2;X0,X1,00", num));
 	}
 
 	for (const auto num : {2, 3, 4})
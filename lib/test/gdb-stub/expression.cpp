@@ -1,6 +1,8 @@
 #include <array>
 #include <gtest/gtest.h>
+#include <memory>
 #include <print>
+#include <vector>
 
 #include "gdb-stub/expression.hpp"
 
@@ -490,4 +492,210 @@ TEST(Expression, RefWidths)
 		ASSERT_TRUE(result.has_value());
 		EXPECT_EQ(result->top, static_cast<u32>(0x44332211));
 	}
-}
\ No newline at end of file
+}
+namespace
+{
+	// Little-endian word memory for compiled expression tests
+	class Word_memory : public core::Memory_interface
+	{
+	  public:
+
+		std::array<u32, 4> words = {0x0706'0504, 0x0b0a'0908, 0x0f0e'0d0c, 0x1312'1110};
+
+		std::expected<u32, Error> read(u64 address) override
+		{
+			if (address & 0x3) return std::unexpected(Error::Unaligned);
+			if (address / 4 >= words.size()) return std::unexpected(Error::Out_of_range);
+			return words[address / 4];
+		}
+
+		std::expected<void, Error> read_page(u64, std::span<u32, 1024>) override
+		{
+			return std::unexpected(Error::Out_of_range);
+		}
+
+		std::expected<void, Error> write(u64, u32, core::Bitset<4>) override
+		{
+			return std::unexpected(Error::Access_fault);
+		}
+
+		u64 size() const override { return words.size() * 4; }
+	};
+
+	std::expected<gdb_stub::expression::Execute_result, gdb_stub::expression::Execute_error> run_compiled(
+		core::CPU_module& cpu,
+		std::span<const u8> bytecode
+	)
+	{
+		const auto compiled = gdb_stub::expression::Compiled_expression::compile(bytecode);
+		if (!compiled) return std::unexpected(compiled.error());
+		return compiled->execute(cpu);
+	}
+}
+
+TEST(CompiledExpression, Basic)
+{
+	core::CPU_module cpu(0x100, std::make_shared<Word_memory>());
+	cpu.registers.set_register(1, 2);
+	cpu.registers.set_register(2, 3);
+
+	const std::array bytecode = std::to_array<u8>(
+		{BYTECODE(Reg, 0x00, 0x01),
+		 BYTECODE(Reg, 0x00, 0x02),
+		 BYTECODE(Const8, 0x0c),
+		 BYTECODE(Ref32),
+		 BYTECODE(Mul),
+		 BYTECODE(Add),
+		 BYTECODE(Reg, 0x00, 0x20),
+		 BYTECODE(End)}
+	);
+
+	const auto result = run_compiled(cpu, bytecode);
+
+	ASSERT_TRUE(result.has_value());
+	EXPECT_EQ(result->top, 0x100);
+	EXPECT_EQ(result->next_to_top, 2 + 0x1312'1110 * 3);
+}
+
+TEST(CompiledExpression, OperandOrder)
+{
+	core::CPU_module cpu(0, std::make_shared<Word_memory>());
+
+	// Binary operations compute `next_to_top <op> top`, in both implementations
+	const auto check = [&cpu](gdb_stub::expression::Bytecode op, u8 a, u8 b, u32 expected)
+	{
+		const std::array bytecode = std::to_array<u8>(
+			{BYTECODE(Const8, a), BYTECODE(Const8, b), static_cast<u8>(op), BYTECODE(End)}
+		);
+
+		const auto compiled = run_compiled(cpu, bytecode);
+		ASSERT_TRUE(compiled.has_value());
+		EXPECT_EQ(compiled->top, expected);
+
+		const auto interpreted = gdb_stub::expression::execute(
+			[](u32) { return std::nullopt; },
+			[](u32) { return std::nullopt; },
+			bytecode
+		);
+		ASSERT_TRUE(interpreted.has_value());
+		EXPECT_EQ(interpreted->top, expected);
+	};
+
+	using gdb_stub::expression::Bytecode;
+	check(Bytecode::Sub, 7, 2, 5);
+	check(Bytecode::Div_unsigned, 7, 2, 3);
+	check(Bytecode::Rem_unsigned, 7, 2, 1);
+	check(Bytecode::Lsh, 1, 4, 16);
+	check(Bytecode::Rsh_unsigned, 16, 4, 1);
+	check(Bytecode::Less_unsigned, 2, 7, 1);
+	check(Bytecode::Less_unsigned, 7, 2, 0);
+}
+
+TEST(CompiledExpression, ControlFlow)
+{
+	core::CPU_module cpu(0, std::make_shared<Word_memory>());
+	cpu.registers.set_register(5, 3);
+
+	// Sum of 1 to x5 with a loop, stack is [counter, sum] at the loop head
+	const std::array bytecode = std::to_array<u8>(
+		{BYTECODE(Reg, 0x00, 0x05),    // 0
+		 BYTECODE(Const8, 0),          // 3
+		 BYTECODE(Pick, 1),            // 5: loop head
+		 BYTECODE(Log_not),            // 7
+		 BYTECODE(If_goto, 0x00, 22),  // 8
+		 BYTECODE(Pick, 1),            // 11
+		 BYTECODE(Add),                // 13
+		 BYTECODE(Swap),               // 14
+		 BYTECODE(Const8, 1),          // 15
+		 BYTECODE(Sub),                // 17
+		 BYTECODE(Swap),               // 18
+		 BYTECODE(Goto, 0x00, 5),      // 19
+		 BYTECODE(End)}                // 22
+	);
+
+	const auto result = run_compiled(cpu, bytecode);
+
+	ASSERT_TRUE(result.has_value());
+	EXPECT_EQ(result->top, 6);
+	EXPECT_EQ(result->next_to_top, 0);
+}
+
+TEST(CompiledExpression, UnalignedMemoryAccess)
+{
+	core::CPU_module cpu(0, std::make_shared<Word_memory>());
+
+	const auto read = [&cpu](gdb_stub::expression::Bytecode ref, u8 address)
+	{
+		const std::array bytecode
+			= std::to_array<u8>({BYTECODE(Const8, address), static_cast<u8>(ref), BYTECODE(End)});
+		return run_compiled(cpu, bytecode);
+	};
+
+	using gdb_stub::expression::Bytecode;
+	EXPECT_EQ(read(Bytecode::Ref8, 0x05)->top, 0x09);
+	EXPECT_EQ(read(Bytecode::Ref16, 0x07)->top, 0x0c0b);
+	EXPECT_EQ(read(Bytecode::Ref32, 0x06)->top, 0x0d0c'0b0a);
+
+	const auto out_of_bound = read(Bytecode::Ref32, 0x0e);
+	ASSERT_FALSE(out_of_bound.has_value());
+	EXPECT_EQ(out_of_bound.error(), gdb_stub::expression::Execute_error::Memory_access_error);
+}
+
+TEST(CompiledExpression, CompileErrors)
+{
+	using gdb_stub::expression::Compiled_expression;
+	using gdb_stub::expression::Execute_error;
+
+	const auto compile_error = [](std::initializer_list<u8> bytecode)
+	{
+		const std::vector<u8> sequence(bytecode);
+		const auto compiled = Compiled_expression::compile(sequence);
+		EXPECT_FALSE(compiled.has_value());
+		return compiled ? std::optional<Execute_error>() : compiled.error();
+	};
+
+	// Errors are found even on paths that are never executed
+	EXPECT_EQ(
+		compile_error(
+			{BYTECODE(Const8, 1),
+			 BYTECODE(Const8, 1),
+			 BYTECODE(If_goto, 0x00, 0x09),
+			 BYTECODE(Pop),
+			 BYTECODE(Pop),
+			 BYTECODE(End)}
+		),
+		Execute_error::Stack_out_of_bound
+	);
+	EXPECT_EQ(
+		compile_error({BYTECODE(Goto, 0x00, 0x01), BYTECODE(End)}),
+		Execute_error::Bytecode_out_of_bound
+	);
+	EXPECT_EQ(compile_error({BYTECODE(Const8, 1)}), Execute_error::Bytecode_out_of_bound);
+	EXPECT_EQ(compile_error({BYTECODE(Const16, 1)}), Execute_error::Bytecode_out_of_bound);
+	EXPECT_EQ(compile_error({0xff, BYTECODE(End)}), Execute_error::Unsupported_bytecode);
+	EXPECT_EQ(
+		compile_error({BYTECODE(Reg, 0x00, 0x40), BYTECODE(End)}),
+		Execute_error::Register_access_error
+	);
+	EXPECT_EQ(compile_error({BYTECODE(End)}), Execute_error::Stack_out_of_bound);
+
+	// Loop growing the stack
+	EXPECT_EQ(
+		compile_error({BYTECODE(Const8, 1), BYTECODE(Dup), BYTECODE(Goto, 0x00, 0x02), BYTECODE(End)}),
+		Execute_error::Stack_out_of_bound
+	);
+}
+
+TEST(CompiledExpression, DivisionByZero)
+{
+	core::CPU_module cpu(0, std::make_shared<Word_memory>());
+
+	const std::array bytecode = std::to_array<u8>(
+		{BYTECODE(Const8, 1), BYTECODE(Reg, 0x00, 0x00), BYTECODE(Div_signed), BYTECODE(End)}
+	);
+
+	const auto result = run_compiled(cpu, bytecode);
+
+	ASSERT_FALSE(result.has_value());
+	EXPECT_EQ(result.error(), gdb_stub::expression::Execute_error::Division_by_zero);
+}
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include "gdb-stub/network.hpp"
+
+#include <thread>
+
+using namespace gdb_stub;
+
+TEST(Network, ReconnectAfterTruncatedPacket)
+{
+	constexpr u16 port = 23946;
+
+	asio::io_context io_context;
+	auto work = asio::make_work_guard(io_context);
+	std::jthread io_thread([&io_context] { io_context.run(); });
+
+	{
+		Network_handler handler(io_context, port);
+
+		asio::io_context client_context;
+		const asio::ip::tcp::endpoint endpoint(asio::ip::address_v4::loopback(), port);
+
+		// The first connection drops in the middle of a packet
+		asio::ip::tcp::socket first(client_context);
+		first.connect(endpoint);
+		asio::write(first, asio::buffer(std::string_view("$m0,4")));
+		first.close();
+
+		const auto dropped = handler.receive();
+		ASSERT_FALSE(dropped.has_value());
+		EXPECT_EQ(dropped.error(), Network_handler::Error::Connection_fault);
+
+		// The next connection isn't affected by the leftover
+		asio::ip::tcp::socket second(client_context);
+		second.connect(endpoint);
+		asio::write(second, asio::buffer(std::string_view("$g#67")));
+
+		const auto received = handler.receive();
+		ASSERT_TRUE(received.has_value());
+		EXPECT_TRUE(std::holds_alternative<command::Read_register>(*received));
+
+		// Acknowledged at once, without a NAK for the leftover
+		char ack = 0;
+		asio::read(second, asio::buffer(&ack, 1));
+		EXPECT_EQ(ack, '+');
+	}
+
+	work.reset();
+}
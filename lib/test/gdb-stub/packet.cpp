@@ -357,4 +357,73 @@ TEST(PacketEncode, Encoding)
 	EXPECT_EQ(encode_repeat(102), "$0*~0* #52");
 
 	EXPECT_EQ(encode("My favourite    number is 00001234"), "$My favourite * number is 0* 1234#0e");
-}
\ No newline at end of file
+
+	Packet_encoder encoder;
+	EXPECT_EQ(encoder.encode_buffered("Stop:S05", '%'), "%Stop:S05#98");
+}
+
+TEST(PacketDecode, BufferReuse)
+{
+	gdb_stub::Packet_decoder decoder;
+
+	// Packet split across pushes, with an escaped character
+	decoder.push("$Hel");
+	ASSERT_FALSE(decoder.new_packet_available());
+	decoder.push("lo}]#ce$Wor");
+
+	auto packet = decoder.pop_packet();
+	ASSERT_TRUE(packet.has_value());
+	EXPECT_EQ(packet.value(), "Hello}");
+	ASSERT_FALSE(decoder.new_packet_available());
+
+	// The partial packet is kept when the drained buffer is reused
+	decoder.push("ld#08+");
+
+	packet = decoder.pop_packet();
+	ASSERT_TRUE(packet.has_value());
+	EXPECT_EQ(packet.value(), "World");
+
+	packet = decoder.pop_packet();
+	ASSERT_TRUE(packet.has_value());
+	EXPECT_EQ(packet.value(), "+");
+
+	packet = decoder.pop_packet();
+	ASSERT_FALSE(packet.has_value());
+	EXPECT_EQ(packet.error(), gdb_stub::Packet_decoder::Error::No_new_packet);
+}
+
+TEST(PacketDecode, Reset)
+{
+	gdb_stub::Packet_decoder decoder;
+
+	// Unpopped packet, followed by a truncated one
+	decoder.push("+$m0,4");
+	ASSERT_TRUE(decoder.new_packet_available());
+
+	decoder.reset();
+	ASSERT_FALSE(decoder.new_packet_available());
+
+	// The next packet decodes as if the stream started anew
+	decoder.push("$g#67");
+
+	auto packet = decoder.pop_packet();
+	ASSERT_TRUE(packet.has_value());
+	EXPECT_EQ(packet.value(), "g");
+
+	packet = decoder.pop_packet();
+	ASSERT_FALSE(packet.has_value());
+	EXPECT_EQ(packet.error(), gdb_stub::Packet_decoder::Error::No_new_packet);
+}
+
+TEST(PacketEncode, EscapedRepeat)
+{
+	using namespace gdb_stub;
+
+	EXPECT_EQ(Packet_encoder::encode("##"), "$}\x03}\x03#00");
+	EXPECT_EQ(Packet_encoder::encode("$$$$"), "$}\x04* #cb");
+
+	// The output buffer is reused between packets
+	Packet_encoder encoder;
+	EXPECT_EQ(encoder.encode_buffered("0000"), "$0* #7a");
+	EXPECT_EQ(encoder.encode_buffered("OK"), "$OK#9a");
+}
@@ -92,6 +92,11 @@ TEST(ResponseGen, StopReason)
 		);
 		EXPECT_EQ(response.to_string(), "T05awatch:123;");
 	}
+
+	{
+		const auto response = Stop_reason(Stop_reason::History_begin{});
+		EXPECT_EQ(response.to_string(), "T05replaylog:begin;");
+	}
 }
 
 TEST(ResponseGen, Qxfer)
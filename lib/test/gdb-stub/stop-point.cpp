@@ -0,0 +1,27 @@
+#include <gtest/gtest.h>
+
+#include "gdb-stub/stop-point.hpp"
+
+TEST(WatchPageFilter, AddAndClear)
+{
+	gdb_stub::Watch_page_filter filter;
+	EXPECT_FALSE(filter.contains(0x8000'0000));
+
+	filter.add({.start = 0x8000'0ffc, .size = 8});
+	EXPECT_FALSE(filter.contains(0x7fff'fffc));
+	EXPECT_TRUE(filter.contains(0x8000'0000));
+	EXPECT_TRUE(filter.contains(0x8000'1ffc));
+	EXPECT_FALSE(filter.contains(0x8000'2000));
+
+	// Ranges reaching the end of the address space
+	filter.add({.start = 0xffff'fff0, .size = 0x100});
+	EXPECT_TRUE(filter.contains(0xffff'fffc));
+	EXPECT_FALSE(filter.contains(0x0000'0000));
+
+	filter.add({.start = 0x1000, .size = 0});
+	EXPECT_FALSE(filter.contains(0x1000));
+
+	filter.clear();
+	EXPECT_FALSE(filter.contains(0x8000'0000));
+	EXPECT_FALSE(filter.contains(0xffff'fffc));
+}
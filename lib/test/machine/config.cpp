@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <sstream>
+
+#include "machine/machine.hpp"
+
+namespace
+{
+	machine::Config parse(std::string_view text)
+	{
+		std::istringstream input{std::string(text)};
+		return machine::Config::parse_layout(input);
+	}
+}
+
+TEST(Config, ParseLayout)
+{
+	const auto config = parse(R"(
+# Comment
+reset-pc 0x2000
+
+rom    boot  base=0x2000      size=256K
+ram    sram  base=0x10000000  size=64K  fill=zero
+ram    ddr   base=0x80000000  size=1G
+clock  clk   base=0x1000      irq=7
+)");
+
+	EXPECT_EQ(config.reset_pc, 0x2000);
+	ASSERT_EQ(config.regions.size(), 4);
+
+	EXPECT_EQ(config.regions[0].type, machine::Region_config::Type::Rom);
+	EXPECT_EQ(config.regions[0].name, "boot");
+	EXPECT_EQ(config.regions[0].base, 0x2000);
+	EXPECT_EQ(config.regions[0].size, 256 * 1024);
+
+	EXPECT_EQ(config.regions[1].fill_policy, device::Fill_policy::Zero);
+	EXPECT_EQ(config.regions[2].size, 1ull << 30);
+	EXPECT_FALSE(config.regions[2].fill_policy.has_value());
+
+	EXPECT_EQ(config.regions[3].type, machine::Region_config::Type::Clock);
+	EXPECT_EQ(config.regions[3].base, 0x1000);
+}
+
+TEST(Config, ParseLayoutError)
+{
+	EXPECT_THROW(parse("flash f base=0"), std::invalid_argument);
+	EXPECT_THROW(parse("rom r size=1K"), std::invalid_argument);
+	EXPECT_THROW(parse("rom r base=0"), std::invalid_argument);
+	EXPECT_THROW(parse("rom r base=0 size=1Q"), std::invalid_argument);
+	EXPECT_THROW(parse("uart u base=0 size=1K"), std::invalid_argument);
+	EXPECT_THROW(parse("ram r base=0 size=1K fill=blue"), std::invalid_argument);
+	EXPECT_THROW(parse("reset-pc 0x100000000"), std::invalid_argument);
+
+	try
+	{
+		parse("# Comment\n\nrom r base=0x0 size=1K\nram r base\n");
+		FAIL() << "Expected std::invalid_argument";
+	}
+	catch (const std::invalid_argument& e)
+	{
+		EXPECT_TRUE(std::string_view(e.what()).starts_with("Layout line 4:")) << e.what();
+	}
+}
+
+TEST(Config, CustomLayout)
+{
+	auto config = parse(R"(
+reset-pc 0x1000
+rom          boot  base=0x1000        size=4K
+ram          sram  base=0x80000000    size=64K
+ram          ddr   base=0x40000000   size=1M
+sim-control  sim   base=0x20000
+)");
+	config.ram_fill_policy = device::Fill_policy::Zero;
+
+	// addi a0, zero, 42; lui t0, 0x80000; sw a0, 0(t0); j .
+	constexpr std::array<u32, 4> test_program = {0x02a00513, 0x800002b7, 0x00a2a023, 0x0000006f};
+
+	machine::Machine machine(config);
+	machine.load_flash({reinterpret_cast<const u8*>(test_program.data()), sizeof(test_program)});
+	machine.run(4);
+
+	EXPECT_EQ(machine.get_pc(), 0x100c);
+	EXPECT_EQ(machine.get_ram_count(), 2);
+	EXPECT_EQ(machine.get_ram(0).read(0), 42);
+
+	// Unmapped peripherals are unreachable
+	EXPECT_FALSE(machine.get_bus().read(0x0001'0000).has_value());
+
+	const auto xml = machine.generate_memory_map_xml();
+	EXPECT_NE(xml.find(R"(<memory type="rom" start="0x00001000" length="0x00001000"/>)"), std::string::npos);
+	EXPECT_NE(xml.find(R"(<memory type="ram" start="0x80000000" length="0x00010000"/>)"), std::string::npos);
+	EXPECT_NE(xml.find(R"(<memory type="rom" start="0x00020000" length="0x00000100"/>)"), std::string::npos);
+}
+
+TEST(Config, InvalidLayout)
+{
+	const auto create = [](std::string_view text)
+	{
+		return machine::Machine(parse(text));
+	};
+
+	EXPECT_THROW(create("ram r base=0 size=1K"), std::invalid_argument);
+	EXPECT_THROW(create("rom r base=0 size=1K"), std::invalid_argument);
+	EXPECT_THROW(create("rom r base=0 size=1K\nram m base=0x200 size=1K"), std::invalid_argument);
+	EXPECT_THROW(
+		create("rom r base=0 size=1K\nram m base=0x1000 size=1K\nuart a base=0x2000\nuart b base=0x3000"),
+		std::invalid_argument
+	);
+	EXPECT_THROW(
+		create("rom r base=0 size=1K\nram m base=0x1000 size=1K\nclock c base=0x2000 irq=32"),
+		std::invalid_argument
+	);
+	EXPECT_THROW(create("rom r base=0 size=1K\nram r base=0x1000 size=1K"), std::invalid_argument);
+	EXPECT_NO_THROW(create("rom r base=0 size=1K\nram m base=0x1000 size=1K"));
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#include "machine/history.hpp"
+
+#include <sstream>
+
+namespace
+{
+	// addi a0, zero, 0; addi a0, a0, 1; lui t0, 0x80000; sw a0, 0(t0); j -12
+	constexpr std::array<u32, 5> test_program = {0x00000513, 0x00150513, 0x800002b7, 0x00a2a023, 0xff5ff06f};
+
+	std::span<const u8> as_bytes(std::span<const u32> words)
+	{
+		return {reinterpret_cast<const u8*>(words.data()), words.size_bytes()};
+	}
+
+	machine::Machine create_machine()
+	{
+		auto machine = machine::Machine(machine::Config{.ram_fill_policy = device::Fill_policy::Zero});
+		machine.load_flash(as_bytes(test_program));
+		return machine;
+	}
+
+	void run(machine::Machine& machine, machine::History& history, u64 count)
+	{
+		for (u64 i = 0; i < count; i++)
+		{
+			history.record();
+			machine.step();
+		}
+	}
+
+	// lui t0, 0x10; loop: lw a0, 12(t0); andi a0, a0, 1; beqz a0, loop; lw a1, 4(t0); add a2, a2, a1; j loop
+	constexpr std::array<u32, 7> uart_program
+		= {0x000102b7, 0x00c2a503, 0x00157513, 0xfe050ce3, 0x0042a583, 0x00b60633, 0xfedff06f};
+
+	// PC, then a0 to a2
+	std::array<u32, 4> get_state(const machine::Machine& machine)
+	{
+		const auto pc = machine.get_pc();
+		return {pc, machine.get_register(10), machine.get_register(11), machine.get_register(12)};
+	}
+
+	u32 read_counter(machine::Machine& machine)
+	{
+		std::array<u8, 4> data;
+		EXPECT_TRUE(machine.read_memory(0x8000'0000, data).has_value());
+		return std::bit_cast<u32>(data);
+	}
+}
+
+TEST(History, StepBack)
+{
+	auto machine = create_machine();
+	machine::History history(machine, 3, 16);
+
+	run(machine, history, 21);
+	EXPECT_EQ(read_counter(machine), 5);
+	std::array<u32, 32> registers;
+	machine.get_registers(registers);
+
+	ASSERT_TRUE(history.step_back());
+	EXPECT_EQ(machine.get_inst_executed(), 20);
+	EXPECT_EQ(machine.get_pc(), 0x0010'0010);
+
+	// Steps back over a store
+	ASSERT_TRUE(history.step_back());
+	ASSERT_TRUE(history.step_back());
+	EXPECT_EQ(machine.get_inst_executed(), 18);
+	EXPECT_EQ(read_counter(machine), 4);
+
+	// Forward again reaches the same state
+	run(machine, history, 3);
+	std::array<u32, 32> replayed_registers;
+	machine.get_registers(replayed_registers);
+	EXPECT_EQ(replayed_registers, registers);
+	EXPECT_EQ(read_counter(machine), 5);
+
+	while (history.step_back());
+	EXPECT_EQ(machine.get_inst_executed(), 0);
+	EXPECT_EQ(machine.get_pc(), 0x0010'0000);
+	EXPECT_EQ(read_counter(machine), 0);
+}
+
+TEST(History, Capacity)
+{
+	auto machine = create_machine();
+	machine::History history(machine, 4, 2);
+
+	run(machine, history, 20);
+
+	// Checkpoints at 12 and 16 are kept
+	while (history.step_back());
+	EXPECT_EQ(machine.get_inst_executed(), 12);
+
+	history.clear();
+	EXPECT_FALSE(history.step_back());
+}
+
+TEST(History, ContinueBack)
+{
+	auto machine = create_machine();
+	machine::History history(machine, 5, 16);
+
+	run(machine, history, 30);
+	machine.add_breakpoint(0x0010'000c);
+
+	// Latest `sw` before the current position
+	ASSERT_TRUE(history.continue_back([](machine::Machine&) { return true; }));
+	EXPECT_EQ(machine.get_pc(), 0x0010'000c);
+	EXPECT_EQ(machine.get_inst_executed(), 27);
+
+	// Only hits where the condition is met
+	const auto is_triggered = [](machine::Machine& machine) { return machine.get_register(10) == 2; };
+	ASSERT_TRUE(history.continue_back(is_triggered));
+	EXPECT_EQ(machine.get_pc(), 0x0010'000c);
+	EXPECT_EQ(machine.get_register(10), 2);
+	EXPECT_EQ(machine.get_inst_executed(), 7);
+	EXPECT_EQ(read_counter(machine), 1);
+
+	EXPECT_FALSE(history.continue_back([](machine::Machine&) { return false; }));
+	EXPECT_EQ(machine.get_inst_executed(), 0);
+}
+
+TEST(History, UartInput)
+{
+	// Not exhausted by the run
+	std::string data;
+	for (int i = 0; i < 100; i++) data.push_back(static_cast<char>('A' + i % 26));
+	std::istringstream input(data);
+	auto machine = machine::Machine(machine::Config{.ram_fill_policy = device::Fill_policy::Zero});
+	machine.load_flash(as_bytes(uart_program));
+	machine.get_uart().set_input_stream(input);
+	machine::History history(machine, 16, 64);
+
+	// The status polls are random
+	std::vector<std::array<u32, 4>> states;
+	for (int i = 0; i < 200; i++)
+	{
+		states.push_back(get_state(machine));
+		history.record();
+		machine.step();
+	}
+	const auto final_state = get_state(machine);
+
+	// The replay reads the recorded inputs
+	for (int i = 0; i < 50; i++) ASSERT_TRUE(history.step_back());
+	EXPECT_EQ(get_state(machine), states[150]);
+
+	// So does the execution going forward over the recorded part
+	run(machine, history, 50);
+	EXPECT_EQ(get_state(machine), final_state);
+}
+
+TEST(History, HostFiles)
+{
+	machine::Machine machine(machine::Config{.host_file_root = "."});
+	EXPECT_THROW(machine::History(machine, 16, 64), std::invalid_argument);
+}
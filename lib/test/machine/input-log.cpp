@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include "machine/input-log.hpp"
+
+#include <sstream>
+
+namespace
+{
+	// lui t0, 0x10; lw a0, 4(t0); lw a1, 12(t0); lw a2, 12(t0); lw a3, 4(t0); lui t1, 0x80000; lw a4, 0(t1);
+	// j .
+	constexpr std::array<u32, 8> test_program
+		= {0x000102b7, 0x0042a503, 0x00c2a583, 0x00c2a603, 0x0042a683, 0x80000337, 0x00032703, 0x0000006f};
+
+	std::span<const u8> as_bytes(std::span<const u32> words)
+	{
+		return {reinterpret_cast<const u8*>(words.data()), words.size_bytes()};
+	}
+
+	std::unique_ptr<machine::Machine> create_machine(std::istream& uart_input)
+	{
+		auto machine = std::make_unique<machine::Machine>(
+			machine::Config{.ram_fill_policy = device::Fill_policy::Random}
+		);
+		machine->load_flash(as_bytes(test_program));
+		machine->get_uart().set_input_stream(uart_input);
+		return machine;
+	}
+
+	std::array<u32, 5> get_results(const machine::Machine& machine)
+	{
+		std::array<u32, 5> results;
+		for (u32 i = 0; i < results.size(); i++) results[i] = machine.get_register(10 + i);
+		return results;
+	}
+}
+
+TEST(InputLog, RecordReplay)
+{
+	std::istringstream recorded_input("AB");
+	auto recorded = create_machine(recorded_input);
+
+	machine::Input_log log;
+	log.record(*recorded);
+	recorded->run(test_program.size());
+
+	const auto results = get_results(*recorded);
+	EXPECT_EQ(results[0], 'A');
+	EXPECT_EQ(results[3], 'B');
+
+	std::stringstream file;
+	log.save(file);
+	auto loaded = machine::Input_log::load(file);
+	EXPECT_EQ(loaded.get_entries(), log.get_entries());
+
+	// Same inputs without the input stream, and the same RAM content
+	std::istringstream empty_input;
+	auto replayed = create_machine(empty_input);
+	loaded.replay(*replayed);
+	replayed->run(test_program.size());
+	EXPECT_EQ(get_results(*replayed), results);
+}
+
+TEST(InputLog, Diverged)
+{
+	std::istringstream input;
+	auto recorded = create_machine(input);
+
+	// Only the seeds are recorded
+	machine::Input_log log;
+	log.record(*recorded);
+
+	auto replayed = create_machine(input);
+	log.replay(*replayed);
+	EXPECT_THROW(replayed->run(test_program.size()), std::runtime_error);
+
+	std::istringstream invalid("RVIL");
+	EXPECT_THROW(machine::Input_log::load(invalid), std::runtime_error);
+}
@@ -0,0 +1,351 @@
+#include <gtest/gtest.h>
+
+#include "machine/machine.hpp"
+
+namespace
+{
+	// addi a0, zero, 42; lui t0, 0x80000; sw a0, 0(t0); j .
+	constexpr std::array<u32, 4> test_program = {0x02a00513, 0x800002b7, 0x00a2a023, 0x0000006f};
+
+	std::span<const u8> as_bytes(std::span<const u32> words)
+	{
+		return {reinterpret_cast<const u8*>(words.data()), words.size_bytes()};
+	}
+
+	machine::Machine create_machine()
+	{
+		return machine::Machine(machine::Config{.ram_fill_policy = device::Fill_policy::Zero});
+	}
+
+	bool is_infinite_loop(const machine::Machine::Result& result)
+	{
+		return !result.trap.has_value() && result.pc == result.alu_result && result.branch_result;
+	}
+}
+
+TEST(Machine, RunUntil)
+{
+	auto machine = create_machine();
+	machine.load_flash(as_bytes(test_program));
+
+	const auto result = machine.run_until(is_infinite_loop, 100);
+	ASSERT_TRUE(result.has_value());
+	EXPECT_EQ(result->pc, 0x0010'000c);
+	EXPECT_EQ(machine.get_inst_executed(), 4);
+	EXPECT_EQ(machine.get_register(10), 42);
+
+	std::array<u8, 4> data;
+	ASSERT_TRUE(machine.read_memory(0x8000'0000, data).has_value());
+	EXPECT_EQ(std::bit_cast<u32>(data), 42);
+
+	// Limit reached without satisfying the predicate
+	EXPECT_FALSE(machine.run_until([](const auto&) { return false; }, 10).has_value());
+	EXPECT_EQ(machine.get_inst_executed(), 14);
+
+	machine.reset();
+	EXPECT_EQ(machine.get_pc(), 0x0010'0000);
+	EXPECT_EQ(machine.get_register(10), 0);
+	EXPECT_EQ(machine.get_inst_executed(), 0);
+
+	machine.run(4);
+	EXPECT_EQ(machine.get_register(10), 42);
+}
+
+TEST(Machine, Registers)
+{
+	auto machine = create_machine();
+
+	std::array<u32, 32> input;
+	for (u32 i = 0; i < 32; i++) input[i] = i * 0x01010101;
+	machine.set_registers(input);
+
+	std::array<u32, 32> output;
+	machine.get_registers(output);
+	EXPECT_EQ(output[0], 0);
+	for (u32 i = 1; i < 32; i++) EXPECT_EQ(output[i], input[i]);
+
+	machine.set_register(0, 1234);
+	EXPECT_EQ(machine.get_register(0), 0);
+
+	machine.set_pc(0x8000'0000);
+	EXPECT_EQ(machine.get_pc(), 0x8000'0000);
+}
+
+TEST(Machine, BulkMemory)
+{
+	auto machine = create_machine();
+
+	const std::array<u8, 11> input = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+	ASSERT_TRUE(machine.write_memory(0x8000'0003, input).has_value());
+
+	std::array<u8, 11> output{};
+	ASSERT_TRUE(machine.read_memory(0x8000'0003, output).has_value());
+	EXPECT_EQ(input, output);
+
+	// Neighbouring bytes are untouched
+	std::array<u8, 16> whole;
+	ASSERT_TRUE(machine.read_memory(0x8000'0000, whole).has_value());
+	EXPECT_EQ(whole[2], 0);
+	EXPECT_EQ(whole[3], 1);
+	EXPECT_EQ(whole[13], 11);
+	EXPECT_EQ(whole[14], 0);
+
+	// Unmapped address
+	EXPECT_FALSE(machine.read_memory(0x4000'0000, output).has_value());
+
+	// ROM is read-only for the CPU, but writable by `load_image()`
+	EXPECT_FALSE(machine.write_memory(0x0010'0000, input).has_value());
+	EXPECT_NO_THROW(machine.load_image(0x0010'0000, as_bytes(test_program)));
+	machine.run(4);
+	EXPECT_EQ(machine.get_register(10), 42);
+}
+
+TEST(Machine, AttachDevice)
+{
+	auto machine = create_machine();
+
+	auto sram = std::make_shared<device::Block_memory>(64 * 1024, device::Fill_policy::Zero);
+	machine.attach_device("sram", 0x2000'0000, sram);
+
+	EXPECT_THROW(
+		machine.attach_device("overlap", 0x2000'fffc, std::make_shared<device::Block_memory>(16)),
+		std::invalid_argument
+	);
+	EXPECT_THROW(
+		machine.attach_device("overlap", 0x1fff'fffc, std::make_shared<device::Block_memory>(16)),
+		std::invalid_argument
+	);
+	EXPECT_NO_THROW(
+		machine.attach_device("adjacent", 0x2001'0000, std::make_shared<device::Block_memory>(16))
+	);
+
+	// Named like the main RAM, would be reported as RAM in the memory map
+	EXPECT_THROW(
+		machine.attach_device("ram", 0x3000'0000, std::make_shared<device::Block_memory>(16)),
+		std::invalid_argument
+	);
+
+	const std::array<u8, 4> input = {0xef, 0xbe, 0xad, 0xde};
+	ASSERT_TRUE(machine.write_memory(0x2000'0100, input).has_value());
+	EXPECT_EQ(sram->read(0x100).value_or(0), 0xdeadbeef);
+
+	const auto regions = machine.get_bus().get_regions();
+	EXPECT_TRUE(std::ranges::is_sorted(regions, {}, &machine::Bus::Region::base));
+}
+
+TEST(Machine, Hooks)
+{
+	auto machine = create_machine();
+	machine.load_flash(as_bytes(test_program));
+
+	std::vector<u32> pcs;
+	const auto handle = machine.add_instruction_hook(
+		[&pcs](machine::Machine&, const machine::Machine::Result& result) { pcs.push_back(result.pc); }
+	);
+
+	machine.run(3);
+	EXPECT_EQ(pcs, (std::vector<u32>{0x0010'0000, 0x0010'0004, 0x0010'0008}));
+
+	EXPECT_TRUE(machine.remove_hook(handle));
+	EXPECT_FALSE(machine.remove_hook(handle));
+
+	machine.run(3);
+	EXPECT_EQ(pcs.size(), 3);
+}
+
+TEST(Machine, SimControlExit)
+{
+	// addi a0, zero, 3; lui t0, 0x12; sw a0, 4(t0); addi a1, zero, 1; sw a1, 0(t0); j .
+	constexpr std::array<u32, 6> exit_program
+		= {0x00300513, 0x000122b7, 0x00a2a223, 0x00100593, 0x00b2a023, 0x0000006f};
+
+	auto machine = create_machine();
+	machine.load_flash(as_bytes(exit_program));
+
+	const auto result = machine.run_until(
+		[&machine](const auto&) { return machine.get_sim_control().get_exit_code().has_value(); },
+		100
+	);
+	ASSERT_TRUE(result.has_value());
+	EXPECT_EQ(result->pc, 0x0010'0010);
+	EXPECT_EQ(machine.get_sim_control().get_exit_code(), 3);
+
+	machine.reset();
+	EXPECT_FALSE(machine.get_sim_control().get_exit_code().has_value());
+}
+
+TEST(Machine, Snapshot)
+{
+	auto machine = create_machine();
+	machine.load_flash(as_bytes(test_program));
+	machine.set_register(10, 7);
+
+	const auto snapshot = machine.take_snapshot();
+
+	machine.run(4);
+	EXPECT_EQ(machine.get_register(10), 42);
+	EXPECT_EQ(machine.get_ram().used_space(), device::Block_memory::page_size_bytes);
+
+	machine.restore_snapshot(snapshot);
+	EXPECT_EQ(machine.get_pc(), 0x0010'0000);
+	EXPECT_EQ(machine.get_register(10), 7);
+	EXPECT_EQ(machine.get_inst_executed(), 0);
+	EXPECT_EQ(machine.get_ram().used_space(), 0);
+
+	machine.run(4);
+	EXPECT_EQ(machine.get_register(10), 42);
+}
+
+TEST(Machine, Coverage)
+{
+	std::array<u8, 1024> coverage_map{};
+
+	auto machine = create_machine();
+	machine.load_flash(as_bytes(test_program));
+	machine.set_coverage_map(coverage_map);
+
+	// Only `j .` is a control transfer, executed twice
+	machine.run(5);
+	EXPECT_EQ(std::ranges::fold_left(coverage_map, 0u, std::plus<>()), 2);
+
+	machine.set_coverage_map({});
+	machine.run(5);
+	EXPECT_EQ(std::ranges::fold_left(coverage_map, 0u, std::plus<>()), 2);
+}
+
+TEST(Machine, Breakpoint)
+{
+	auto machine = create_machine();
+	machine.load_flash(as_bytes(test_program));
+	machine.add_breakpoint(0x0010'0008);
+
+	// Stops in front of `sw` without executing it or taking the trap
+	const auto result = machine.run_until([](const auto& result) { return result.trap.has_value(); }, 10);
+	ASSERT_TRUE(result.has_value());
+	EXPECT_TRUE(machine.is_breakpoint_hit(*result));
+	EXPECT_EQ(machine.get_pc(), 0x0010'0008);
+	EXPECT_EQ(machine.get_inst_executed(), 2);
+	EXPECT_EQ(machine.get_cpu().csr.mepc.value, 0);
+
+	// Memory still holds the original instruction
+	std::array<u8, 4> data;
+	ASSERT_TRUE(machine.read_memory(0x0010'0008, data).has_value());
+	EXPECT_EQ(std::bit_cast<u32>(data), test_program[2]);
+
+	EXPECT_TRUE(machine.is_breakpoint_hit(machine.step()));
+	EXPECT_EQ(machine.get_pc(), 0x0010'0008);
+
+	// Kept across reset
+	machine.reset();
+	machine.run(2);
+	EXPECT_TRUE(machine.is_breakpoint_hit(machine.step()));
+
+	EXPECT_TRUE(machine.remove_breakpoint(0x0010'0008));
+	EXPECT_FALSE(machine.remove_breakpoint(0x0010'0008));
+	EXPECT_FALSE(machine.step().trap.has_value());
+	EXPECT_EQ(machine.get_pc(), 0x0010'000c);
+
+	// `ebreak` of the guest takes the trap
+	constexpr std::array<u32, 1> ebreak_program = {0x00100073};
+	machine.load_flash(as_bytes(ebreak_program));
+	machine.reset();
+
+	const auto ebreak_result = machine.step();
+	EXPECT_EQ(ebreak_result.trap, core::Trap::Breakpoint);
+	EXPECT_FALSE(machine.is_breakpoint_hit(ebreak_result));
+	EXPECT_EQ(machine.get_cpu().csr.mepc.value, 0x0010'0000);
+	EXPECT_EQ(machine.get_cpu().csr.mcause.exception_code, 3);
+}
+
+TEST(Machine, BreakpointPages)
+{
+	auto machine = create_machine();
+	machine.load_flash(as_bytes(test_program));
+
+	// Copy of the program on another page, reached by a jump
+	constexpr std::array<u32, 5> ram_program = {0x02a00513, 0x800002b7, 0x00a2a023, 0x0000006f, 0};
+	ASSERT_TRUE(machine.write_memory(0x8000'1000, as_bytes(ram_program)).has_value());
+
+	machine.add_breakpoint(0x0010'0004);
+	machine.add_breakpoint(0x0010'0008);
+	machine.add_breakpoint(0x8000'100c);
+
+	EXPECT_FALSE(machine.is_breakpoint_hit(machine.step()));
+	EXPECT_TRUE(machine.is_breakpoint_hit(machine.step()));
+	EXPECT_EQ(machine.get_pc(), 0x0010'0004);
+
+	// Other breakpoints of the page are kept
+	EXPECT_TRUE(machine.remove_breakpoint(0x0010'0004));
+	EXPECT_FALSE(machine.is_breakpoint_hit(machine.step()));
+	EXPECT_TRUE(machine.is_breakpoint_hit(machine.step()));
+	EXPECT_EQ(machine.get_pc(), 0x0010'0008);
+
+	machine.set_pc(0x8000'1000);
+	machine.run(3);
+	EXPECT_TRUE(machine.is_breakpoint_hit(machine.step()));
+	EXPECT_EQ(machine.get_pc(), 0x8000'100c);
+}
+
+TEST(Machine, StepOverBreakpoint)
+{
+	auto machine = create_machine();
+	machine.load_flash(as_bytes(test_program));
+	machine.add_breakpoint(0x0010'0008);
+
+	machine.run(2);
+	EXPECT_TRUE(machine.is_breakpoint_hit(machine.step()));
+
+	// Runs the original `sw` and keeps the cached page
+	const auto& page = machine.get_cpu().inst_fetch.cache[0x100];
+	ASSERT_TRUE(page.valid);
+	EXPECT_FALSE(machine.step_over_breakpoint().trap.has_value());
+	EXPECT_TRUE(page.valid);
+	EXPECT_EQ(machine.get_pc(), 0x0010'000c);
+	EXPECT_EQ(machine.get_inst_executed(), 3);
+
+	std::array<u8, 4> data;
+	ASSERT_TRUE(machine.read_memory(0x8000'0000, data).has_value());
+	EXPECT_EQ(std::bit_cast<u32>(data), 42);
+
+	// Still hit on the next pass
+	machine.set_pc(0x0010'0008);
+	EXPECT_TRUE(machine.is_breakpoint_hit(machine.step()));
+
+	// `ebreak` of the guest under a breakpoint takes the trap
+	constexpr std::array<u32, 1> ebreak_program = {0x00100073};
+	machine.load_flash(as_bytes(ebreak_program));
+	machine.add_breakpoint(0x0010'0000);
+	machine.reset();
+
+	EXPECT_TRUE(machine.is_breakpoint_hit(machine.step()));
+	EXPECT_EQ(machine.step_over_breakpoint().trap, core::Trap::Breakpoint);
+	EXPECT_EQ(machine.get_cpu().csr.mcause.exception_code, 3);
+}
+
+TEST(Machine, ClockInterruptLine)
+{
+	// Clock on the machine software interrupt line
+	machine::Config config{.ram_fill_policy = device::Fill_policy::Zero};
+	for (auto& region : config.regions)
+		if (region.type == machine::Region_config::Type::Clock) region.irq = 3;
+
+	// lui t0, 0x100; addi t0, t0, 0x40; csrw mtvec, t0; li t1, 8; csrw mie, t1; csrsi mstatus, 8; j .
+	// Trap handler at 0x40: csrr a0, mcause; j .
+	std::array<u32, 18> program
+		= {0x001002b7, 0x04028293, 0x30529073, 0x00800313, 0x30431073, 0x30046073, 0x0000006f};
+	program[16] = 0x34202573;
+	program[17] = 0x0000006f;
+
+	machine::Machine machine(config);
+	machine.load_flash(as_bytes(program));
+
+	for (int i = 0; i < 2; i++)
+	{
+		machine.run(20);
+		EXPECT_EQ(machine.get_pc(), 0x0010'0044);
+		EXPECT_EQ(machine.get_register(10), 0x8000'0003);
+
+		// The line is kept by a reset
+		machine.reset();
+	}
+}
@@ -0,0 +1 @@
+generate_tests("machine")
\ No newline at end of file
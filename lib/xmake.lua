@@ -34,4 +34,14 @@ target("gdb-stub")
 	add_files("gdb-stub/gdb-xml/*.xml")
 	add_headerfiles("include/gdb-stub/**.hpp")
 	add_deps("core")
-	add_packages("asio", {public=true})
\ No newline at end of file
+	add_packages("asio", {public=true})
+
+target("machine")
+
+	set_kind("static")
+	set_languages("c++23", {public=true})
+
+	add_includedirs("include", {public=true})
+	add_headerfiles("include/machine/**.hpp")
+	add_files("machine/**.cpp")
+	add_deps("core", "device")
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "gdb-stub/server.hpp"
+#include "option.hpp"
+
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Runs a fixed set of jobs on a pool of threads with work stealing
+ * @note Every thread owns a deque of job indices and takes jobs from its front. When a thread runs out of
+ * jobs, it steals from the back of the other deques, so long jobs don't leave the other threads idle.
+ */
+class Work_stealing_executor
+{
+  public:
+
+	/**
+	 * @brief Construct a new `Work_stealing_executor`
+	 *
+	 * @param thread_count Number of worker threads, `0` for the number of hardware threads
+	 */
+	Work_stealing_executor(size_t thread_count);
+
+	/**
+	 * @brief Run `job(0)` ... `job(job_count - 1)` and wait for all of them to finish
+	 *
+	 * @param job_count Number of jobs
+	 * @param job Job function, must be thread-safe and must not throw
+	 */
+	void run(size_t job_count, const std::function<void(size_t)>& job);
+
+	size_t get_thread_count() const noexcept { return thread_count; }
+
+  private:
+
+	struct Job_queue
+	{
+		std::mutex mutex;
+		std::deque<size_t> jobs;
+	};
+
+	size_t thread_count;
+
+	// Pop a job from the front of the own queue, or steal one from the back of the others'
+	std::optional<size_t> take_job(std::vector<Job_queue>& queues, size_t self);
+};
+
+/**
+ * @brief Headless batch runner, runs many firmware tests in one process
+ *
+ * @note Manifest format: one test per line, empty lines and lines starting with `#` are ignored.
+ * ```
+ * <name> --flash=<path> [--fill=<policy>] [--trap=<mode>] [--max-inst=<n>] [--expect-exit=<code>]
+ *        [--expect-uart=<path>]
+ * ```
+ * - Relative paths are relative to the directory of the manifest
+ * - A test passes when the emulator stops at an infinite loop (e.g. `j .`) or the guest exits through the
+ *   sim control device, the exit code equals `--expect-exit` (if given), and the UART output equals the
+ *   content of the `--expect-uart` file (if given)
+ * - The exit code is the one requested through the sim control device, or `a0` at an infinite loop. A
+ *   non-zero sim control exit code fails the test if `--expect-exit` is not given.
+ * - `--max-inst` defaults to the value given on the command line
+ * - With `--record=<dir>` or `--replay=<dir>`, the input log of each test is `<dir>/<name>.rvil`. Logs are
+ *   saved whether the test passes or not.
+ * - With `--debug`, test `i` (in manifest order, from 0) listens for GDB on port `--remote-port + i`
+ *   while running. Attaching stops the test and hands it over to GDB, the test then fails.
+ */
+class Batch_runner
+{
+  public:
+
+	/**
+	 * @brief A single test described by the manifest
+	 *
+	 */
+	struct Test_case
+	{
+		std::string name;
+		size_t line;  // Line number in the manifest
+		Options options;
+		std::optional<u32> expected_exit_code;
+		std::optional<std::string> expected_uart_output;
+	};
+
+	/**
+	 * @brief Outcome of a single test
+	 *
+	 */
+	struct Test_result
+	{
+		bool passed = false;
+		std::string message;  // Reason of failure, empty if passed
+		u64 inst_executed = 0;
+		double seconds = 0;
+	};
+
+	/**
+	 * @brief Create a batch runner from options
+	 *
+	 * @param options Options, `batch_manifest_path` must be set
+	 * @return Created batch runner
+	 *
+	 * @throws std::runtime_error If the manifest or an expected output file can't be read
+	 * @throws std::invalid_argument If the manifest is malformed, or has duplicated test names while
+	 * recording or replaying
+	 */
+	static Batch_runner create(const Options& options);
+
+	/**
+	 * @brief Run all tests, print their results and a summary to `stdout`
+	 *
+	 * @return `true` if all tests passed
+	 */
+	bool run();
+
+  private:
+
+	std::vector<Test_case> tests;
+	u32 jobs;
+	bool enable_debug;
+
+	static Test_case parse_line(
+		const std::string& line,
+		size_t line_number,
+		const std::filesystem::path& base_dir,
+		const Options& defaults
+	);
+
+	/**
+	 * @brief Run a single test
+	 *
+	 * @param test Test to run
+	 * @param server Server for GDB to attach to the test, `nullptr` if debugging is disabled
+	 * @return Outcome of the test
+	 */
+	static Test_result run_test(const Test_case& test, gdb_stub::Debug_server* server);
+};
@@ -1,6 +1,14 @@
 #pragma once
 
 #include "emulator.hpp"
+#include "gdb-stub/server.hpp"
+#include "machine/history.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stop_token>
+#include <thread>
 
 /**
  * @brief Debug extension for emulator with GDB stub
@@ -15,8 +23,9 @@ class Emulator_debug : public Emulator
 	 *
 	 * @param emu Original emulator
 	 * @param options Options
+	 * @param server Server listening on `options.debug_port`, must outlive the emulator
 	 */
-	Emulator_debug(Emulator&& emu, const Options& options);
+	Emulator_debug(Emulator&& emu, const Options& options, gdb_stub::Debug_server& server);
 
 	/**
 	 * @brief Run the emulator with GDB stub enabled
@@ -24,20 +33,37 @@ class Emulator_debug : public Emulator
 	 */
 	void run();
 
+	/**
+	 * @brief Run the emulator without waiting for GDB, and hand over to GDB if it connects
+	 * @note The connection is checked every `interrupt_check_interval` instructions. After GDB connects,
+	 * the emulator is debugged as in `run()` until GDB kills it.
+	 *
+	 * @return Why the emulator stopped, `Stop_info::Reason::Interrupted` if GDB connected
+	 */
+	Stop_info run_until_stop_or_attach();
+
   private:
 
 	std::unique_ptr<gdb_stub::Network_handler> network;                   // Main network handler
-	std::map<u32, gdb_stub::Hw_breakpoint> hw_breakpoints;                // Map of hardware breakpoints
+	std::map<u32, gdb_stub::Breakpoint> hw_breakpoints;                   // Map of hardware breakpoints
+	std::map<u32, gdb_stub::Breakpoint> sw_breakpoints;                   // Map of software breakpoints
 	std::map<gdb_stub::Address_range, gdb_stub::Watchpoint> watchpoints;  // Map of watchpoints
+	gdb_stub::Watch_page_filter watch_pages;                              // Pages covered by `watchpoints`
+	std::vector<u8> memory_map_xml;                                       // Generated from the layout
+	std::vector<u16> register_numbers;                                    // Registers sent for `g`
+	std::vector<std::optional<u32>> register_buffer;                      // Reused by `handle_reg_read()`
+	std::vector<u8> memory_buffer;                                        // Reused by `handle_mem_read()`
+	std::optional<machine::History> history;                              // Empty if reverse debugging is off
 
 	/*===== CHECK TRAP =====*/
 
 	/**
-	 * @brief Check if breakpoint is hit
+	 * @brief Check if a breakpoint at the current PC is hit, evaluating its condition
+	 * @note Only called when the machine stops on a breakpoint, see `machine::Machine::add_breakpoint()`
 	 *
-	 * @return `true` if hit, `false` otherwise
+	 * @return Hit breakpoint if hit, `std::nullopt` otherwise
 	 */
-	bool check_breakpoint();
+	std::optional<gdb_stub::response::Stop_reason::Breakpoint_hit> check_breakpoint();
 
 	/**
 	 * @brief Check if watchpoint is hit
@@ -48,8 +74,34 @@ class Emulator_debug : public Emulator
 	 */
 	std::optional<std::pair<bool, bool>> check_watchpoint(const core::CPU_module::Result& result);
 
+	/**
+	 * @brief Rebuild `watch_pages` after `watchpoints` changed
+	 *
+	 */
+	void update_watch_pages();
+
 	/*===== RUN FUNCTIONS =====*/
 
+	/**
+	 * @brief Execute one instruction, stopping on breakpoints
+	 *
+	 * @param resume `true` for the first instruction after resuming, which steps over a breakpoint at the
+	 * current PC instead of stopping on it again
+	 * @return Result of the instruction, or the hit breakpoint. Breakpoints whose condition is not met are
+	 * stepped over.
+	 */
+	std::expected<core::CPU_module::Result, gdb_stub::response::Stop_reason::Breakpoint_hit> step(
+		bool resume
+	);
+
+	/**
+	 * @brief Execute one instruction with `step()`, and check watchpoints
+	 *
+	 * @param resume See `step()`
+	 * @return Stop reason if a breakpoint or watchpoint is hit, `std::nullopt` otherwise
+	 */
+	std::optional<gdb_stub::response::Stop_reason> step_and_check(bool resume);
+
 	/**
 	 * @brief Run until a trap is hit (breakpoint, watchpoint, exception, ecall, ebreak) or interrupted
 	 *
@@ -68,67 +120,151 @@ class Emulator_debug : public Emulator
 	gdb_stub::response::Stop_reason run_steps(size_t cycle_count, const std::atomic<bool>& interrupt);
 
 	/**
-	 * @brief Run the given run function asynchronously, until it returns
-	 * @details This function creates a separate thread to run the given function, and handles incoming GDB
-	 * interrupt signals in the main thread. It also sends the response to the GDB host.
-	 * @param run_func
+	 * @brief Step at least once, and until PC leaves `[start, end)`. May return early if interrupted.
+	 *
+	 * @param start Start of the range
+	 * @param end End of the range, exclusive
+	 * @param interrupt Interrupt signal flag
+	 * @return Resulted stop reason
+	 */
+	gdb_stub::response::Stop_reason run_range_step(u32 start, u32 end, const std::atomic<bool>& interrupt);
+
+	/**
+	 * @brief Safe point of the run functions, between two instructions
+	 * @details Parks the execution thread while `pause_run()` holds it
+	 *
+	 * @param interrupt Interrupt signal flag
+	 * @return `true` if the run function should return because of an interrupt
+	 */
+	bool poll_safe_point(const std::atomic<bool>& interrupt);
+
+	using Run_function = std::function<gdb_stub::response::Stop_reason(const std::atomic<bool>&)>;
+
+	/**
+	 * @brief Run the given run function on the execution thread, until it returns
+	 * @details Handles incoming GDB interrupt signals in the calling thread while the function runs, and
+	 * sends the stop reason to the GDB host as soon as it returns. In non-stop mode, replies `OK` and
+	 * returns at once instead, see `run()`. If GDB disconnects meanwhile, the run is stopped, and the next
+	 * connection finds the target stopped.
+	 * @param run_func Function to run, receives the interrupt flag
+	 */
+	void async_run(const Run_function& run_func);
+
+	/**
+	 * @brief Wait until the run function started by `async_run()` returns
+	 *
+	 */
+	gdb_stub::response::Stop_reason wait_run_result();
+
+	/**
+	 * @brief Park the running execution thread at its next safe point, so that the machine can be accessed
+	 * @note Returns at once if the run function has already returned. Each call must be followed by
+	 * `resume_run()`.
+	 */
+	void pause_run();
+
+	/**
+	 * @brief Release the execution thread parked by `pause_run()`
+	 *
+	 */
+	void resume_run();
+
+	/**
+	 * @brief Interrupt the run started in non-stop mode, and wait for it to return
+	 * @note The stop is not reported to GDB
+	 */
+	void stop_run();
+
+	/**
+	 * @brief Send the `%Stop` notification if the run started in non-stop mode has returned
+	 *
 	 */
-	void async_run(const std::function<gdb_stub::response::Stop_reason(const std::atomic<bool>&)>& run_func);
+	void report_run_stop();
+
+	/**
+	 * @brief Body of the execution thread, runs `pending_run` whenever one is set
+	 *
+	 */
+	void execution_thread_main(std::stop_token stop_token);
 
 	/*===== COMMAND HANDLING =====*/
 	// This section contains handlers for GDB commands
 	// See https://sourceware.org/gdb/current/onlinedocs/gdb.html/Packets.html
 
 	// `qSupported` Command
-	void handle_qsupport(const std::any& command);
+	void handle_qsupport(const gdb_stub::command::Query_supported& command);
+
+	// `QStartNoAckMode` Command
+	void handle_start_no_ack_mode(const gdb_stub::command::Start_no_ack_mode& command);
 
 	// `qXfer:feature:read` Command
-	void handle_qxfer_feature(const std::any& command);
+	void handle_qxfer_feature(const gdb_stub::command::Read_feature_xml& command);
 
 	// `qXfer:memory-map:read` Command
-	void handle_qxfer_memory_map(const std::any& command);
+	void handle_qxfer_memory_map(const gdb_stub::command::Read_memory_map_xml& command);
 
 	// `?` Command
-	void handle_query(const std::any& command);
+	void handle_query(const gdb_stub::command::Ask_halt_reason& command);
 
 	// `m` Command
-	void handle_mem_read(const std::any& command);
+	void handle_mem_read(const gdb_stub::command::Read_memory& command);
 
 	// `M` Command
-	void handle_mem_write(const std::any& command);
+	void handle_mem_write(const gdb_stub::command::Write_memory& command);
 
 	// `g` Command
-	void handle_reg_read(const std::any& command);
+	void handle_reg_read(const gdb_stub::command::Read_register& command);
 
 	// `G` Command
-	void handle_reg_write(const std::any& command);
+	void handle_reg_write(const gdb_stub::command::Write_register& command);
 
 	// `p` Command
-	void handle_single_reg_read(const std::any& command);
+	void handle_single_reg_read(const gdb_stub::command::Read_single_register& command);
 
 	// `P` Command
-	void handle_single_reg_write(const std::any& command);
+	void handle_single_reg_write(const gdb_stub::command::Write_single_register& command);
 
-	// `Z0/1` Command, currently only supports hardware breakpoints
-	void handle_add_breakpoint(const std::any& command);
+	// `Z0/1` Command
+	void handle_add_breakpoint(const gdb_stub::command::Add_breakpoint& command);
 
-	// `z0/1` Command, currently only supports hardware breakpoints
-	void handle_remove_breakpoint(const std::any& command);
+	// `z0/1` Command
+	void handle_remove_breakpoint(const gdb_stub::command::Remove_breakpoint& command);
 
 	// `Z2/3/4` Command
-	void handle_add_watchpoint(const std::any& command);
+	void handle_add_watchpoint(const gdb_stub::command::Add_watchpoint& command);
 
 	// `z2/3/4` Command
-	void handle_remove_watchpoint(const std::any& command);
+	void handle_remove_watchpoint(const gdb_stub::command::Remove_watchpoint& command);
 
 	// `c` Command
-	void handle_continue(const std::any& command);
+	void handle_continue(const gdb_stub::command::Continue& command);
 
 	// `s` Command
-	void handle_step(const std::any& command);
+	void handle_step(const gdb_stub::command::Step_single_inst& command);
 
 	// `i` Command
-	void handle_step_single_cycles(const std::any& command);
+	void handle_step_single_cycles(const gdb_stub::command::Step_cycles& command);
+
+	// `bs` Command
+	void handle_reverse_step(const gdb_stub::command::Reverse_step& command);
+
+	// `bc` Command
+	void handle_reverse_continue(const gdb_stub::command::Reverse_continue& command);
+
+	// `vCont?` Command
+	void handle_vcont_query(const gdb_stub::command::Query_vcont& command);
+
+	// `vCont` Command
+	void handle_vcont(const gdb_stub::command::Vcont& command);
+
+	// `vCtrlC` Command
+	void handle_interrupt_request(const gdb_stub::command::Interrupt_request& command);
+
+	// `QNonStop` Command
+	void handle_set_non_stop(const gdb_stub::command::Set_non_stop& command);
+
+	// `vStopped` Command
+	void handle_ack_stop_notification(const gdb_stub::command::Ack_stop_notification& command);
 
 	enum class Special_command_handle_result
 	{
@@ -143,13 +279,33 @@ class Emulator_debug : public Emulator
 	 * @param command Command input
 	 * @return See `Special_command_handle_result`
 	 */
-	Special_command_handle_result handle_special_commands(const std::any& command);
+	Special_command_handle_result handle_special_commands(const gdb_stub::command::Command& command);
+
+	/**
+	 * @brief Call the handler of a command
+	 *
+	 * @param command Command input
+	 * @return `true` if the command has a handler, `false` otherwise
+	 */
+	bool dispatch_command(const gdb_stub::command::Command& command);
+
+	/**
+	 * @brief Handle a command received while a run is in progress in non-stop mode
+	 * @details Handles the commands that control the run. The other commands are left to `handle_command()`,
+	 * at a safe point of the run.
+	 *
+	 * @param command Command input
+	 * @return `true` if the command is handled
+	 */
+	bool handle_running_command(const gdb_stub::command::Command& command);
 
 	/**
-	 * @brief Table that stores the mapping between command types and their handlers
+	 * @brief Handle a command, see `dispatch_command()` and `handle_special_commands()`
 	 *
+	 * @param command Command input
+	 * @return `false` if the emulator should stop
 	 */
-	const std::map<const std::type_info*, std::function<void(const std::any& command)>> command_handlers;
+	bool handle_command(const gdb_stub::command::Command& command);
 
 	/*===== AUXILIARY FUNCTIONS =====*/
 
@@ -159,4 +315,30 @@ class Emulator_debug : public Emulator
 	 * @param response Respons object
 	 */
 	void send_response(const gdb_stub::Response& response);
+
+	/**
+	 * @brief Discard the execution history, after the state is changed by GDB
+	 *
+	 */
+	void clear_history();
+
+	/*===== NON-STOP MODE =====*/
+	// Only accessed by the network thread
+
+	bool non_stop = false;        // Set by `QNonStop`
+	bool running = false;         // A run started in non-stop mode hasn't been reported yet
+	bool stop_requested = false;  // The run is stopped by `vCont;t`, reported with signal 0
+
+	/*===== EXECUTION THREAD =====*/
+	// The machine is only accessed by the execution thread between `pending_run` being set and `run_result`
+	// being set, and by the network thread otherwise or while the execution thread is parked
+
+	std::mutex run_mutex;
+	std::condition_variable_any run_condition;                    // Notified when any field below is set
+	Run_function pending_run;                                     // Set by `async_run()`
+	std::optional<gdb_stub::response::Stop_reason> run_result;    // Set when `pending_run` returns
+	std::atomic<bool> run_interrupt = false;                      // Interrupt flag of the running function
+	std::atomic<bool> run_pause = false;                          // Set by `pause_run()`
+	bool run_paused = false;                                      // Execution thread parked at a safe point
+	std::jthread execution_thread;                                // Declared last, stopped first
 };
\ No newline at end of file
@@ -3,9 +3,11 @@
 #include "core/cpu.hpp"
 #include "gdb-stub/network.hpp"
 #include "gdb-stub/stop-point.hpp"
+#include "machine/input-log.hpp"
+#include "machine/machine.hpp"
 #include "option.hpp"
-#include "platform.hpp"
 
+#include <functional>
 #include <map>
 #include <set>
 
@@ -23,24 +25,79 @@ class Emulator
 	 * @param options Options
 	 * @return Created Emulator
 	 *
-	 * @throws std::runtime_error If failed to read flash file
+	 * @throws std::runtime_error If failed to read flash file, layout file or input log
+	 * @throws std::invalid_argument If the layout is invalid
 	 */
 	static Emulator create(const Options& options);
 
+	/**
+	 * @brief Describes why `run_until_stop()` returned
+	 *
+	 */
+	struct Stop_info
+	{
+		enum class Reason
+		{
+			Infinite_loop,      // Infinite loop detected, e.g. `j .`
+			Trap_captured,      // Trap captured according to the trap capture mode
+			Instruction_limit,  // Maximum instruction count reached
+			Sim_exit,           // Guest requested exit through the sim control device
+			Interrupted         // `interrupted` passed to `run_until_stop()` returned `true`
+		};
+
+		Reason reason;
+		core::CPU_module::Result last_result;  // Result of the last executed instruction
+		std::optional<u32> exit_code;          // Exit code requested by the guest, if `Reason::Sim_exit`
+	};
+
 	/**
 	 * @brief Run the emulator, no debugging
+	 * @note Prints the stop reason, the number of executed instructions and the host execution speed when
+	 * stopped. Saves the input log when recording.
 	 *
+	 * @return Exit code requested by the guest through the sim control device, `0` if none
 	 */
-	void run();
+	int run();
+
+	/**
+	 * @brief Run the emulator silently until a stop condition is met
+	 *
+	 * @param interrupted Checked every `interrupt_check_interval` instructions if not empty, stops the run
+	 * when it returns `true`
+	 * @return Why the emulator stopped
+	 */
+	Stop_info run_until_stop(const std::function<bool()>& interrupted = {});
+
+	static constexpr u64 interrupt_check_interval = 65536;
+
+	/**
+	 * @brief Redirect UART input and output of the platform
+	 * @note Also redirects the console output of the sim control device
+	 *
+	 * @param input UART RX source
+	 * @param output UART TX and sim control console destination
+	 */
+	void set_uart_streams(std::istream& input, std::ostream& output);
+
+	/**
+	 * @brief Save the recorded input log to the path of `Options::record_file_path`
+	 * @note Does nothing if not recording
+	 *
+	 * @throws std::runtime_error If the file can't be written
+	 */
+	void save_input_log() const;
+
+	const machine::Machine& get_machine() const noexcept { return *machine; }
+	u64 get_inst_executed() const noexcept { return machine->get_inst_executed(); }
 
   protected:
 
-	std::unique_ptr<Platform> platform;
-	u64 inst_executed = 0;
+	std::unique_ptr<machine::Machine> machine;
 
 	Options::Trap_capture_mode trap_capture_mode;
 	bool stop_at_infinite_loop;
+	std::optional<u64> max_instructions;
 
-	// Tick one cycle of the CPU
-	core::CPU_module::Result tick_one_cycle();
+	std::unique_ptr<machine::Input_log> input_log;  // Recorded or replayed, if any
+	std::string record_file_path;                   // Where to save `input_log` when recording
 };
@@ -1,10 +0,0 @@
-#pragma once
-
-#include <cstdint>
-#include <vector>
-
-/**
- * @brief XML description of the memory map
- *
- */
-extern const std::vector<uint8_t> memory_map_xml;
\ No newline at end of file
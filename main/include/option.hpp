@@ -1,6 +1,8 @@
 #pragma once
 
 #include "device/block-memory.hpp"
+
+#include <optional>
 #include <string>
 
 /**
@@ -25,11 +27,23 @@ struct Options
 	std::string flash_file_path;
 
 	/**
-	 * @brief Fill policy of main RAM
+	 * @brief Path to the platform layout file, see `machine::Config::parse_layout()`
+	 * @note The standard platform is used if empty
+	 */
+	std::string layout_file_path;
+
+	/**
+	 * @brief Fill policy of RAM regions, unless overridden in the layout file
 	 * @note To emulate DDR, use `device::Fill_policy::Random`
 	 */
 	device::Fill_policy ram_fill_policy;
 
+	/**
+	 * @brief Root directory of host files accessible to the guest through the sim control device
+	 * @note Host file access is disabled if empty
+	 */
+	std::string host_file_root;
+
 	/* Simulation Settings */
 
 	/**
@@ -46,6 +60,25 @@ struct Options
 	 */
 	bool stop_at_infinite_loop = true;
 
+	/**
+	 * @brief Stop the emulator after executing this many instructions
+	 * @note No limit if not set
+	 */
+	std::optional<u64> max_instructions;
+
+	/**
+	 * @brief Path of the file to record the nondeterministic inputs into, see `machine::Input_log`
+	 * @note Not recorded if empty. In batch mode, the directory of the logs of the tests.
+	 */
+	std::string record_file_path;
+
+	/**
+	 * @brief Path of an input log to replay, instead of reading the nondeterministic inputs
+	 * @note Reads the inputs if empty. Exclusive with `record_file_path`. In batch mode, the directory of the
+	 * logs of the tests.
+	 */
+	std::string replay_file_path;
+
 	/* Debug Settings */
 
 	/**
@@ -60,7 +93,48 @@ struct Options
 	 */
 	u16 debug_port = 16355;
 
+	/**
+	 * @brief Number of instructions between checkpoints of the execution history, for reverse debugging
+	 * @note `0` disables reverse debugging. A shorter interval makes going back faster, but uses more
+	 * memory.
+	 */
+	u64 checkpoint_interval = 1'000'000;
+
+	/**
+	 * @brief Maximum number of checkpoints kept, the oldest ones are dropped
+	 *
+	 */
+	u32 checkpoint_count = 256;
+
+	/* Batch Settings */
+
+	/**
+	 * @brief Path to the batch manifest. Runs in headless batch mode when not empty.
+	 * @note See `Batch_runner` for the manifest format
+	 */
+	std::string batch_manifest_path;
+
+	/**
+	 * @brief Number of worker threads in batch mode
+	 * @note `0` uses the number of hardware threads
+	 */
+	u32 batch_jobs = 0;
+
 	/* Parse Methods */
 
 	static Options parse_args(int argc, char* argv[]);
+
+	/**
+	 * @brief Parse name of a fill policy, as used by `--fill`
+	 *
+	 * @throws std::invalid_argument If the name is invalid
+	 */
+	static device::Fill_policy parse_fill_policy(const std::string& name);
+
+	/**
+	 * @brief Parse name of a trap capture mode, as used by `--trap`
+	 *
+	 * @throws std::invalid_argument If the name is invalid
+	 */
+	static Trap_capture_mode parse_trap_capture_mode(const std::string& name);
 };
@@ -0,0 +1,379 @@
+#include "batch.hpp"
+#include "core/print.hpp"
+#include "emulator-debug.hpp"
+
+#include <argparse/argparse.hpp>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <thread>
+
+/* Work_stealing_executor */
+
+Work_stealing_executor::Work_stealing_executor(size_t thread_count) :
+	thread_count(thread_count != 0 ? thread_count : std::max(1u, std::thread::hardware_concurrency()))
+{}
+
+std::optional<size_t> Work_stealing_executor::take_job(std::vector<Job_queue>& queues, size_t self)
+{
+	{
+		std::lock_guard lock(queues[self].mutex);
+		if (!queues[self].jobs.empty())
+		{
+			const auto job = queues[self].jobs.front();
+			queues[self].jobs.pop_front();
+			return job;
+		}
+	}
+
+	for (size_t offset = 1; offset < queues.size(); offset++)
+	{
+		auto& victim = queues[(self + offset) % queues.size()];
+
+		std::lock_guard lock(victim.mutex);
+		if (!victim.jobs.empty())
+		{
+			const auto job = victim.jobs.back();
+			victim.jobs.pop_back();
+			return job;
+		}
+	}
+
+	// No job is added after start, so all queues being empty means all jobs are taken
+	return std::nullopt;
+}
+
+void Work_stealing_executor::run(size_t job_count, const std::function<void(size_t)>& job)
+{
+	const auto worker_count = std::min(thread_count, std::max<size_t>(job_count, 1));
+
+	std::vector<Job_queue> queues(worker_count);
+	for (size_t i = 0; i < job_count; i++) queues[i % worker_count].jobs.push_back(i);
+
+	std::vector<std::jthread> workers;
+	workers.reserve(worker_count);
+
+	for (size_t self = 0; self < worker_count; self++)
+		workers.emplace_back([this, &queues, &job, self] {
+			while (const auto job_index = take_job(queues, self)) job(*job_index);
+		});
+}
+
+/* Batch_runner */
+
+namespace
+{
+	// Split a manifest line into tokens, double quotes group a token containing spaces
+	std::vector<std::string> tokenize(const std::string& line)
+	{
+		std::vector<std::string> tokens;
+		std::string current;
+		bool in_quote = false, has_token = false;
+
+		for (const char ch : line)
+		{
+			if (ch == '"')
+			{
+				in_quote = !in_quote;
+				has_token = true;
+			}
+			else if (!in_quote && std::isspace(static_cast<unsigned char>(ch)))
+			{
+				if (has_token) tokens.push_back(std::move(current));
+				current.clear();
+				has_token = false;
+			}
+			else
+			{
+				current.push_back(ch);
+				has_token = true;
+			}
+		}
+
+		if (in_quote) throw std::invalid_argument("Unterminated quote");
+		if (has_token) tokens.push_back(std::move(current));
+
+		return tokens;
+	}
+
+	std::string read_text_file(const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			throw std::runtime_error(
+				std::format("Failed to open {} ({})", path.string(), std::strerror(errno))
+			);
+
+		std::ostringstream content;
+		content << file.rdbuf();
+		return content.str();
+	}
+}
+
+Batch_runner::Test_case Batch_runner::parse_line(
+	const std::string& line,
+	size_t line_number,
+	const std::filesystem::path& base_dir,
+	const Options& defaults
+)
+{
+	auto tokens = tokenize(line);
+
+	Test_case test;
+	test.name = tokens.front();
+	test.line = line_number;
+	test.options = defaults;
+	test.options.batch_manifest_path.clear();
+
+	std::string fill_policy_str, trap_capture_str, expect_uart_path;
+	u64 max_instructions = 0;
+	u32 expected_exit_code = 0;
+
+	argparse::ArgumentParser parser(test.name, "", argparse::default_arguments::none);
+
+	parser.add_argument("--flash").required().store_into(test.options.flash_file_path);
+	parser.add_argument("--fill")
+		.choices("none", "zero", "one", "random", "cdcdcdcd")
+		.store_into(fill_policy_str);
+	parser.add_argument("--trap").choices("none", "exception", "all").store_into(trap_capture_str);
+	parser.add_argument("--max-inst").store_into(max_instructions);
+	parser.add_argument("--expect-exit").store_into(expected_exit_code);
+	parser.add_argument("--expect-uart").store_into(expect_uart_path);
+
+	try
+	{
+		parser.parse_args(tokens);
+	}
+	catch (const std::exception& e)
+	{
+		throw std::invalid_argument(std::format("Manifest line {}: {}", line_number, e.what()));
+	}
+
+	test.options.flash_file_path = (base_dir / test.options.flash_file_path).string();
+	if (!fill_policy_str.empty()) test.options.ram_fill_policy = Options::parse_fill_policy(fill_policy_str);
+	if (!trap_capture_str.empty())
+		test.options.trap_capture = Options::parse_trap_capture_mode(trap_capture_str);
+	if (parser.is_used("--max-inst"))
+		test.options.max_instructions
+			= max_instructions != 0 ? std::optional<u64>(max_instructions) : std::optional<u64>();
+	if (parser.is_used("--expect-exit")) test.expected_exit_code = expected_exit_code;
+	if (parser.is_used("--expect-uart"))
+		test.expected_uart_output = read_text_file(base_dir / expect_uart_path);
+
+	return test;
+}
+
+Batch_runner Batch_runner::create(const Options& options)
+{
+	const std::filesystem::path manifest_path = options.batch_manifest_path;
+	const auto base_dir = manifest_path.parent_path();
+
+	std::ifstream manifest(manifest_path);
+	if (!manifest)
+		throw std::runtime_error(
+			std::format("Failed to open batch manifest {} ({})", manifest_path.string(), std::strerror(errno))
+		);
+
+	Batch_runner runner;
+	runner.jobs = options.batch_jobs;
+	runner.enable_debug = options.enable_debug;
+
+	std::string line;
+	for (size_t line_number = 1; std::getline(manifest, line); line_number++)
+	{
+		const auto first = line.find_first_not_of(" \t\r");
+		if (first == std::string::npos || line[first] == '#') continue;
+
+		runner.tests.push_back(parse_line(line, line_number, base_dir, options));
+	}
+
+	// One input log per test, named after it
+	const std::filesystem::path record_dir = options.record_file_path, replay_dir = options.replay_file_path;
+	if (!record_dir.empty() || !replay_dir.empty())
+	{
+		std::set<std::string> names;
+		for (auto& test : runner.tests)
+		{
+			if (!names.insert(test.name).second)
+				throw std::invalid_argument(
+					std::format("Duplicated test name \"{}\", input logs are named after tests", test.name)
+				);
+
+			const auto log_name = test.name + ".rvil";
+			if (!record_dir.empty()) test.options.record_file_path = (record_dir / log_name).string();
+			if (!replay_dir.empty()) test.options.replay_file_path = (replay_dir / log_name).string();
+		}
+
+		if (!record_dir.empty()) std::filesystem::create_directories(record_dir);
+	}
+
+	if (runner.enable_debug)
+	{
+		if (runner.tests.size() > 0x10000u - options.debug_port)
+			throw std::invalid_argument(
+				std::format("Not enough ports from {} for {} tests", options.debug_port, runner.tests.size())
+			);
+
+		for (size_t i = 0; i < runner.tests.size(); i++)
+			runner.tests[i].options.debug_port = static_cast<u16>(options.debug_port + i);
+	}
+
+	return runner;
+}
+
+Batch_runner::Test_result Batch_runner::run_test(const Test_case& test, gdb_stub::Debug_server* server)
+try
+{
+	Test_result test_result;
+
+	std::istringstream uart_input;
+	std::ostringstream uart_output;
+
+	Emulator emulator = Emulator::create(test.options);
+	emulator.set_uart_streams(uart_input, uart_output);
+
+	// Takes over the machine of `emulator`
+	std::optional<Emulator_debug> emulator_debug;
+	if (server != nullptr) emulator_debug.emplace(std::move(emulator), test.options, *server);
+
+	const auto start_time = std::chrono::steady_clock::now();
+	const auto stop_info
+		= emulator_debug.has_value() ? emulator_debug->run_until_stop_or_attach() : emulator.run_until_stop();
+	const auto elapsed = std::chrono::steady_clock::now() - start_time;
+
+	const Emulator& finished = emulator_debug.has_value() ? *emulator_debug : emulator;
+
+	// Also saved for failed tests, to reproduce them
+	finished.save_input_log();
+
+	test_result.seconds = std::chrono::duration<double>(elapsed).count();
+	test_result.inst_executed = finished.get_inst_executed();
+
+	const auto& result = stop_info.last_result;
+
+	switch (stop_info.reason)
+	{
+	case Emulator::Stop_info::Reason::Infinite_loop:
+	case Emulator::Stop_info::Reason::Sim_exit:
+		break;
+
+	case Emulator::Stop_info::Reason::Trap_captured:
+		test_result.message = std::format(
+			"Trap captured at PC: 0x{:08x} (Inst=0x{:08x}). Trap code: {}",
+			result.pc,
+			result.inst,
+			(u16)result.trap.value() & 0x0fff
+		);
+		return test_result;
+
+	case Emulator::Stop_info::Reason::Instruction_limit:
+		test_result.message = std::format("Instruction limit reached at PC: 0x{:08x}", result.pc);
+		return test_result;
+
+	case Emulator::Stop_info::Reason::Interrupted:
+		test_result.message = std::format("Attached by GDB at PC: 0x{:08x}", result.pc);
+		return test_result;
+	}
+
+	// Exit code requested through the sim control device, or `a0` when stopped at an infinite loop
+	const auto exit_code = stop_info.exit_code.value_or(finished.get_machine().get_register(10));
+	if (test.expected_exit_code.has_value() && exit_code != *test.expected_exit_code)
+	{
+		test_result.message = std::format("Exit code {}, expected {}", exit_code, *test.expected_exit_code);
+		return test_result;
+	}
+
+	if (!test.expected_exit_code.has_value() && stop_info.exit_code.value_or(0) != 0)
+	{
+		test_result.message = std::format("Guest exited with code {}", *stop_info.exit_code);
+		return test_result;
+	}
+
+	if (test.expected_uart_output.has_value() && uart_output.view() != *test.expected_uart_output)
+	{
+		test_result.message = "UART output mismatch";
+		return test_result;
+	}
+
+	test_result.passed = true;
+	return test_result;
+}
+catch (const std::exception& e)
+{
+	return Test_result{.passed = false, .message = e.what()};
+}
+
+bool Batch_runner::run()
+{
+	Work_stealing_executor executor(jobs);
+	std::vector<Test_result> results(tests.size());
+
+	// One I/O thread serves the ports of all tests
+	std::optional<gdb_stub::Debug_server> server;
+	if (enable_debug) server.emplace();
+
+	std::mutex print_mutex;
+	std::atomic<size_t> finished = 0;
+
+	iprintln(
+		"Running {} tests on {} threads",
+		tests.size(),
+		std::min(executor.get_thread_count(), tests.size())
+	);
+
+	const auto start_time = std::chrono::steady_clock::now();
+
+	executor.run(
+		tests.size(),
+		[this, &results, &print_mutex, &finished, &server](size_t index)
+		{
+			const auto& test = tests[index];
+			auto& result = results[index];
+
+			result = run_test(test, server.has_value() ? &*server : nullptr);
+			const auto mips = result.seconds > 0 ? result.inst_executed / result.seconds / 1e6 : 0.0;
+
+			std::lock_guard lock(print_mutex);
+			const auto count = ++finished;
+
+			if (result.passed)
+				std::println(
+					"[{}/{}] PASS {} ({} instructions, {:.2f} MIPS)",
+					count,
+					tests.size(),
+					test.name,
+					result.inst_executed,
+					mips
+				);
+			else
+				std::println(
+					"[{}/{}] FAIL {} (line {}): {}",
+					count,
+					tests.size(),
+					test.name,
+					test.line,
+					result.message
+				);
+		}
+	);
+
+	const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+	const auto passed = std::ranges::count_if(results, &Test_result::passed);
+	u64 total_inst = 0;
+	for (const auto& result : results) total_inst += result.inst_executed;
+
+	std::println(
+		"{} passed, {} failed, {} instructions in {:.3f} s ({:.2f} MIPS aggregate)",
+		passed,
+		results.size() - passed,
+		total_inst,
+		elapsed,
+		elapsed > 0 ? total_inst / elapsed / 1e6 : 0.0
+	);
+
+	return static_cast<size_t>(passed) == results.size();
+}
@@ -2,49 +2,63 @@
 #include "core/print.hpp"
 #include "gdb-stub/accessor.hpp"
 #include "gdb-stub/gdb-xml.hpp"
-#include "memory-map.hpp"
 
 using namespace gdb_stub;
 namespace cmd = command;
 
-Emulator_debug::Emulator_debug(Emulator&& emu, const Options& options) :
-	Emulator(std::move(emu)),
-	command_handlers({
-		{&typeid(cmd::Query_supported),       [this](const std::any& cmd) { handle_qsupport(cmd); }          },
-		{&typeid(cmd::Read_feature_xml),      [this](const std::any& cmd) { handle_qxfer_feature(cmd); }     },
-		{&typeid(cmd::Read_memory_map_xml),   [this](const std::any& cmd) { handle_qxfer_memory_map(cmd); }  },
-		{&typeid(cmd::Ask_halt_reason),       [this](const std::any& cmd) { handle_query(cmd); }             },
-		{&typeid(cmd::Read_memory),           [this](const std::any& cmd) { handle_mem_read(cmd); }          },
-		{&typeid(cmd::Write_memory),          [this](const std::any& cmd) { handle_mem_write(cmd); }         },
-		{&typeid(cmd::Read_register),         [this](const std::any& cmd) { handle_reg_read(cmd); }          },
-		{&typeid(cmd::Write_register),        [this](const std::any& cmd) { handle_reg_write(cmd); }         },
-		{&typeid(cmd::Read_single_register),  [this](const std::any& cmd) { handle_single_reg_read(cmd); }   },
-		{&typeid(cmd::Write_single_register), [this](const std::any& cmd) { handle_single_reg_write(cmd); }  },
-		{&typeid(cmd::Continue),              [this](const std::any& cmd) { handle_continue(cmd); }          },
-		{&typeid(cmd::Step_single_inst),      [this](const std::any& cmd) { handle_step(cmd); }              },
-		{&typeid(cmd::Step_cycles),           [this](const std::any& cmd) { handle_step_single_cycles(cmd); }},
-		{&typeid(cmd::Add_breakpoint),        [this](const std::any& cmd) { handle_add_breakpoint(cmd); }    },
-		{&typeid(cmd::Remove_breakpoint),     [this](const std::any& cmd) { handle_remove_breakpoint(cmd); } },
-		{&typeid(cmd::Add_watchpoint),        [this](const std::any& cmd) { handle_add_watchpoint(cmd); }    },
-		{&typeid(cmd::Remove_watchpoint),     [this](const std::any& cmd) { handle_remove_watchpoint(cmd); } },
-})
-{
-	network = std::make_unique<Network_handler>(options.debug_port);
+namespace
+{
+	// Visitor built from a set of lambdas
+	template <typename... Ts>
+	struct Overloaded : Ts...
+	{
+		using Ts::operator()...;
+	};
+}
+
+Emulator_debug::Emulator_debug(Emulator&& emu, const Options& options, Debug_server& server) :
+	Emulator(std::move(emu))
+{
+	const auto xml = machine->generate_memory_map_xml();
+	memory_map_xml.assign(xml.begin(), xml.end());
+
+	register_numbers.append_range(std::views::iota(0u, 33u));
+	register_numbers.append_range(
+		core::CSR_module::metadata.get<core::CSR_metadata::Key_address>()
+		| std::views::transform([](const auto& meta) { return meta.address + 128; })
+	);
+
+	if (options.checkpoint_interval != 0 && !options.host_file_root.empty())
+		wprintln("Reverse execution disabled, host file access can't be replayed");
+	else if (options.checkpoint_interval != 0)
+		history.emplace(*machine, options.checkpoint_interval, options.checkpoint_count);
+
+	network = server.listen(options.debug_port);
+	execution_thread
+		= std::jthread([this](std::stop_token stop_token) { execution_thread_main(std::move(stop_token)); });
 
 	iprintln("GDB stub listening on port {}", options.debug_port);
 }
 
-bool Emulator_debug::check_breakpoint()
+std::optional<response::Stop_reason::Breakpoint_hit> Emulator_debug::check_breakpoint()
 {
-	return hw_breakpoints.contains(platform->cpu->pc)
-		&& hw_breakpoints.at(platform->cpu->pc).is_triggered_by(*platform->cpu);
+	const auto is_triggered = [this](const std::map<u32, Breakpoint>& breakpoints)
+	{
+		const auto find = breakpoints.find(machine->get_pc());
+		return find != breakpoints.end() && find->second.is_triggered_by(machine->get_cpu());
+	};
+
+	if (is_triggered(sw_breakpoints)) return response::Stop_reason::Breakpoint_hit{.is_hardware = false};
+	if (is_triggered(hw_breakpoints)) return response::Stop_reason::Breakpoint_hit{.is_hardware = true};
+
+	return std::nullopt;
 }
 
 std::optional<std::pair<bool, bool>> Emulator_debug::check_watchpoint(const core::CPU_module::Result& result)
 {
 	const auto mode = result.memory_opcode;
 
-	if (mode == core::Load_store_module::Opcode::None) [[likely]]
+	if (mode == core::Load_store_module::Opcode::None || !watch_pages.contains(result.alu_result)) [[likely]]
 		return std::nullopt;
 
 	const auto write = mode == core::Load_store_module::Opcode::Store;
@@ -61,183 +75,201 @@ std::optional<std::pair<bool, bool>> Emulator_debug::check_watchpoint(const core
 	return std::make_pair(read && find->second.watch_read, write && find->second.watch_write);
 }
 
+void Emulator_debug::update_watch_pages()
+{
+	watch_pages.clear();
+	for (const auto& range : watchpoints | std::views::keys) watch_pages.add(range);
+}
+
 void Emulator_debug::send_response(const Response& response)
 {
 	if (!network->send(response).has_value()) network->close();
 }
 
-void Emulator_debug::handle_qsupport(const std::any& command [[maybe_unused]])
+void Emulator_debug::clear_history()
+{
+	if (history.has_value()) history->clear();
+}
+
+void Emulator_debug::handle_qsupport(const cmd::Query_supported& command [[maybe_unused]])
 {
 	send_response(response::Qsupported_response());
 }
 
-void Emulator_debug::handle_qxfer_feature(const std::any& command)
+void Emulator_debug::handle_start_no_ack_mode(const cmd::Start_no_ack_mode& command [[maybe_unused]])
+{
+	// The `OK` itself is still acknowledged by GDB
+	send_response(response::OK());
+	network->enable_no_ack_mode();
+}
+
+void Emulator_debug::handle_qxfer_feature(const cmd::Read_feature_xml& command)
 {
-	const auto cmd = std::any_cast<const command::Read_feature_xml>(command);
-	const auto get_xml_result = get_xml_file(cmd.annex, cmd.offset, cmd.length);
+	const auto get_xml_result = get_xml_file(command.annex, command.offset, command.length);
 
 	if (!get_xml_result)
-		send_response(response::Error_message(std::format("Unknown annex: {}", cmd.annex)));
+		send_response(response::Error_message(std::format("Unknown annex: {}", command.annex)));
 	else
 		send_response(response::Qxfer_response(get_xml_result->is_end, get_xml_result->data));
 }
 
-void Emulator_debug::handle_qxfer_memory_map(const std::any& command)
+void Emulator_debug::handle_qxfer_memory_map(const cmd::Read_memory_map_xml& command)
 {
-	const auto cmd = std::any_cast<const command::Read_memory_map_xml>(command);
-	const auto is_end = cmd.offset + cmd.length >= memory_map_xml.size();
+	const auto is_end = command.offset + command.length >= memory_map_xml.size();
 
 	send_response(
 		response::Qxfer_response(
 			is_end,
 			memory_map_xml
-				| std::views::drop(cmd.offset)
-				| std::views::take(cmd.length)
+				| std::views::drop(command.offset)
+				| std::views::take(command.length)
 				| std::ranges::to<std::vector>()
 		)
 	);
 }
 
-void Emulator_debug::handle_query(const std::any& command [[maybe_unused]])
+void Emulator_debug::handle_query(const cmd::Ask_halt_reason& command [[maybe_unused]])
 {
 	send_response(response::Stop_reason(SIGINT));
 }
 
-void Emulator_debug::handle_mem_read(const std::any& command)
+void Emulator_debug::handle_mem_read(const cmd::Read_memory& command)
 {
-	const auto cmd = std::any_cast<const command::Read_memory>(command);
+	constexpr u64 page_size = 4096;
 
-	std::vector<u8> data;
-	data.reserve(cmd.length);
+	auto& data = memory_buffer;
+	data.resize(command.length);
+	size_t done = 0;
 
-	for (const auto addr_range :
-		 std::views::iota(cmd.address)
-			 | std::views::take(cmd.length)
-			 | std::views::chunk_by([](u32 prev, u32 next) { return prev % 4 != 3 || next % 4 != 0; }))
+	// Copy a page at a time. The reply stops at the first unreadable byte, so a failed page is retried a
+	// word at a time to find it.
+	while (done < data.size())
 	{
-		const auto read_result = platform->memory->read(addr_range.front());
-		if (!read_result) break;
+		const u64 address = u64(command.address) + done;
+		const auto count = std::min<u64>(data.size() - done, page_size - address % page_size);
+
+		if (machine->read_memory(address, std::span(data).subspan(done, count)))
+		{
+			done += count;
+			continue;
+		}
+
+		for (const auto end = done + count; done < end;)
+		{
+			const u64 word_address = u64(command.address) + done;
+			const auto word_count = std::min<u64>(end - done, 4 - word_address % 4);
+			if (!machine->read_memory(word_address, std::span(data).subspan(done, word_count))) break;
+			done += word_count;
+		}
 
-		const auto bytes = std::bit_cast<std::array<u8, 4>>(read_result.value());
-		for (const auto addr : addr_range) data.push_back(bytes[addr % 4]);
+		break;
 	}
 
+	data.resize(done);
 	send_response(response::Raw_byte_stream(data));
 }
 
-void Emulator_debug::handle_mem_write(const std::any& command)
+void Emulator_debug::handle_mem_write(const cmd::Write_memory& command)
 {
-	const auto cmd = std::any_cast<const command::Write_memory>(command);
-
-	for (const auto addr : std::views::iota(cmd.address) | std::views::take(cmd.data.size()))
+	if (!machine->write_memory(command.address, command.data))
 	{
-		const core::Bitset<4> byte_enable = 1 << (addr % 4);
-		const u32 write_data = static_cast<u32>(cmd.data[addr - cmd.address]) << ((addr % 4) * 8);
-		if (!platform->memory->write(addr, write_data, byte_enable).has_value())
-		{
-			send_response(response::Error_code(0));
-			return;
-		}
+		send_response(response::Error_code(0));
+		return;
 	}
 
+	clear_history();
 	send_response(response::OK());
 }
 
-void Emulator_debug::handle_reg_read(const std::any& command [[maybe_unused]])
+void Emulator_debug::handle_reg_read(const cmd::Read_register& command [[maybe_unused]])
 {
-	const CPU_register_accessor reg_accessor{.cpu = *platform->cpu};
+	const CPU_register_accessor reg_accessor{.cpu = machine->get_cpu()};
 
-	std::vector<u16> regnums;
-	regnums.append_range(std::views::iota(0u, 33u));
-	regnums.append_range(
-		core::CSR_module::metadata.get<core::CSR_metadata::Key_address>()
-		| std::views::transform([](const auto& meta) { return meta.address + 128; })
-	);
+	register_buffer.clear();
+	for (const auto regno : register_numbers) register_buffer.push_back(reg_accessor.read(regno));
 
-	send_response(
-		response::Register_content(
-			regnums
-			| std::views::transform([&reg_accessor](auto regno) { return reg_accessor.read(regno); })
-			| std::ranges::to<std::vector>()
-		)
-	);
+	send_response(response::Register_content(register_buffer));
 }
 
-void Emulator_debug::handle_reg_write(const std::any& command)
+void Emulator_debug::handle_reg_write(const cmd::Write_register& command)
 {
-	const auto cmd = std::any_cast<const command::Write_register>(command);
-	const CPU_register_accessor reg_accessor{.cpu = *platform->cpu};
+	const CPU_register_accessor reg_accessor{.cpu = machine->get_cpu()};
 
-	for (const auto& [regno, value] : cmd.values) reg_accessor.write(regno, value);
+	for (const auto& [regno, value] : command.values) reg_accessor.write(regno, value);
+	clear_history();
 
 	send_response(response::OK());
 }
 
-void Emulator_debug::handle_single_reg_read(const std::any& command)
+void Emulator_debug::handle_single_reg_read(const cmd::Read_single_register& command)
 {
-	const auto cmd = std::any_cast<const command::Read_single_register>(command);
-	const CPU_register_accessor reg_accessor{.cpu = *platform->cpu};
-	const auto read_result = reg_accessor.read(cmd.regno);
+	const CPU_register_accessor reg_accessor{.cpu = machine->get_cpu()};
+	const auto read_result = reg_accessor.read(command.regno);
 	send_response(response::Single_register_content(read_result));
 }
 
-void Emulator_debug::handle_single_reg_write(const std::any& command)
+void Emulator_debug::handle_single_reg_write(const cmd::Write_single_register& command)
 {
-	const auto cmd = std::any_cast<const command::Write_single_register>(command);
-	const CPU_register_accessor reg_accessor{.cpu = *platform->cpu};
-	reg_accessor.write(cmd.regno, cmd.value);
+	const CPU_register_accessor reg_accessor{.cpu = machine->get_cpu()};
+	reg_accessor.write(command.regno, command.value);
+	clear_history();
 	send_response(response::OK());
 }
 
-void Emulator_debug::handle_add_breakpoint(const std::any& command)
+void Emulator_debug::handle_add_breakpoint(const cmd::Add_breakpoint& command)
 {
-	const auto cmd = std::any_cast<const command::Add_breakpoint>(command);
+	if (command.length != 4)
+	{
+		send_response(response::Error_message("Only 4-byte breakpoints are supported"));
+		return;
+	}
 
-	if (!cmd.is_hardware)
+	if (command.address % 4 != 0)
 	{
-		send_response(response::Unsupported_command());
+		send_response(response::Error_message("Breakpoint address must be 4-byte aligned"));
 		return;
 	}
 
-	if (cmd.length != 4)
+	auto breakpoint = Breakpoint::from(command);
+	if (!breakpoint)
 	{
-		send_response(response::Error_message("Only 4-byte breakpoints are supported"));
+		send_response(response::Error_message("Invalid breakpoint condition"));
 		return;
 	}
 
-	hw_breakpoints.emplace(cmd.address, Hw_breakpoint::from(cmd));
+	// Both kinds are patched into the instruction cache, and told apart when hit
+	auto& breakpoints = command.is_hardware ? hw_breakpoints : sw_breakpoints;
+	breakpoints.insert_or_assign(command.address, std::move(*breakpoint));
+	machine->add_breakpoint(command.address);
+
 	send_response(response::OK());
 }
 
-void Emulator_debug::handle_remove_breakpoint(const std::any& command)
+void Emulator_debug::handle_remove_breakpoint(const cmd::Remove_breakpoint& command)
 {
-	const auto cmd = std::any_cast<const command::Remove_breakpoint>(command);
-	if (!cmd.is_hardware)
-	{
-		send_response(response::Unsupported_command());
-		return;
-	}
+	auto& breakpoints = command.is_hardware ? hw_breakpoints : sw_breakpoints;
 
-	if (hw_breakpoints.erase(cmd.address) == 0)
+	if (breakpoints.erase(command.address) == 0)
 	{
 		send_response(response::Error_message("No such breakpoint"));
 		return;
 	}
 
+	if (!hw_breakpoints.contains(command.address) && !sw_breakpoints.contains(command.address))
+		machine->remove_breakpoint(command.address);
+
 	send_response(response::OK());
 }
 
-void Emulator_debug::handle_add_watchpoint(const std::any& command)
+void Emulator_debug::handle_add_watchpoint(const cmd::Add_watchpoint& command)
 {
-	const auto cmd = std::any_cast<const command::Add_watchpoint>(command);
-
-	if (cmd.length == 0)
+	if (command.length == 0)
 	{
 		send_response(response::Error_message("Watchpoint length must be greater than 0"));
 		return;
 	}
 
-	if (!cmd.watch_read && !cmd.watch_write)
+	if (!command.watch_read && !command.watch_write)
 	{
 		send_response(response::Error_message("Watchpoint must watch read or write"));
 		return;
@@ -245,23 +277,23 @@ void Emulator_debug::handle_add_watchpoint(const std::any& command)
 
 	watchpoints.emplace(
 		Address_range{
-			.start = cmd.address,
-			.size = cmd.length
+			.start = command.address,
+			.size = command.length
     },
 		Watchpoint{
-			.watch_write = cmd.watch_write,
-			.watch_read = cmd.watch_read,
-			.addr_range = {.start = cmd.address, .size = cmd.length}
+			.watch_write = command.watch_write,
+			.watch_read = command.watch_read,
+			.addr_range = {.start = command.address, .size = command.length}
 		}
 	);
+	update_watch_pages();
 
 	send_response(response::OK());
 }
 
-void Emulator_debug::handle_remove_watchpoint(const std::any& command)
+void Emulator_debug::handle_remove_watchpoint(const cmd::Remove_watchpoint& command)
 {
-	const auto cmd = std::any_cast<const command::Remove_watchpoint>(command);
-	const auto hit = watchpoints.find(Address_range{.start = cmd.address, .size = cmd.length});
+	const auto hit = watchpoints.find(Address_range{.start = command.address, .size = command.length});
 
 	if (hit == watchpoints.end())
 	{
@@ -270,75 +302,346 @@ void Emulator_debug::handle_remove_watchpoint(const std::any& command)
 	}
 
 	watchpoints.erase(hit);
+	update_watch_pages();
+
 	send_response(response::OK());
 }
 
-void Emulator_debug::async_run(
-	const std::function<gdb_stub::response::Stop_reason(const std::atomic<bool>&)>& run_func
-)
+void Emulator_debug::execution_thread_main(std::stop_token stop_token)
+{
+	while (true)
+	{
+		Run_function run_func;
+
+		{
+			std::unique_lock lock(run_mutex);
+			if (!run_condition.wait(lock, stop_token, [this] { return pending_run != nullptr; })) return;
+			run_func = std::exchange(pending_run, nullptr);
+		}
+
+		const auto result = run_func(run_interrupt);
+
+		{
+			const std::scoped_lock lock(run_mutex);
+			run_result = result;
+		}
+
+		run_condition.notify_all();
+		network->notify();
+	}
+}
+
+response::Stop_reason Emulator_debug::wait_run_result()
 {
-	std::atomic<bool> interrupt = false;
-	auto result = std::async(std::launch::async, run_func, std::ref(interrupt));
+	std::unique_lock lock(run_mutex);
+	run_condition.wait(lock, [this] { return run_result.has_value(); });
+	return *std::exchange(run_result, std::nullopt);
+}
+
+void Emulator_debug::pause_run()
+{
+	std::unique_lock lock(run_mutex);
+	run_pause = true;
+	run_condition.wait(lock, [this] { return run_paused || run_result.has_value(); });
+}
+
+void Emulator_debug::resume_run()
+{
+	{
+		const std::scoped_lock lock(run_mutex);
+		run_pause = false;
+	}
+
+	run_condition.notify_all();
+}
+
+void Emulator_debug::stop_run()
+{
+	if (!running) return;
+
+	run_interrupt = true;
+	wait_run_result();
+	running = false;
+	stop_requested = false;
+}
+
+void Emulator_debug::report_run_stop()
+{
+	{
+		const std::scoped_lock lock(run_mutex);
+		if (!run_result.has_value()) return;
+	}
+
+	auto stop_reason = wait_run_result();
+	if (std::exchange(stop_requested, false)) stop_reason = response::Stop_reason(0);
+	running = false;
+
+	if (!network->send_notification("Stop", stop_reason).has_value()) network->close();
+}
+
+void Emulator_debug::async_run(const Run_function& run_func)
+{
+	{
+		const std::scoped_lock lock(run_mutex);
+		run_interrupt = false;
+		run_result.reset();
+		pending_run = run_func;
+	}
+
+	run_condition.notify_all();
+
+	// The stop is notified later, see `report_run_stop()`
+	if (non_stop)
+	{
+		running = true;
+		send_response(response::OK());
+		return;
+	}
 
 	while (true)
 	{
-		std::this_thread::yield();
+		{
+			const std::scoped_lock lock(run_mutex);
+			if (run_result.has_value()) break;
+		}
 
-		if (!result.valid()) continue;
-		const auto status = result.wait_for(std::chrono::milliseconds(50));
-		if (status == std::future_status::ready) break;
+		// Woken by the execution thread as soon as the run function returns
+		const auto wait_result = network->wait();
+		if (wait_result && *wait_result == Network_handler::Wait_result::Notified) continue;
 
-		const auto recv_command_result = network->receive();
-		if (!recv_command_result) continue;
+		const auto recv_command_result = wait_result.has_value()
+			? network->receive()
+			: std::expected<cmd::Command, Network_handler::Error>(std::unexpect, wait_result.error());
+
+		if (!recv_command_result)
+		{
+			if (recv_command_result.error() == Network_handler::Error::Decode_fail)
+			{
+				send_response(response::Unsupported_command());
+				continue;
+			}
+
+			// GDB is gone, waiting again would take the packets of the next connection
+			run_interrupt = true;
+			wait_run_result();
+			return;
+		}
 
 		const auto& command = *recv_command_result;
-		if (command.type() == typeid(Interrupt_packet) || command.type() == typeid(command::Ask_halt_reason))
-			interrupt = true;
+		if (std::holds_alternative<Interrupt_packet>(command)
+			|| std::holds_alternative<cmd::Ask_halt_reason>(command))
+			run_interrupt = true;
+		else if (std::holds_alternative<cmd::Interrupt_request>(command))
+		{
+			run_interrupt = true;
+			send_response(response::OK());
+		}
 		else
 		{
 			network->close();
+			run_interrupt = true;
+			wait_run_result();
 			return;
 		}
 	}
 
-	send_response(result.get());
+	send_response(wait_run_result());
 }
 
-void Emulator_debug::handle_continue(const std::any& command)
+void Emulator_debug::handle_continue(const cmd::Continue& command)
 {
-	const auto cmd = std::any_cast<const command::Continue>(command);
-	if (cmd.address.has_value()) platform->cpu->pc = *cmd.address;
+	if (command.address.has_value())
+	{
+		machine->get_cpu().pc = *command.address;
+		clear_history();
+	}
 
 	async_run([this](const std::atomic<bool>& interrupt) { return run_until_trap(interrupt); });
 }
 
-void Emulator_debug::handle_step(const std::any& command)
+void Emulator_debug::handle_step(const cmd::Step_single_inst& command)
 {
-	const auto cmd = std::any_cast<const command::Step_single_inst>(command);
-	if (cmd.address.has_value()) platform->cpu->pc = *cmd.address;
+	if (command.address.has_value())
+	{
+		machine->get_cpu().pc = *command.address;
+		clear_history();
+	}
 
 	async_run([this](const std::atomic<bool>& interrupt) { return run_steps(1, interrupt); });
 }
 
-void Emulator_debug::handle_step_single_cycles(const std::any& command)
+void Emulator_debug::handle_reverse_step(const cmd::Reverse_step& command [[maybe_unused]])
+{
+	if (!history.has_value())
+	{
+		send_response(response::Error_message("Reverse execution is disabled"));
+		return;
+	}
+
+	// The replay has no safe point, commands received meanwhile would wait for all of it
+	if (non_stop)
+	{
+		send_response(response::Error_message("Reverse execution is unavailable in non-stop mode"));
+		return;
+	}
+
+	async_run(
+		[this](const std::atomic<bool>& interrupt [[maybe_unused]]) -> response::Stop_reason
+		{
+			if (!history->step_back()) return response::Stop_reason::History_begin{};
+			return SIGTRAP;
+		}
+	);
+}
+
+void Emulator_debug::handle_reverse_continue(const cmd::Reverse_continue& command [[maybe_unused]])
+{
+	if (!history.has_value())
+	{
+		send_response(response::Error_message("Reverse execution is disabled"));
+		return;
+	}
+
+	// The replay has no safe point, commands received meanwhile would wait for all of it
+	if (non_stop)
+	{
+		send_response(response::Error_message("Reverse execution is unavailable in non-stop mode"));
+		return;
+	}
+
+	// Not interruptible, takes at most one replay of the whole history
+	async_run(
+		[this](const std::atomic<bool>& interrupt [[maybe_unused]]) -> response::Stop_reason
+		{
+			// The stop is on the latest triggered hit
+			std::optional<response::Stop_reason::Breakpoint_hit> hit;
+			const auto is_triggered = [this, &hit](machine::Machine& machine [[maybe_unused]])
+			{
+				const auto breakpoint_hit = check_breakpoint();
+				if (breakpoint_hit.has_value()) hit = breakpoint_hit;
+				return breakpoint_hit.has_value();
+			};
+
+			if (!history->continue_back(is_triggered))
+				return response::Stop_reason::History_begin{};
+
+			return *hit;
+		}
+	);
+}
+
+void Emulator_debug::handle_vcont_query(const cmd::Query_vcont& command [[maybe_unused]])
+{
+	send_response(response::Vcont_actions());
+}
+
+void Emulator_debug::handle_vcont(const cmd::Vcont& command)
+{
+	// Single thread, the first action applies to it
+	const auto action = command.actions.front();
+
+	switch (action.kind)
+	{
+	case cmd::Vcont::Action::Kind::Continue:
+		async_run([this](const std::atomic<bool>& interrupt) { return run_until_trap(interrupt); });
+		break;
+	case cmd::Vcont::Action::Kind::Step:
+		async_run([this](const std::atomic<bool>& interrupt) { return run_steps(1, interrupt); });
+		break;
+	case cmd::Vcont::Action::Kind::Range_step:
+		async_run([this, action](const std::atomic<bool>& interrupt)
+				  { return run_range_step(action.range_start, action.range_end, interrupt); });
+		break;
+	case cmd::Vcont::Action::Kind::Stop:
+		// Already stopped, a running target is handled by `handle_running_command()`
+		if (non_stop)
+			send_response(response::OK());
+		else
+			send_response(response::Error_message("vCont;t is only supported in non-stop mode"));
+		break;
+	}
+}
+
+void Emulator_debug::handle_interrupt_request(const cmd::Interrupt_request& command [[maybe_unused]])
+{
+	// Nothing is running, a running target is handled by `handle_running_command()`
+	send_response(response::OK());
+}
+
+void Emulator_debug::handle_set_non_stop(const cmd::Set_non_stop& command)
+{
+	non_stop = command.enable;
+	send_response(response::OK());
+}
+
+void Emulator_debug::handle_ack_stop_notification(const cmd::Ack_stop_notification& command [[maybe_unused]])
 {
-	const auto cmd = std::any_cast<const command::Step_cycles>(command);
-	if (cmd.address.has_value()) platform->cpu->pc = *cmd.address;
+	// The only stop is reported by the notification itself
+	send_response(response::OK());
+}
 
-	async_run([this, cycle_count = cmd.cycle_count.value_or(1)](const std::atomic<bool>& interrupt)
+void Emulator_debug::handle_step_single_cycles(const cmd::Step_cycles& command)
+{
+	if (command.address.has_value())
+	{
+		machine->get_cpu().pc = *command.address;
+		clear_history();
+	}
+
+	async_run([this, cycle_count = command.cycle_count.value_or(1)](const std::atomic<bool>& interrupt)
 			  { return run_steps(cycle_count, interrupt); });
 }
 
-auto Emulator_debug::handle_special_commands(const std::any& command) -> Special_command_handle_result
+bool Emulator_debug::dispatch_command(const cmd::Command& command)
 {
-	if (command.type() == typeid(Acknowledge_packet)) return Special_command_handle_result::Continue;
-	if (command.type() == typeid(command::Restart))
+	bool handled = true;
+
+	std::visit(
+		Overloaded{
+			[this](const cmd::Query_supported& c) { handle_qsupport(c); },
+			[this](const cmd::Start_no_ack_mode& c) { handle_start_no_ack_mode(c); },
+			[this](const cmd::Read_feature_xml& c) { handle_qxfer_feature(c); },
+			[this](const cmd::Read_memory_map_xml& c) { handle_qxfer_memory_map(c); },
+			[this](const cmd::Ask_halt_reason& c) { handle_query(c); },
+			[this](const cmd::Read_memory& c) { handle_mem_read(c); },
+			[this](const cmd::Write_memory& c) { handle_mem_write(c); },
+			[this](const cmd::Read_register& c) { handle_reg_read(c); },
+			[this](const cmd::Write_register& c) { handle_reg_write(c); },
+			[this](const cmd::Read_single_register& c) { handle_single_reg_read(c); },
+			[this](const cmd::Write_single_register& c) { handle_single_reg_write(c); },
+			[this](const cmd::Continue& c) { handle_continue(c); },
+			[this](const cmd::Step_single_inst& c) { handle_step(c); },
+			[this](const cmd::Step_cycles& c) { handle_step_single_cycles(c); },
+			[this](const cmd::Reverse_step& c) { handle_reverse_step(c); },
+			[this](const cmd::Reverse_continue& c) { handle_reverse_continue(c); },
+			[this](const cmd::Query_vcont& c) { handle_vcont_query(c); },
+			[this](const cmd::Vcont& c) { handle_vcont(c); },
+			[this](const cmd::Interrupt_request& c) { handle_interrupt_request(c); },
+			[this](const cmd::Set_non_stop& c) { handle_set_non_stop(c); },
+			[this](const cmd::Ack_stop_notification& c) { handle_ack_stop_notification(c); },
+			[this](const cmd::Add_breakpoint& c) { handle_add_breakpoint(c); },
+			[this](const cmd::Remove_breakpoint& c) { handle_remove_breakpoint(c); },
+			[this](const cmd::Add_watchpoint& c) { handle_add_watchpoint(c); },
+			[this](const cmd::Remove_watchpoint& c) { handle_remove_watchpoint(c); },
+			[&handled](const auto& c [[maybe_unused]]) { handled = false; }
+		},
+		command
+	);
+
+	return handled;
+}
+
+auto Emulator_debug::handle_special_commands(const cmd::Command& command) -> Special_command_handle_result
+{
+	if (std::holds_alternative<Acknowledge_packet>(command)) return Special_command_handle_result::Continue;
+	if (std::holds_alternative<cmd::Restart>(command))
 	{
 		iprintln("Emulator restarting, requested by GDB");
-		platform->memory->ram->reset_content();
+		for (size_t i = 0; i < machine->get_ram_count(); i++) machine->get_ram(i).reset_content();
+		clear_history();
 		return Special_command_handle_result::Continue;
 	}
-	if (command.type() == typeid(command::Stop))
+	if (std::holds_alternative<cmd::Stop>(command))
 	{
 		iprintln("Emulator stopping, requested by GDB");
 		return Special_command_handle_result::Stop;
@@ -347,12 +650,101 @@ auto Emulator_debug::handle_special_commands(const std::any& command) -> Special
 	return Special_command_handle_result::Unhandled;
 }
 
+bool Emulator_debug::handle_running_command(const cmd::Command& command)
+{
+	if (std::holds_alternative<Interrupt_packet>(command))
+	{
+		run_interrupt = true;
+		return true;
+	}
+
+	if (std::holds_alternative<cmd::Interrupt_request>(command))
+	{
+		run_interrupt = true;
+		send_response(response::OK());
+		return true;
+	}
+
+	if (const auto* vcont = std::get_if<cmd::Vcont>(&command);
+		vcont != nullptr && vcont->actions.front().kind == cmd::Vcont::Action::Kind::Stop)
+	{
+		stop_requested = true;
+		run_interrupt = true;
+		send_response(response::OK());
+		return true;
+	}
+
+	// No thread is stopped
+	if (std::holds_alternative<cmd::Ask_halt_reason>(command))
+	{
+		send_response(response::OK());
+		return true;
+	}
+
+	if (std::holds_alternative<cmd::Continue>(command)
+		|| std::holds_alternative<cmd::Step_single_inst>(command)
+		|| std::holds_alternative<cmd::Step_cycles>(command)
+		|| std::holds_alternative<cmd::Reverse_step>(command)
+		|| std::holds_alternative<cmd::Reverse_continue>(command)
+		|| std::holds_alternative<cmd::Vcont>(command)
+		|| std::holds_alternative<cmd::Set_non_stop>(command))
+	{
+		send_response(response::Error_message("Target is running"));
+		return true;
+	}
+
+	if (std::holds_alternative<cmd::Stop>(command)) stop_run();
+
+	return false;
+}
+
+bool Emulator_debug::handle_command(const cmd::Command& command)
+{
+	if (dispatch_command(command)) return true;
+
+	switch (handle_special_commands(command))
+	{
+	case Special_command_handle_result::Unhandled:
+		break;
+	case Special_command_handle_result::Continue:
+		return true;
+	case Special_command_handle_result::Stop:
+		return false;
+	}
+
+	wprintln("Unhandled command: #{}", command.index());
+	network->close();
+	return false;
+}
+
 void Emulator_debug::run()
 {
 	if (network == nullptr) throw std::logic_error("Network Handler not initialized");
 
 	while (true)
 	{
+		// A new connection starts in all-stop mode, with the target stopped
+		if (!network->is_connected())
+		{
+			stop_run();
+			non_stop = false;
+		}
+
+		// In non-stop mode, the run is reported as soon as it returns, while GDB may keep sending commands
+		if (running)
+		{
+			const auto wait_result = network->wait();
+
+			// Disconnected, reset before serving the next connection
+			if (!wait_result) continue;
+
+			if (*wait_result == Network_handler::Wait_result::Notified)
+			{
+				report_run_stop();
+				continue;
+			}
+		}
+
 		const auto recv_command_result = network->receive();
 
 		if (!recv_command_result)
@@ -363,6 +755,7 @@ void Emulator_debug::run()
 			case Error::Internal_fail:
 				wprintln("Internal error!");
 				network->close();
+				stop_run();
 				return;
 
 			case Error::Connection_fault:
@@ -387,54 +780,84 @@ void Emulator_debug::run()
 
 		const auto& command = *recv_command_result;
 
-		const auto find_handler = command_handlers.find(&command.type());
-		if (find_handler == command_handlers.end())
-		{
-			const auto special_handle_result = handle_special_commands(command);
+		// Other commands access the machine at a safe point of the run, which the guest can't observe as its
+		// time only advances with the executed instructions
+		if (running && handle_running_command(command)) continue;
 
-			switch (special_handle_result)
-			{
-			case Special_command_handle_result::Unhandled:
-				break;
-			case Special_command_handle_result::Continue:
-				continue;
-			case Special_command_handle_result::Stop:
-				return;
-			}
+		const bool paused = running;
+		if (paused) pause_run();
 
-			wprintln("Unhandled command: {}", command.type().name());
-			network->close();
+		const bool keep_running = handle_command(command);
+		if (paused) resume_run();
+
+		if (!keep_running)
+		{
+			stop_run();
 			return;
 		}
+	}
+}
+
+auto Emulator_debug::step(bool resume)
+	-> std::expected<core::CPU_module::Result, response::Stop_reason::Breakpoint_hit>
+{
+	if (history.has_value()) history->record();
+
+	const auto result = machine->step();
+	if (!machine->is_breakpoint_hit(result)) [[likely]]
+		return result;
 
-		find_handler->second(command);
+	if (!resume)
+	{
+		const auto hit = check_breakpoint();
+		if (hit.has_value()) return std::unexpected(*hit);
 	}
+
+	// Resuming from the breakpoint, or condition not met: execute the original instruction
+	return machine->step_over_breakpoint();
 }
 
-response::Stop_reason Emulator_debug::run_until_trap(const std::atomic<bool>& interrupt)
+std::optional<response::Stop_reason> Emulator_debug::step_and_check(bool resume)
 {
-	while (true)
+	const auto result = step(resume);
+	if (!result) [[unlikely]]
+		return result.error();
+
+	const auto watchpoint_hit = check_watchpoint(*result);
+
+	if (watchpoint_hit.has_value()) [[unlikely]]
 	{
-		const auto result = tick_one_cycle();
+		return response::Stop_reason::Watchpoint_hit{
+			.address = result->alu_result,
+			.is_write = watchpoint_hit->second,
+			.is_read = watchpoint_hit->first,
+		};
+	}
 
-		const bool is_breakpoint = check_breakpoint();
-		const auto watchpoint_hit = check_watchpoint(result);
+	return std::nullopt;
+}
 
-		if (is_breakpoint)
-		{
-			return response::Stop_reason::Breakpoint_hit{.is_hardware = true};
-		}
+bool Emulator_debug::poll_safe_point(const std::atomic<bool>& interrupt)
+{
+	if (run_pause.load(std::memory_order_relaxed)) [[unlikely]]
+	{
+		std::unique_lock lock(run_mutex);
+		run_paused = true;
+		run_condition.notify_all();
+		run_condition.wait(lock, [this] { return !run_pause.load(); });
+		run_paused = false;
+	}
 
-		if (watchpoint_hit.has_value())
-		{
-			return response::Stop_reason::Watchpoint_hit{
-				.address = result.alu_result,
-				.is_write = watchpoint_hit->second,
-				.is_read = watchpoint_hit->first,
-			};
-		}
+	return interrupt.load();
+}
+
+response::Stop_reason Emulator_debug::run_until_trap(const std::atomic<bool>& interrupt)
+{
+	for (bool resume = true;; resume = false)
+	{
+		if (auto stop = step_and_check(resume); stop.has_value()) return *stop;
 
-		if (interrupt.load()) [[unlikely]]
+		if (poll_safe_point(interrupt)) [[unlikely]]
 			return SIGINT;
 	}
 
@@ -443,30 +866,35 @@ response::Stop_reason Emulator_debug::run_until_trap(const std::atomic<bool>& in
 
 response::Stop_reason Emulator_debug::run_steps(size_t cycle_count, const std::atomic<bool>& interrupt)
 {
-	for (const auto _ : std::views::iota(0zu, cycle_count))
+	for (size_t i = 0; i < cycle_count; i++)
 	{
-		const auto result = tick_one_cycle();
+		if (auto stop = step_and_check(i == 0); stop.has_value()) return *stop;
 
-		const bool is_breakpoint = check_breakpoint();
-		const auto watchpoint_hit = check_watchpoint(result);
+		if (poll_safe_point(interrupt)) [[unlikely]]
+			return SIGINT;
+	}
 
-		if (is_breakpoint) [[unlikely]]
-		{
-			return response::Stop_reason::Breakpoint_hit{.is_hardware = true};
-		}
+	return SIGTRAP;
+}
 
-		if (watchpoint_hit.has_value()) [[unlikely]]
-		{
-			return response::Stop_reason::Watchpoint_hit{
-				.address = result.alu_result,
-				.is_write = watchpoint_hit->second,
-				.is_read = watchpoint_hit->first,
-			};
-		}
+response::Stop_reason Emulator_debug::run_range_step(u32 start, u32 end, const std::atomic<bool>& interrupt)
+{
+	for (bool resume = true;; resume = false)
+	{
+		if (auto stop = step_and_check(resume); stop.has_value()) return *stop;
+
+		const auto pc = machine->get_pc();
+		if (pc < start || pc >= end) return SIGTRAP;
 
-		if (interrupt.load()) [[unlikely]]
+		if (poll_safe_point(interrupt)) [[unlikely]]
 			return SIGINT;
 	}
+}
 
-	return SIGTRAP;
+Emulator::Stop_info Emulator_debug::run_until_stop_or_attach()
+{
+	const auto stop_info = run_until_stop([this] { return network->is_connected(); });
+	if (stop_info.reason == Stop_info::Reason::Interrupted) run();
+
+	return stop_info;
 }
@@ -6,47 +6,109 @@
 
 Emulator Emulator::create(const Options& options)
 {
-	std::vector<u8> rom_data;
-	{
-		std::ifstream rom_file(options.flash_file_path, std::ios::binary);
-		if (!rom_file)
-			throw std::runtime_error(std::format("Failed to open flash file ({})", std::strerror(errno)));
-
-		rom_file.seekg(0, std::ios::end);
-		const auto file_size = rom_file.tellg();
-		rom_file.seekg(0, std::ios::beg);
+	machine::Config config = options.layout_file_path.empty()
+							   ? machine::Config()
+							   : machine::Config::load_layout_file(options.layout_file_path);
+	config.ram_fill_policy = options.ram_fill_policy;
+	config.host_file_root = options.host_file_root;
 
-		if (file_size <= 0) throw std::runtime_error("Flash file is empty");
-		rom_data.resize(static_cast<size_t>(file_size));
-		rom_file.read(reinterpret_cast<char*>(rom_data.data()), file_size);
+	Emulator emulator;
+	emulator.machine = std::make_unique<machine::Machine>(config);
 
-		if (!rom_file || rom_file.gcount() != file_size)
-			throw std::runtime_error(std::format("Failed to read flash file ({})", std::strerror(errno)));
+	// Before any RAM page is filled
+	if (!options.replay_file_path.empty())
+	{
+		emulator.input_log
+			= std::make_unique<machine::Input_log>(machine::Input_log::load_file(options.replay_file_path));
+		emulator.input_log->replay(*emulator.machine);
+	}
+	else if (!options.record_file_path.empty())
+	{
+		emulator.input_log = std::make_unique<machine::Input_log>();
+		emulator.input_log->record(*emulator.machine);
+		emulator.record_file_path = options.record_file_path;
 	}
 
-	Emulator emulator;
-	emulator.platform = std::make_unique<Platform>(rom_data.data(), rom_data.size(), options.ram_fill_policy);
+	emulator.machine->load_flash_file(options.flash_file_path);
 	emulator.trap_capture_mode = options.trap_capture;
 	emulator.stop_at_infinite_loop = options.stop_at_infinite_loop;
+	emulator.max_instructions = options.max_instructions;
 
 	return emulator;
 }
 
-core::CPU_module::Result Emulator::tick_one_cycle()
+int Emulator::run()
 {
-	const auto result = platform->cpu->step();
-	platform->memory->clock_periph->tick(platform->cpu->csr.mip);
+	const auto start_time = std::chrono::steady_clock::now();
+	const auto stop_info = run_until_stop();
+	const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+	const auto& result = stop_info.last_result;
 
-	inst_executed++;
+	if (!record_file_path.empty())
+	{
+		save_input_log();
+		iprintln("Input log saved to {}", record_file_path);
+	}
+
+	switch (stop_info.reason)
+	{
+	case Stop_info::Reason::Infinite_loop:
+		iprintln("Infinite loop detected at PC: 0x{:08x}", result.pc);
+		break;
 
-	return result;
+	case Stop_info::Reason::Trap_captured:
+		if (trap_capture_mode == Options::Trap_capture_mode::Exception_only)
+			iprintln(
+				"Exception detected at PC: 0x{:08x} (Inst=0x{:08x}). Trap code: {}",
+				result.pc,
+				result.inst,
+				(u16)result.trap.value() & 0x0fff
+			);
+		else
+			iprintln(
+				"Trap captured at PC: 0x{:08x} (Inst=0x{:08x}). Trap type: {}; Trap code: {}",
+				result.pc,
+				result.inst,
+				(u16)core::is_interrupt(result.trap.value()) ? "Interrupt" : "Exception",
+				(u16)result.trap.value() & 0x0fff
+			);
+		break;
+
+	case Stop_info::Reason::Instruction_limit:
+		iprintln("Instruction limit reached at PC: 0x{:08x}", result.pc);
+		break;
+
+	case Stop_info::Reason::Sim_exit:
+		iprintln("Guest exited with code {} at PC: 0x{:08x}", stop_info.exit_code.value(), result.pc);
+		break;
+
+	case Stop_info::Reason::Interrupted:
+		iprintln("Interrupted at PC: 0x{:08x}", result.pc);
+		break;
+	}
+
+	const auto inst_executed = machine->get_inst_executed();
+	iprintln(
+		"Executed {} instructions in {:.6f} s ({:.2f} MIPS)",
+		inst_executed,
+		elapsed,
+		elapsed > 0 ? inst_executed / elapsed / 1e6 : 0.0
+	);
+
+	return static_cast<int>(stop_info.exit_code.value_or(0));
+}
+
+void Emulator::save_input_log() const
+{
+	if (!record_file_path.empty()) input_log->save_file(record_file_path);
 }
 
-void Emulator::run()
+Emulator::Stop_info Emulator::run_until_stop(const std::function<bool()>& interrupted)
 {
 	while (true)
 	{
-		const auto result = tick_one_cycle();
+		const auto result = machine->step();
 
 		switch (trap_capture_mode)
 		{
@@ -57,39 +119,45 @@ void Emulator::run()
 			if (result.trap.has_value()
 				&& core::is_interrupt(result.trap.value())
 				&& result.trap.value() != core::Trap::Env_call_from_M_mode)
-			{
-				iprintln(
-					"Exception detected at PC: 0x{:08x} (Inst=0x{:08x}). Trap code: {}",
-					result.pc,
-					result.inst,
-					(u16)result.trap.value() & 0x0fff
-				);
-				return;
-			}
+				return Stop_info{.reason = Stop_info::Reason::Trap_captured, .last_result = result};
 			break;
 
 		case Options::Trap_capture_mode::All:
 			if (result.trap.has_value())
-			{
-				iprintln(
-					"Trap captured at PC: 0x{:08x} (Inst=0x{:08x}). Trap type: {}; Trap code: {}",
-					result.pc,
-					result.inst,
-					(u16)core::is_interrupt(result.trap.value()) ? "Interrupt" : "Exception",
-					(u16)result.trap.value() & 0x0fff
-				);
-				return;
-			}
+				return Stop_info{.reason = Stop_info::Reason::Trap_captured, .last_result = result};
 			break;
 		}
 
+		// Only a store can execute a sim control command
+		if (result.memory_opcode == core::Load_store_module::Opcode::Store) [[unlikely]]
+		{
+			const auto exit_code = machine->get_sim_control().get_exit_code();
+			if (exit_code.has_value())
+				return Stop_info{
+					.reason = Stop_info::Reason::Sim_exit,
+					.last_result = result,
+					.exit_code = exit_code
+				};
+		}
+
 		if (stop_at_infinite_loop
 			&& !result.trap.has_value()
 			&& result.pc == result.alu_result
 			&& result.branch_result)
-		{
-			iprintln("Infinite loop detected at PC: 0x{:08x}", result.pc);
-			return;
-		}
+			return Stop_info{.reason = Stop_info::Reason::Infinite_loop, .last_result = result};
+
+		if (max_instructions.has_value() && machine->get_inst_executed() >= *max_instructions) [[unlikely]]
+			return Stop_info{.reason = Stop_info::Reason::Instruction_limit, .last_result = result};
+
+		const bool check_interrupt = machine->get_inst_executed() % interrupt_check_interval == 0;
+		if (check_interrupt && interrupted && interrupted()) [[unlikely]]
+			return Stop_info{.reason = Stop_info::Reason::Interrupted, .last_result = result};
 	}
 }
+
+void Emulator::set_uart_streams(std::istream& input, std::ostream& output)
+{
+	machine->get_uart().set_input_stream(input);
+	machine->get_uart().set_output_stream(output);
+	machine->get_sim_control().set_output_stream(output);
+}
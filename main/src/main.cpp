@@ -4,6 +4,7 @@
 #include <print>
 #include <stacktrace>
 
+#include "batch.hpp"
 #include "core/print.hpp"
 #include "emulator-debug.hpp"
 #include "emulator.hpp"
@@ -18,15 +19,22 @@ try
 
 	/* Emulate */
 
+	if (!options.batch_manifest_path.empty())
+	{
+		Batch_runner batch_runner = Batch_runner::create(options);
+		return batch_runner.run() ? 0 : 1;
+	}
+
 	if (options.enable_debug)
 	{
-		Emulator_debug emulator_debug(Emulator_debug::create(options), options);
+		gdb_stub::Debug_server server;
+		Emulator_debug emulator_debug(Emulator_debug::create(options), options, server);
 		emulator_debug.run();
 	}
 	else
 	{
 		Emulator emulator = Emulator::create(options);
-		emulator.run();
+		return emulator.run();
 	}
 
 	return 0;
@@ -1,6 +0,0 @@
-#include "memory-map.hpp"
-
-const std::vector<uint8_t> memory_map_xml = {
-#include "memory-map.xml.h"
-	}
-;
\ No newline at end of file
@@ -1,43 +1,59 @@
 #include "option.hpp"
 #include "core/print.hpp"
+#include "machine/config.hpp"
 
 #include <argparse/argparse.hpp>
 #include <map>
 
-Options Options::parse_args(int argc, char* argv[])
+device::Fill_policy Options::parse_fill_policy(const std::string& name)
 {
-	Options options;
-	std::string fill_policy_str;
-	std::string trap_capture_str;
+	return machine::parse_fill_policy(name);
+}
 
-	const std::map<std::string, device::Fill_policy> fill_policy_map = {
-		{"zero",     device::Fill_policy::Zero    },
-		{"one",      device::Fill_policy::One     },
-		{"random",   device::Fill_policy::Random  },
-		{"cdcdcdcd", device::Fill_policy::Cdcdcdcd},
-	};
-
-	const std::map<std::string, Options::Trap_capture_mode> trap_capture_map = {
+Options::Trap_capture_mode Options::parse_trap_capture_mode(const std::string& name)
+{
+	static const std::map<std::string, Options::Trap_capture_mode> trap_capture_map = {
 		{"none",      Options::Trap_capture_mode::No_capture    },
 		{"exception", Options::Trap_capture_mode::Exception_only},
 		{"all",       Options::Trap_capture_mode::All           },
 	};
 
+	const auto find = trap_capture_map.find(name);
+	if (find == trap_capture_map.end())
+		throw std::invalid_argument(std::format("Invalid trap capture mode: {}", name));
+
+	return find->second;
+}
+
+Options Options::parse_args(int argc, char* argv[])
+{
+	Options options;
+	std::string fill_policy_str;
+	std::string trap_capture_str;
+	u64 max_instructions = 0;
+
 	argparse::ArgumentParser program("<path>", "<alpha>");
 
 	// Arguments
 	{
 		program.add_argument("--flash")
-			.required()
 			.help("Path to the flash file")
 			.store_into(options.flash_file_path);
 
+		program.add_argument("--layout")
+			.help("Path to the platform layout file (standard platform if not set)")
+			.store_into(options.layout_file_path);
+
 		program.add_argument("--fill")
-			.choices("zero", "one", "random", "cdcdcdcd")
+			.choices("none", "zero", "one", "random", "cdcdcdcd")
 			.default_value("random")
 			.help("Fill policy for the main memory")
 			.store_into(fill_policy_str);
 
+		program.add_argument("--host-files")
+			.help("Directory accessible to the guest through the sim control device (disabled if not set)")
+			.store_into(options.host_file_root);
+
 		program.add_argument("--trap")
 			.choices("none", "exception", "all")
 			.default_value("none")
@@ -57,9 +73,41 @@ Options Options::parse_args(int argc, char* argv[])
 			.store_into(options.stop_at_infinite_loop);
 
 		program.add_argument("-p", "--remote-port")
-			.help("TCP port of remote debugging connection")
+			.help("TCP port of remote debugging connection, first of consecutive ports in batch mode")
 			.default_value(u16(16355))
 			.store_into(options.debug_port);
+
+		program.add_argument("--checkpoint-interval")
+			.help("Instructions between checkpoints for reverse debugging (0 to disable)")
+			.default_value(u64(1'000'000))
+			.store_into(options.checkpoint_interval);
+
+		program.add_argument("--checkpoint-count")
+			.help("Maximum number of checkpoints kept for reverse debugging")
+			.default_value(u32(256))
+			.store_into(options.checkpoint_count);
+
+		program.add_argument("--max-inst")
+			.help("Stop simulation after executing this many instructions (0 for no limit)")
+			.default_value(u64(0))
+			.store_into(max_instructions);
+
+		program.add_argument("--record")
+			.help("Record the nondeterministic inputs (RAM seeds, UART input) to a file (directory in batch)")
+			.store_into(options.record_file_path);
+
+		program.add_argument("--replay")
+			.help("Replay the inputs recorded by --record, to reproduce the run (directory in batch)")
+			.store_into(options.replay_file_path);
+
+		program.add_argument("--batch")
+			.help("Run the tests listed in a manifest file in headless batch mode")
+			.store_into(options.batch_manifest_path);
+
+		program.add_argument("-j", "--jobs")
+			.help("Number of worker threads in batch mode (0 for all hardware threads)")
+			.default_value(u32(0))
+			.store_into(options.batch_jobs);
 	}
 
 	try
@@ -79,7 +127,7 @@ Options Options::parse_args(int argc, char* argv[])
 #endif
 	}
 
-	if (options.flash_file_path.empty())
+	if (options.flash_file_path.empty() && options.batch_manifest_path.empty())
 	{
 		iprintln("Flash file path (-f, --flash) can't be empty, provide a path below:");
 		std::print(std::cerr, "Enter flash path:");
@@ -87,8 +135,15 @@ Options Options::parse_args(int argc, char* argv[])
 		std::getline(std::cin, flash_path);
 		options.flash_file_path = flash_path;
 	}
-	options.ram_fill_policy = fill_policy_map.at(fill_policy_str);
-	options.trap_capture = trap_capture_map.at(trap_capture_str);
+	options.ram_fill_policy = parse_fill_policy(fill_policy_str);
+	options.trap_capture = parse_trap_capture_mode(trap_capture_str);
+	if (max_instructions != 0) options.max_instructions = max_instructions;
+
+	if (!options.record_file_path.empty() && !options.replay_file_path.empty())
+		throw std::invalid_argument("--record and --replay can't be used together");
+
+	if (options.enable_debug && (!options.record_file_path.empty() || !options.replay_file_path.empty()))
+		throw std::invalid_argument("--record and --replay can't be used with --debug");
 
 	return options;
 }
\ No newline at end of file
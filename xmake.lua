@@ -6,4 +6,4 @@ end
 
 set_project("cpp-riscv-sim")
 
-includes("main", "lib")
+includes("main", "lib", "bench", "fuzz")